@@ -390,6 +390,7 @@ QMenu* DkActionManager::createFileMenu(QWidget* parent /* = 0 */) {
 	mFileMenu->addAction(mFileActions[menu_file_recursive]);
 	mFileMenu->addAction(mFileActions[menu_file_goto]);
 	mFileMenu->addAction(mFileActions[menu_file_find]);
+	mFileMenu->addAction(mFileActions[menu_file_open_sidecar]);
 	mFileMenu->addAction(mFileActions[menu_file_reload]);
 	mFileMenu->addAction(mFileActions[menu_file_prev]);
 	mFileMenu->addAction(mFileActions[menu_file_next]);
@@ -1039,6 +1040,11 @@ void DkActionManager::createActions(QWidget* parent) {
 	mFileActions[menu_file_find]->setShortcut(QKeySequence::Find);
 	mFileActions[menu_file_find]->setStatusTip(QObject::tr("Find an image"));
 
+	mFileActions[menu_file_open_sidecar] = new QAction(QObject::tr("Open &Duplicate"), parent);
+	mFileActions[menu_file_open_sidecar]->setShortcut(QKeySequence(shortcut_open_sidecar));
+	mFileActions[menu_file_open_sidecar]->setStatusTip(QObject::tr("Open the hidden duplicate of this image (e.g. its RAW file)"));
+	mFileActions[menu_file_open_sidecar]->setEnabled(false);
+
 	mFileActions[menu_file_recursive] = new QAction(QObject::tr("Scan Folder Re&cursive"), parent);
 	mFileActions[menu_file_recursive]->setStatusTip(QObject::tr("Step through Folder and Sub Folders"));
 	mFileActions[menu_file_recursive]->setCheckable(true);
@@ -135,6 +135,7 @@ public:
 		menu_file_new_instance,
 		menu_file_private_instance,
 		menu_file_exit,
+		menu_file_open_sidecar,
 
 		menu_file_end,	// nothing beyond this point
 	};
@@ -383,6 +384,7 @@ public:
 		shortcut_goto			= Qt::CTRL + Qt::Key_G,
 		shortcut_extract		= Qt::CTRL + Qt::Key_E,
 		shortcut_reload			= Qt::Key_F5,
+		shortcut_open_sidecar	= Qt::CTRL + Qt::SHIFT + Qt::Key_R,
 
 		shortcut_first_file_sync= Qt::ALT + Qt::Key_Home, 
 		shortcut_last_file_sync	= Qt::ALT + Qt::Key_End,
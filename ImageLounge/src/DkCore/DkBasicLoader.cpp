@@ -28,6 +28,7 @@
 #include "DkBasicLoader.h"
 
 #include "DkMetaData.h"
+#include "DkMetaDataWriter.h"
 #include "DkImageContainer.h"
 #include "DkImageStorage.h"
 #include "DkSettings.h"
@@ -41,6 +42,7 @@
 #include <QImage>
 #include <QImageReader>
 #include <QImageWriter>
+#include <QSaveFile>
 #include <QNetworkReply>
 #include <QBuffer>
 #include <QNetworkProxyFactory>
@@ -48,9 +50,11 @@
 #include <QIcon>
 #include <QDebug>
 #include <QtConcurrentRun>
+#include <QThread>
 
 #include <qmath.h>
 #include <assert.h>
+#include <limits>
 
 // quazip
 #ifdef WITH_QUAZIP
@@ -102,6 +106,10 @@
 #include <QtWin>
 #endif //#ifdef Q_OS_WIN
 
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#endif
+
 
 #pragma warning(pop)
 
@@ -162,6 +170,7 @@ bool DkBasicLoader::loadGeneral(const QString& filePath, QSharedPointer<QByteArr
 	QString newSuffix = fInfo.suffix();
 
 	release();
+	mScaled = false;
 
 	if (mPageIdxDirty)
 		imgLoaded = loadPage();
@@ -175,8 +184,16 @@ bool DkBasicLoader::loadGeneral(const QString& filePath, QSharedPointer<QByteArr
 	// so we simply adopt the memory here
 	if (loadMetaData && mMetaData) {
 
+		// queued edits must be written before we read the file
+		if (!ba || ba->isEmpty())
+			DkMetaDataWriter::instance().write(filePath);
+
 		try {
-			mMetaData->readMetaData(filePath, ba);
+			// the container's metadata is parsed once (and shared with previews & thumbnails)
+			if (mSharedMetaData)
+				mMetaData = mSharedMetaData->metaData(filePath, ba);
+			else
+				mMetaData->readMetaData(filePath, ba);
 			
 #if QT_VERSION < QT_VERSION_CHECK(5, 11, 0)
 			// this is a workaroung for old Qt5 versions where jpgs with 'illegal' orientation=0 were not loaded
@@ -197,7 +214,13 @@ bool DkBasicLoader::loadGeneral(const QString& filePath, QSharedPointer<QByteArr
 		qDebug() << "metaData is NULL!";
 	}
 
-	QList<QByteArray> qtFormats = QImageReader::supportedImageFormats();
+	// the user skipped this image while we were reading the metadata
+	if (isCanceled()) {
+		qDebug() << "[Basic Loader] canceled before decoding" << fInfo.fileName();
+		return false;
+	}
+
+	QList<QByteArray> qtFormats = qtImageFormats();
 	qtFormats << "jpe";	// fixes #435 - thumbnail gets loaded in the RAW loader
 	QString suf = fInfo.suffix().toLower();
 
@@ -207,120 +230,147 @@ bool DkBasicLoader::loadGeneral(const QString& filePath, QSharedPointer<QByteArr
     if (!imgLoaded && ("drif" == suf || "yuv" == suf || "raw" == suf)) 
         imgLoaded = loadDrifFile(mFile, img, ba);
 
-	if (!imgLoaded && !fInfo.exists() && ba && !ba->isEmpty()) {
-		imgLoaded = img.loadFromData(*ba.data());
+	// identify the format by its signature and go straight to the right decoder
+	DkFormatProbe::Format fmt = DkFormatProbe::fmt_unknown;
+
+	if (!imgLoaded) {
+
+		DkTimer dtp;
+		fmt = DkFormatProbe::probe(DkFormatProbe::readHeader(mFile, ba), suf);
+		qDebug() << "[Basic Loader] probed" << fInfo.fileName() << "as" << DkFormatProbe::formatName(fmt) << "in" << dtp;
 
-		if (imgLoaded)
-			mLoader = qt_loader;
+		if (fmt != DkFormatProbe::fmt_unknown && hasProbedDecoder(fmt)) {
+			imgLoaded = loadProbedFile(fmt, mFile, img, ba, fast);
+			qInfo() << "[Basic Loader]" << DkFormatProbe::formatName(fmt) << "decoder" << (imgLoaded ? "succeeded in" : "failed in") << dtp;
+		}
 	}
 
-	// load large icons
-	if (!imgLoaded && suf == "ico") {
+	// unknown signature (e.g. drif, roh, tga, ico, svg) or no decoder for it (e.g. heif w/o plugin)
+	// -> fall back to the suffix cascade
+	if (!imgLoaded && (fmt == DkFormatProbe::fmt_unknown || !hasProbedDecoder(fmt)) && !isCanceled()) {
 
-		QIcon icon(mFile);
+		if (!imgLoaded && !fInfo.exists() && ba && !ba->isEmpty()) {
+			imgLoaded = img.loadFromData(*ba.data());
 
-		if (!icon.isNull()) {
-			img = icon.pixmap(QSize(256, 256)).toImage();
-			imgLoaded = true;
+			if (imgLoaded)
+				mLoader = qt_loader;
 		}
-	}
 
-	// default Qt loader
-	// here we just try those formats that are officially supported
-	if (!imgLoaded && qtFormats.contains(suf.toStdString().c_str()) || suf.isEmpty()) {
+		// load large icons
+		if (!imgLoaded && suf == "ico") {
 
-		// if image has Indexed8 + alpha channel -> we crash... sorry for that
-		if (!ba || ba->isEmpty())
-			imgLoaded = img.load(mFile, suf.toStdString().c_str());
-		else
-			imgLoaded = img.loadFromData(*ba.data(), suf.toStdString().c_str());	// toStdString() in order get 1 byte per char
+			QIcon icon(mFile);
 
-		if (imgLoaded) mLoader = qt_loader;
-	}
+			if (!icon.isNull()) {
+				img = icon.pixmap(QSize(256, 256)).toImage();
+				imgLoaded = true;
+			}
+		}
+
+		// default Qt loader
+		// here we just try those formats that are officially supported
+		if (!imgLoaded && qtFormats.contains(suf.toStdString().c_str()) || suf.isEmpty()) {
+
+			// if image has Indexed8 + alpha channel -> we crash... sorry for that
+			if (!ba || ba->isEmpty())
+				imgLoaded = img.load(mFile, suf.toStdString().c_str());
+			else
+				imgLoaded = img.loadFromData(*ba.data(), suf.toStdString().c_str());	// toStdString() in order get 1 byte per char
 
-	// OpenCV Tiff loader - supports jpg compressed tiffs
-	if (!imgLoaded && newSuffix.contains(QRegExp("(tif|tiff)", Qt::CaseInsensitive))) {
+			if (imgLoaded) mLoader = qt_loader;
+		}
+
+		// OpenCV Tiff loader - supports jpg compressed tiffs
+		if (!imgLoaded && newSuffix.contains(QRegExp("(tif|tiff)", Qt::CaseInsensitive))) {
 
-		imgLoaded = loadTIFFile(mFile, img, ba);
+			imgLoaded = loadTIFFile(mFile, img, ba);
 		
-		if (imgLoaded)	mLoader = tif_loader;
-	}
+			if (imgLoaded)	mLoader = tif_loader;
+		}
 
-	// PSD loader
-	if (!imgLoaded) {
+		// PSD loader
+		if (!imgLoaded) {
 
-		imgLoaded = loadPSDFile(mFile, img, ba);
-		if (imgLoaded) mLoader = psd_loader;
-	}
+			imgLoaded = loadPSDFile(mFile, img, ba);
+			if (imgLoaded) mLoader = psd_loader;
+		}
 
 #if QT_VERSION < 0x050000	// >DIR: qt5 ships with webp : ) [23.4.2015 markus]
-	// WEBP loader
-	if (!imgLoaded) {
+		// WEBP loader
+		if (!imgLoaded) {
 
-		imgLoaded = loadWebPFile(file, ba);
-		if (imgLoaded) loader = webp_loader;
-	}
+			imgLoaded = loadWebPFile(file, ba);
+			if (imgLoaded) loader = webp_loader;
+		}
 #endif
 
-	// RAW loader
-	if (!imgLoaded && !qtFormats.contains(suf.toStdString().c_str())) {
+		// RAW loader
+		if (!imgLoaded && !qtFormats.contains(suf.toStdString().c_str())) {
 		
-		// TODO: sometimes (e.g. _DSC6289.tif) strange opencv errors are thrown - catch them!
-		// load raw files
-		imgLoaded = loadRawFile(mFile, img, ba, fast);
-		if (imgLoaded) mLoader = raw_loader;
-	}
+			// TODO: sometimes (e.g. _DSC6289.tif) strange opencv errors are thrown - catch them!
+			// load raw files
+			imgLoaded = loadRawFile(mFile, img, ba, fast);
+			if (imgLoaded) mLoader = raw_loader;
+		}
 
-	// TGA loader
-	if (!imgLoaded && newSuffix.contains(QRegExp("(tga)", Qt::CaseInsensitive))) {
+		// TGA loader
+		if (!imgLoaded && newSuffix.contains(QRegExp("(tga)", Qt::CaseInsensitive))) {
 
-		imgLoaded = loadTgaFile(mFile, img, ba);
+			imgLoaded = loadTgaFile(mFile, img, ba);
 
-		if (imgLoaded) mLoader = tga_loader;		// TODO: add tga loader
-	}
+			if (imgLoaded) mLoader = tga_loader;		// TODO: add tga loader
+		}
 
-	QByteArray lba;
+		QSharedPointer<QByteArray> lba(new QByteArray());
 
-	// default Qt loader
-	if (!imgLoaded && !newSuffix.contains(QRegExp("(roh)", Qt::CaseInsensitive))) {
+		// default Qt loader
+		if (!imgLoaded && !newSuffix.contains(QRegExp("(roh)", Qt::CaseInsensitive))) {
 
-		// if we first load files to buffers, we can additionally load images with wrong extensions (rainer bugfix : )
-		// TODO: add warning here
-		loadFileToBuffer(mFile, lba);
-		imgLoaded = img.loadFromData(lba);
+			// if we first load files to buffers, we can additionally load images with wrong extensions (rainer bugfix : )
+			// TODO: add warning here
+			lba = (ba && !ba->isEmpty()) ? ba : loadFileToBuffer(mFile);
+			imgLoaded = img.loadFromData(*lba);
 		
-		if (imgLoaded)
-			qWarning() << "The image seems to have a wrong extension";
+			if (imgLoaded)
+				qWarning() << "The image seems to have a wrong extension";
 		
-		if (imgLoaded) mLoader = qt_loader;
-	} 
+			if (imgLoaded) mLoader = qt_loader;
+		} 
 
-	// add marker to fix broken panorama images from SAMSUNG
-	// see: https://github.com/nomacs/nomacs/issues/254
-	if (!imgLoaded && newSuffix.contains(QRegExp("(jpg|jpeg|jpe)", Qt::CaseInsensitive))) {
+		// add marker to fix broken panorama images from SAMSUNG
+		// see: https://github.com/nomacs/nomacs/issues/254
+		if (!imgLoaded && newSuffix.contains(QRegExp("(jpg|jpeg|jpe)", Qt::CaseInsensitive))) {
 
-		// prefer external buffer
-		QByteArray baf = DkImage::fixSamsungPanorama(ba && !ba->isEmpty() ? *ba : lba);
+			// prefer external buffer
+			QByteArray baf = DkImage::fixSamsungPanorama(ba && !ba->isEmpty() ? *ba : *lba);
 
-		if (!baf.isEmpty())
-			imgLoaded = img.loadFromData(baf, suf.toStdString().c_str());
+			if (!baf.isEmpty())
+				imgLoaded = img.loadFromData(baf, suf.toStdString().c_str());
 
-		if (imgLoaded) mLoader = qt_loader;
-	}
+			if (imgLoaded) mLoader = qt_loader;
+		}
 
-	// this loader is a bit buggy -> be carefull
-	if (!imgLoaded && newSuffix.contains(QRegExp("(roh)", Qt::CaseInsensitive))) {
+		// this loader is a bit buggy -> be carefull
+		if (!imgLoaded && newSuffix.contains(QRegExp("(roh)", Qt::CaseInsensitive))) {
 		
-		imgLoaded = loadRohFile(mFile, img, ba);
-		if (imgLoaded) mLoader = roh_loader;
-	} 
+			imgLoaded = loadRohFile(mFile, img, ba);
+			if (imgLoaded) mLoader = roh_loader;
+		} 
+
+		// this loader is for OpenCV cascade training files
+		if (!imgLoaded && newSuffix.contains(QRegExp("(vec)", Qt::CaseInsensitive))) {
 
-	// this loader is for OpenCV cascade training files
-	if (!imgLoaded && newSuffix.contains(QRegExp("(vec)", Qt::CaseInsensitive))) {
+			imgLoaded = loadOpenCVVecFile(mFile, img, ba);
+			if (imgLoaded) mLoader = roh_loader;
+		} 
+	}
 
-		imgLoaded = loadOpenCVVecFile(mFile, img, ba);
-		if (imgLoaded) mLoader = roh_loader;
-	} 
+	// don't waste time on post-processing if nobody needs the image anymore
+	if (isCanceled()) {
+		qDebug() << "[Basic Loader] canceled" << fInfo.fileName() << "after" << dt;
+		mPageIdxDirty = false;
+		return false;
+	}
 
 	// tiff things
 	if (imgLoaded && !mPageIdxDirty)
@@ -444,6 +494,7 @@ bool DkBasicLoader::loadRawFile(const QString& filePath, QImage& img, QSharedPoi
 	
 	DkRawLoader rawLoader(filePath, mMetaData);
 	rawLoader.setLoadFast(fast);
+	rawLoader.setCancelToken(mCancelToken);
 
 	bool success = rawLoader.load(ba);
 
@@ -453,6 +504,192 @@ bool DkBasicLoader::loadRawFile(const QString& filePath, QImage& img, QSharedPoi
 	return success;
 }
 
+/**
+ * Loads the image using Qt's image reader with an explicit format.
+ * The format is taken from the file signature - not from the suffix.
+ * @param format the Qt image format (e.g. jpg, png)
+ * @param ba the file buffer (can be empty)
+ * @return bool true if the file could be loaded.
+ **/ 
+bool DkBasicLoader::loadQtFile(const QString& filePath, QImage& img, const QByteArray& format, QSharedPointer<QByteArray> ba) {
+
+	if (format.isEmpty() || !qtImageFormats().contains(format))
+		return false;
+
+	// libjpeg can decode at 1/2, 1/4 and 1/8 of the resolution
+	if (mMinSize.isValid() && format == "jpg")
+		return loadScaledQtFile(filePath, img, format, ba);
+
+	if (!ba || ba->isEmpty())
+		return img.load(filePath, format.constData());
+
+	return img.loadFromData(*ba.data(), format.constData());
+}
+
+/**
+ * Loads the image at a reduced resolution.
+ * The image is decoded such that it is at least as large as the 
+ * size defined by setMinSize(). If the handler supports scaled decoding 
+ * (e.g. libjpeg's IDCT scaling), just a fraction of the pixels is decoded.
+ * @param format the Qt image format (e.g. jpg, png)
+ * @param ba the file buffer (can be empty)
+ * @return bool true if the file could be loaded.
+ **/ 
+bool DkBasicLoader::loadScaledQtFile(const QString& filePath, QImage& img, const QByteArray& format, QSharedPointer<QByteArray> ba) {
+
+	QBuffer buffer;
+	QImageReader reader;
+
+	if (!ba || ba->isEmpty())
+		reader.setFileName(filePath);
+	else {
+		buffer.setData(*ba.data());	// implicitly shared - no copy
+		buffer.open(QIODevice::ReadOnly);
+		reader.setDevice(&buffer);
+	}
+	reader.setFormat(format);
+
+	QSize fullSize = reader.size();
+
+	if (fullSize.isValid() && reader.supportsOption(QImageIOHandler::ScaledSize)) {
+
+		QSize minSize = mMinSize;
+		int orientation = mMetaData && mMetaData->isLoaded() ? mMetaData->getOrientationDegree() : -1;
+
+		// the min size refers to the rotated image
+		if (!DkSettingsManager::param().metaData().ignoreExifOrientation && (orientation == 90 || orientation == -90 || orientation == 270))
+			minSize.transpose();
+
+		QSize targetSize = fullSize.scaled(minSize, mMinSizeMode);
+
+		int denom = 1;
+		while (denom < 8 && 
+			fullSize.width() / (denom * 2) >= targetSize.width() && 
+			fullSize.height() / (denom * 2) >= targetSize.height())
+			denom *= 2;
+
+		// request exactly what libjpeg delivers (it rounds up) - so Qt does not resample
+		if (denom > 1) {
+			reader.setScaledSize(QSize((fullSize.width() + denom - 1) / denom, (fullSize.height() + denom - 1) / denom));
+			mScaled = true;
+			qDebug() << "[Basic Loader] decoding at 1 /" << denom << "of" << fullSize;
+		}
+	}
+
+	return reader.read(&img);
+}
+
+/**
+ * Returns true if a decoder is available for the probed format.
+ * Qt formats need their image plugin (e.g. heif, jp2) - if it is 
+ * missing, the suffix cascade might still find a decoder.
+ * @param fmt the format identified by DkFormatProbe
+ * @return bool true if loadProbedFile() can decode the format.
+ **/ 
+bool DkBasicLoader::hasProbedDecoder(DkFormatProbe::Format fmt) {
+
+	switch (fmt) {
+	case DkFormatProbe::fmt_unknown:
+		return false;
+	case DkFormatProbe::fmt_tiff:
+	case DkFormatProbe::fmt_psd:
+	case DkFormatProbe::fmt_raw:
+		return true;		// we have our own decoders
+	default:
+		return qtImageFormats().contains(DkFormatProbe::qtFormat(fmt));
+	}
+}
+
+/**
+ * Returns Qt's image formats.
+ * The list is cached - it is needed for every decode.
+ **/ 
+const QList<QByteArray>& DkBasicLoader::qtImageFormats() {
+
+	static const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+	return formats;
+}
+
+/**
+ * Decodes the image with the loader that matches its signature.
+ * Other loaders are not tried if this fails: the file is most likely corrupt
+ * (formats without decoder are not probed - see hasProbedDecoder()).
+ * @param fmt the format identified by DkFormatProbe
+ * @return bool true if the file could be loaded.
+ **/ 
+bool DkBasicLoader::loadProbedFile(DkFormatProbe::Format fmt, const QString& filePath, QImage& img, QSharedPointer<QByteArray> ba, bool fast) {
+
+	bool imgLoaded = false;
+
+	switch (fmt) {
+
+	case DkFormatProbe::fmt_jpg: {
+
+		imgLoaded = loadQtFile(filePath, img, DkFormatProbe::qtFormat(fmt), ba);
+
+		// add marker to fix broken panorama images from SAMSUNG
+		// see: https://github.com/nomacs/nomacs/issues/254
+		if (!imgLoaded) {
+			QSharedPointer<QByteArray> baf(new QByteArray(DkImage::fixSamsungPanorama(ba && !ba->isEmpty() ? *ba : *loadFileToBuffer(filePath))));
+
+			if (!baf->isEmpty())
+				imgLoaded = loadQtFile(filePath, img, DkFormatProbe::qtFormat(fmt), baf);
+		}
+
+		if (imgLoaded) mLoader = qt_loader;
+		break;
+	}
+	case DkFormatProbe::fmt_tiff: {
+
+		// Qt's tiff plugin decodes single threaded - large tiffs are decoded in parallel by libtiff
+		const qint64 largeTiffSize = 64 * 1024 * 1024;
+		qint64 fileSize = ba && !ba->isEmpty() ? ba->size() : QFileInfo(filePath).size();
+
+		if (fileSize > largeTiffSize) {
+			imgLoaded = loadTIFFile(filePath, img, ba);
+			if (imgLoaded) mLoader = tif_loader;
+		}
+
+		if (!imgLoaded) {
+			imgLoaded = loadQtFile(filePath, img, DkFormatProbe::qtFormat(fmt), ba);
+			if (imgLoaded) mLoader = qt_loader;
+		}
+
+		// libtiff loader - supports jpg compressed tiffs
+		if (!imgLoaded && fileSize <= largeTiffSize) {
+			imgLoaded = loadTIFFile(filePath, img, ba);
+			if (imgLoaded) mLoader = tif_loader;
+		}
+
+		// some RAW formats (e.g. DNG) are tiff containers
+		if (!imgLoaded && !QFileInfo(filePath).suffix().contains(QRegExp("(tif|tiff)", Qt::CaseInsensitive))) {
+			imgLoaded = loadRawFile(filePath, img, ba, fast);
+			if (imgLoaded) mLoader = raw_loader;
+		}
+		break;
+	}
+	case DkFormatProbe::fmt_psd:
+		imgLoaded = loadPSDFile(filePath, img, ba);
+		if (imgLoaded) mLoader = psd_loader;
+
+		if (!imgLoaded) {
+			imgLoaded = loadQtFile(filePath, img, DkFormatProbe::qtFormat(fmt), ba);
+			if (imgLoaded) mLoader = qt_loader;
+		}
+		break;
+	case DkFormatProbe::fmt_raw:
+		imgLoaded = loadRawFile(filePath, img, ba, fast);
+		if (imgLoaded) mLoader = raw_loader;
+		break;
+	default:
+		imgLoaded = loadQtFile(filePath, img, DkFormatProbe::qtFormat(fmt), ba);
+		if (imgLoaded) mLoader = qt_loader;
+		break;
+	}
+
+	return imgLoaded;
+}
+
 #ifdef Q_OS_WIN
 bool DkBasicLoader::loadPSDFile(const QString&, QImage&, QSharedPointer<QByteArray>) const {
 #else
@@ -509,58 +746,20 @@ bool DkBasicLoader::loadTIFFile(const QString& filePath, QImage& img, QSharedPoi
 	oldErrorHandler = TIFFSetErrorHandler(NULL);
 
 	DkTimer dt;
-	TIFF* tiff = 0;
-
-
-// TODO: currently TIFFStreamOpen can only be linked on Windows?!
-#if QT_VERSION >= QT_VERSION_CHECK(5,5,0) && defined(Q_OS_WIN)
-
-	std::istringstream is(ba ? ba->toStdString() : "");
-
-	if (ba) 
-		tiff = TIFFStreamOpen("MemTIFF", &is);
-
-	// fallback to direct loading
-	if (!tiff)
-		tiff = TIFFOpen(filePath.toLatin1(), "r");
 
 	// loading from buffer allows us to load files with non-latin names
-	QSharedPointer<QByteArray> bal;
-	if (!tiff)
-		bal = loadFileToBuffer(filePath);
-
-	std::istringstream isl(bal ? bal->toStdString() : "");
-
-	if (bal)
-		tiff = TIFFStreamOpen("MemTIFF", &isl);
-#else
-	tiff = TIFFOpen(filePath.toLatin1(), "r");
-#endif
-
-	if (!tiff)
-		return success;
-
-	uint32 width = 0;
-	uint32 height = 0;
-
-	TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
-	TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
-
-	// init the qImage
-	img = QImage(width, height, QImage::Format_ARGB32);
-
-	const int stopOnError = 1;
-	success = TIFFReadRGBAImageOriented(tiff, width, height, reinterpret_cast<uint32 *>(img.bits()), ORIENTATION_TOPLEFT, stopOnError) != 0;
-
-	if (success) {
-		for (uint32 y = 0; y<height; ++y)
-			convert32BitOrder(img.scanLine(y), width);
-	}
+	// (the buffer is memory mapped - so this does not copy the file)
+	// files that do not fit into a buffer (> 2 GB) are read from the file
+	if (!ba || ba->isEmpty())
+		ba = loadFileToBuffer(filePath);
 
-	TIFFClose(tiff);
+	success = loadTIFFPage(ba, filePath, 1, img);
 
 	TIFFSetWarningHandler(oldWarningHandler);
-	TIFFSetWarningHandler(oldErrorHandler);
+	TIFFSetErrorHandler(oldErrorHandler);
+
+	if (success)
+		qDebug() << "[TIFF] loaded in" << dt;
 
 	return success;
 
@@ -823,6 +1022,44 @@ int DkBasicLoader::historyIndex() const {
 	return mImageIndex;
 }
 
+/**
+ * Allows loaders to decode the image at a reduced resolution.
+ * The image loaded is at least as large as the image size scaled 
+ * to size (with respect to mode). Currently this is supported 
+ * for JPEGs only. Pass an invalid size to load the full resolution.
+ * @param size the minimal size needed (e.g. the thumbnail size)
+ * @param mode Qt::KeepAspectRatio fits the image into size, Qt::KeepAspectRatioByExpanding covers size
+ **/ 
+void DkBasicLoader::setMinSize(const QSize& size, Qt::AspectRatioMode mode) {
+	mMinSize = size;
+	mMinSizeMode = mode;
+}
+
+QSize DkBasicLoader::minSize() const {
+	return mMinSize;
+}
+
+/**
+ * Returns true if the current image was decoded at a reduced resolution.
+ * @return bool true if the image is smaller than the file's resolution.
+ **/ 
+bool DkBasicLoader::isScaled() const {
+	return mScaled;
+}
+
+/**
+ * Sets the token that allows for canceling running decodes.
+ * loadGeneral() returns false as soon as it notices that the token was canceled.
+ * @param token the cancel token (or an empty pointer)
+ **/ 
+void DkBasicLoader::setCancelToken(const QSharedPointer<DkCancelToken>& token) {
+	mCancelToken = token;
+}
+
+bool DkBasicLoader::isCanceled() const {
+	return DkCancelToken::isCanceled(mCancelToken);
+}
+
 void DkBasicLoader::setMinHistorySize(int size) {
 	mMinHistorySize = size;
 }
@@ -858,13 +1095,7 @@ QSharedPointer<QByteArray> DkBasicLoader::loadFileToBuffer(const QString& filePa
 		return DkZipContainer::extractImage(DkZipContainer::decodeZipFile(filePath), DkZipContainer::decodeImageFile(filePath));
 #endif
 
-	QFile file(filePath);
-	file.open(QIODevice::ReadOnly);
-
-	QSharedPointer<QByteArray> ba(new QByteArray(file.readAll()));
-	file.close();
-
-	return ba;
+	return DkMappedBuffer::read(filePath);
 }
 
 bool DkBasicLoader::writeBufferToFile(const QString& fileInfo, const QSharedPointer<QByteArray> ba) const {
@@ -872,14 +1103,29 @@ bool DkBasicLoader::writeBufferToFile(const QString& fileInfo, const QSharedPoin
 	if (!ba || ba->isEmpty())
 		return false;
 
-	QFile file(fileInfo);
-	file.open(QIODevice::WriteOnly);
-	qint64 bytesWritten = file.write(*ba.data(), ba->size());
-	file.close();
-	qDebug() << "[DkBasicLoader] buffer saved, bytes written: " << bytesWritten;
+	// the file might be mapped (see DkMappedBuffer)
+	// so we must not truncate it - QSaveFile writes a new file and renames it
+	// there is no direct write fallback: if the folder is not writable, saving fails
+	QSaveFile file(fileInfo);
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "[DkBasicLoader] cannot write" << fileInfo << "-" << file.errorString();
+		return false;
+	}
+
+	qint64 bytesWritten = file.write(ba->constData(), ba->size());
+
+	if (!bytesWritten || bytesWritten == -1) {
+		file.cancelWriting();
+		return false;
+	}
 
-	if (!bytesWritten || bytesWritten == -1)
+	if (!file.commit()) {
+		qWarning() << "[DkBasicLoader] cannot write" << fileInfo << "-" << file.errorString();
 		return false;
+	}
+
+	qDebug() << "[DkBasicLoader] buffer saved, bytes written: " << bytesWritten;
 
 	return true;
 }
@@ -985,100 +1231,398 @@ bool DkBasicLoader::loadPageAt(int pageIdx) {
 	oldErrorHandler = TIFFSetErrorHandler(NULL); 
 
 	DkTimer dt;
-	TIFF* tiff = TIFFOpen(mFile.toLatin1(), "r");
 
-#if QT_VERSION >= QT_VERSION_CHECK(5,5,0) && defined(Q_OS_WIN)
+	QImage img;
+	imgLoaded = loadTIFFPage(loadFileToBuffer(mFile), mFile, pageIdx, img);
 
-	// loading from buffer allows us to load files with non-latin names
-	QSharedPointer<QByteArray> ba;
-	if (!tiff)
-		ba = loadFileToBuffer(mFile);
-	
-	std::istringstream is(ba ? ba->toStdString() : "");
-	if (ba)
-		tiff = TIFFStreamOpen("MemTIFF", &is);
-#endif
+	TIFFSetWarningHandler(oldWarningHandler);
+	TIFFSetErrorHandler(oldErrorHandler);
 
-	if (!tiff)
+	if (!imgLoaded)
 		return imgLoaded;
 
-	uint32 width = 0;
-	uint32 height = 0;
+	setEditImage(img, tr("Original Image"));
+#else
+	Q_UNUSED(pageIdx);
+#endif
 
-	// go to current directory
-	for (int idx = 1; idx < pageIdx; idx++) {
 
-		if (!TIFFReadDirectory(tiff))
-			return false;
+	return imgLoaded;
+}
+
+bool DkBasicLoader::setPageIdx(int skipIdx) {
+
+	// do nothing if we don't have tiff pages
+	if (mNumPages <= 1)
+		return false;
+
+	mPageIdxDirty = false;
+
+	int newPageIdx = mPageIdx + skipIdx;
+
+	if (newPageIdx > 0 && newPageIdx <= mNumPages) {
+		mPageIdxDirty = true;
+		mPageIdx = newPageIdx;
+	}
+
+	return mPageIdxDirty;
+}
+
+void DkBasicLoader::resetPageIdx() {
+
+	mPageIdxDirty = false;
+	mPageIdx = 1;
+}
+
+void DkBasicLoader::convert32BitOrder(void *buffer, int width) const {
+
+#ifdef WITH_LIBTIFF
+	// code from Qt QTiffHandler
+	uint32 *target = reinterpret_cast<uint32 *>(buffer);
+	for (int32 x=0; x<width; ++x) {
+		uint32 p = target[x];
+		// convert between ARGB and ABGR
+		target[x] = (p & 0xff000000)
+			| ((p & 0x00ff0000) >> 16)
+			| (p & 0x0000ff00)
+			| ((p & 0x000000ff) << 16);
+	}
+#else
+	Q_UNUSED(buffer);
+	Q_UNUSED(width);
+#endif
+}
+
+#ifdef WITH_LIBTIFF
+// libtiff client procs that read tiffs from a (memory mapped) buffer
+struct DkTiffMemHandle {
+	const char* data;
+	toff_t size;
+	toff_t pos;
+};
+
+static tmsize_t tiffMemRead(thandle_t handle, void* buf, tmsize_t size) {
+
+	DkTiffMemHandle* h = static_cast<DkTiffMemHandle*>(handle);
+
+	if (h->pos >= h->size || size <= 0)
+		return 0;
+
+	tmsize_t n = (tmsize_t)qMin((toff_t)size, h->size - h->pos);
+	memcpy(buf, h->data + h->pos, n);
+	h->pos += n;
+
+	return n;
+}
+
+static tmsize_t tiffMemWrite(thandle_t, void*, tmsize_t) {
+	return 0;	// read only
+}
+
+static toff_t tiffMemSeek(thandle_t handle, toff_t offset, int whence) {
+
+	DkTiffMemHandle* h = static_cast<DkTiffMemHandle*>(handle);
+
+	// toff_t is unsigned - negative offsets wrap around which is what we want
+	switch (whence) {
+	case SEEK_SET: h->pos = offset; break;
+	case SEEK_CUR: h->pos += offset; break;
+	case SEEK_END: h->pos = h->size + offset; break;
 	}
+
+	return h->pos;
+}
+
+static int tiffMemClose(thandle_t) {
+	return 0;
+}
+
+static toff_t tiffMemSize(thandle_t handle) {
+	return static_cast<DkTiffMemHandle*>(handle)->size;
+}
+
+static int tiffMemMap(thandle_t handle, void** base, toff_t* size) {
+
+	// libtiff reads uncompressed strips directly from the buffer
+	DkTiffMemHandle* h = static_cast<DkTiffMemHandle*>(handle);
+	*base = const_cast<char*>(h->data);
+	*size = h->size;
+
+	return 1;
+}
+
+static void tiffMemUnmap(thandle_t, void*, toff_t) {
+}
+
+// libtiff client procs that read tiffs from a QFile (files that cannot be mapped to a QByteArray)
+static tmsize_t tiffFileRead(thandle_t handle, void* buf, tmsize_t size) {
+
+	qint64 n = static_cast<QFile*>(handle)->read(static_cast<char*>(buf), size);
+	return n < 0 ? 0 : (tmsize_t)n;
+}
+
+static toff_t tiffFileSeek(thandle_t handle, toff_t offset, int whence) {
+
+	QFile* file = static_cast<QFile*>(handle);
+	qint64 pos = (qint64)offset;
+
+	switch (whence) {
+	case SEEK_CUR: pos += file->pos(); break;
+	case SEEK_END: pos += file->size(); break;
+	}
+
+	if (!file->seek(pos))
+		return (toff_t)-1;
+
+	return (toff_t)pos;
+}
+
+static toff_t tiffFileSize(thandle_t handle) {
+	return (toff_t)static_cast<QFile*>(handle)->size();
+}
+
+static int tiffFileMap(thandle_t, void**, toff_t*) {
+	return 0;	// libtiff reads the strips instead
+}
+
+/**
+ * Opens a tiff page from the buffer - or from the file if the buffer is empty.
+ * @param ba the tiff buffer
+ * @param file the tiff file (it must live as long as the TIFF handle)
+ * @param handle the buffer's handle (it must live as long as the TIFF handle)
+ * @param pageIdx the page (starting with 1)
+ * @return TIFF* the TIFF handle or 0 if the page could not be opened
+ **/ 
+static TIFF* tiffOpen(const QSharedPointer<QByteArray>& ba, QFile& file, DkTiffMemHandle& handle, int pageIdx) {
+
+	TIFF* tiff = 0;
+
+	if (ba && !ba->isEmpty()) {
+		handle.data = ba->constData();
+		handle.size = (toff_t)ba->size();
+		handle.pos = 0;
+
+		tiff = TIFFClientOpen("MemTIFF", "r", (thandle_t)&handle,
+			tiffMemRead, tiffMemWrite, tiffMemSeek, tiffMemClose, tiffMemSize, tiffMemMap, tiffMemUnmap);
+	}
+	else if (file.isOpen() ? file.seek(0) : file.open(QIODevice::ReadOnly)) {
+		tiff = TIFFClientOpen("FileTIFF", "r", (thandle_t)&file,
+			tiffFileRead, tiffMemWrite, tiffFileSeek, tiffMemClose, tiffFileSize, tiffFileMap, tiffMemUnmap);
+	}
+
+	if (tiff && pageIdx > 1 && !TIFFSetDirectory(tiff, (uint16)(pageIdx - 1))) {
+		TIFFClose(tiff);
+		return 0;
+	}
+
+	return tiff;
+}
+
+// converts libtiff's ABGR to Qt's ARGB while copying
+static inline void tiffToARGB(const uint32* src, uint32* dst, uint32 width) {
+
+	for (uint32 x = 0; x < width; ++x) {
+		uint32 p = src[x];
+		dst[x] = (p & 0xff00ff00)
+			| ((p & 0x00ff0000) >> 16)
+			| ((p & 0x000000ff) << 16);
+	}
+}
+
+/**
+ * Decodes the strips (or tiles) [firstBlock lastBlock) into the image.
+ * Every call opens its own TIFF handle - so it can be run in parallel.
+ * @param ba the tiff buffer
+ * @param filePath the tiff file - it is read if the buffer is empty
+ * @param pageIdx the page (starting with 1)
+ * @param firstBlock the first strip/tile
+ * @param lastBlock the strip/tile after the last one decoded
+ * @param bits the image's first scanline (ARGB32)
+ * @param bytesPerLine the image's bytes per line
+ * @param token the decoding stops if this token is canceled
+ * @return bool true if all blocks could be decoded
+ **/ 
+static bool tiffDecodeBlocks(const QSharedPointer<QByteArray>& ba, const QString& filePath, int pageIdx, uint32 firstBlock, uint32 lastBlock, uchar* bits, int bytesPerLine, const QSharedPointer<DkCancelToken>& token) {
+
+	QFile file(filePath);
+	DkTiffMemHandle handle = {0, 0, 0};
+	TIFF* tiff = tiffOpen(ba, file, handle, pageIdx);
+
+	if (!tiff)
+		return false;
+
+	uint32 width = 0, height = 0;
 	TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
 	TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
 
-	// init the qImage
-	QImage img = QImage(width, height, QImage::Format_ARGB32);
+	bool success = true;
 
-	const int stopOnError = 1;
-	imgLoaded = TIFFReadRGBAImageOriented(tiff, width, height, reinterpret_cast<uint32 *>(img.bits()), ORIENTATION_TOPLEFT, stopOnError) != 0;
+	if (TIFFIsTiled(tiff)) {
+
+		uint32 tw = 0, th = 0;
+		TIFFGetField(tiff, TIFFTAG_TILEWIDTH, &tw);
+		TIFFGetField(tiff, TIFFTAG_TILELENGTH, &th);
+
+		uint32 tilesAcross = (width + tw - 1) / tw;
+		QVector<uint32> raster(tw * th);
+
+		for (uint32 b = firstBlock; b < lastBlock && success; b++) {
+
+			uint32 col = (b % tilesAcross) * tw;
+			uint32 row = (b / tilesAcross) * th;
+			success = !DkCancelToken::isCanceled(token) && TIFFReadRGBATile(tiff, col, row, raster.data()) != 0;
+
+			uint32 cols = qMin(tw, width - col);
+			uint32 rows = qMin(th, height - row);
+
+			// the raster's origin is bottom-left
+			for (uint32 y = 0; success && y < rows; y++)
+				tiffToARGB(raster.constData() + (th - 1 - y) * tw, reinterpret_cast<uint32*>(bits + (row + y) * bytesPerLine) + col, cols);
+		}
+	}
+	else {
+
+		uint32 rps = 0;
+		TIFFGetFieldDefaulted(tiff, TIFFTAG_ROWSPERSTRIP, &rps);
+		rps = qMin(rps, height);
+
+		QVector<uint32> raster(width * rps);
 
-	if (imgLoaded) {
-		for (uint32 y=0; y<height; ++y)
-			convert32BitOrder(img.scanLine(y), width);
+		for (uint32 b = firstBlock; b < lastBlock && success; b++) {
+
+			uint32 row = b * rps;
+			success = !DkCancelToken::isCanceled(token) && TIFFReadRGBAStrip(tiff, row, raster.data()) != 0;
+
+			uint32 rows = qMin(rps, height - row);
+
+			// the raster's origin is bottom-left
+			for (uint32 y = 0; success && y < rows; y++)
+				tiffToARGB(raster.constData() + (rows - 1 - y) * width, reinterpret_cast<uint32*>(bits + (row + y) * bytesPerLine), width);
+		}
 	}
 
-	TIFFClose(tiff);
+	TIFFClose(tiff);
+
+	return success;
+}
+
+/**
+ * Decodes a tiff page at once (single threaded).
+ * @param tiff the TIFF handle
+ * @param img the image - it needs to have the page's size
+ * @return bool true if the page could be decoded
+ **/ 
+static bool tiffDecodeImage(TIFF* tiff, QImage& img) {
+
+	const int stopOnError = 1;
+	bool success = TIFFReadRGBAImageOriented(tiff, img.width(), img.height(), reinterpret_cast<uint32 *>(img.bits()), ORIENTATION_TOPLEFT, stopOnError) != 0;
+
+	// libtiff's ABGR -> ARGB
+	for (int y = 0; success && y < img.height(); ++y)
+		tiffToARGB(reinterpret_cast<const uint32*>(img.constScanLine(y)), reinterpret_cast<uint32*>(img.scanLine(y)), img.width());
+
+	return success;
+}
+#endif
+
+/**
+ * Loads a tiff page from the buffer.
+ * If the buffer is empty (e.g. files > 2 GB), the page is read from the file.
+ * Images with several strips or tiles are decoded in parallel.
+ * Every thread decodes a range of strips (tiles) straight into the
+ * image's scanlines.
+ * @param ba the tiff buffer
+ * @param filePath the tiff file
+ * @param pageIdx the page to be loaded (starting with 1)
+ * @param img the loaded image
+ * @return bool true if the page could be loaded
+ **/ 
+bool DkBasicLoader::loadTIFFPage(const QSharedPointer<QByteArray>& ba, const QString& filePath, int pageIdx, QImage& img) const {
+
+#ifdef WITH_LIBTIFF
+
+	QFile file(filePath);
+	DkTiffMemHandle handle = {0, 0, 0};
+	TIFF* tiff = tiffOpen(ba, file, handle, pageIdx);
+
+	if (!tiff)
+		return false;
+
+	uint32 width = 0;
+	uint32 height = 0;
+	uint16 orientation = ORIENTATION_TOPLEFT;
+	uint16 planarConfig = PLANARCONFIG_CONTIG;
+
+	TIFFGetField(tiff, TIFFTAG_IMAGEWIDTH, &width);
+	TIFFGetField(tiff, TIFFTAG_IMAGELENGTH, &height);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_ORIENTATION, &orientation);
+	TIFFGetFieldDefaulted(tiff, TIFFTAG_PLANARCONFIG, &planarConfig);
+
+	// separate planes have one block per plane & strip (tile) - they are decoded at once
+	uint32 numBlocks = TIFFIsTiled(tiff) ? TIFFNumberOfTiles(tiff) : TIFFNumberOfStrips(tiff);
 
-	TIFFSetWarningHandler(oldWarningHandler);
-	TIFFSetWarningHandler(oldErrorHandler);
+	// init the qImage
+	img = QImage(width, height, QImage::Format_ARGB32);
 
-	setEditImage(img, tr("Original Image"));
-#else
-	Q_UNUSED(pageIdx);
-#endif
+	if (img.isNull()) {
+		TIFFClose(tiff);
+		return false;
+	}
 
+	bool success = false;
 
-	return imgLoaded;
-}
+	// single strip images (or exotic layouts) are decoded at once
+	if (numBlocks <= 1 || orientation != ORIENTATION_TOPLEFT || planarConfig != PLANARCONFIG_CONTIG) {
 
-bool DkBasicLoader::setPageIdx(int skipIdx) {
+		success = tiffDecodeImage(tiff, img);
+		TIFFClose(tiff);
+		return success;
+	}
 
-	// do nothing if we don't have tiff pages
-	if (mNumPages <= 1)
-		return false;
+	TIFFClose(tiff);
 
-	mPageIdxDirty = false;
+	uchar* bits = img.bits();
+	int bytesPerLine = img.bytesPerLine();
 
-	int newPageIdx = mPageIdx + skipIdx;
+	uint32 numThreads = qMax((uint32)1, qMin((uint32)QThread::idealThreadCount(), numBlocks));
+	uint32 blocksPerThread = (numBlocks + numThreads - 1) / numThreads;
 
-	if (newPageIdx > 0 && newPageIdx <= mNumPages) {
-		mPageIdxDirty = true;
-		mPageIdx = newPageIdx;
+	QVector<QFuture<bool> > futures;
+	for (uint32 first = blocksPerThread; first < numBlocks; first += blocksPerThread) {
+		
+		uint32 last = qMin(first + blocksPerThread, numBlocks);
+		QSharedPointer<DkCancelToken> token = mCancelToken;
+		futures << QtConcurrent::run([ba, filePath, pageIdx, first, last, bits, bytesPerLine, token]() {
+			return tiffDecodeBlocks(ba, filePath, pageIdx, first, last, bits, bytesPerLine, token);
+		});
 	}
 
-	return mPageIdxDirty;
-}
+	// decode the first range in this thread
+	success = tiffDecodeBlocks(ba, filePath, pageIdx, 0, qMin(blocksPerThread, numBlocks), bits, bytesPerLine, mCancelToken);
 
-void DkBasicLoader::resetPageIdx() {
+	for (QFuture<bool>& f : futures)
+		success &= f.result();
 
-	mPageIdxDirty = false;
-	mPageIdx = 1;
-}
+	// e.g. layouts that libtiff's RGBA block interface does not support
+	if (!success && !DkCancelToken::isCanceled(mCancelToken)) {
 
-void DkBasicLoader::convert32BitOrder(void *buffer, int width) const {
+		qInfo() << "[TIFF] block decoding failed - decoding the image at once";
 
-#ifdef WITH_LIBTIFF
-	// code from Qt QTiffHandler
-	uint32 *target = reinterpret_cast<uint32 *>(buffer);
-	for (int32 x=0; x<width; ++x) {
-		uint32 p = target[x];
-		// convert between ARGB and ABGR
-		target[x] = (p & 0xff000000)
-			| ((p & 0x00ff0000) >> 16)
-			| (p & 0x0000ff00)
-			| ((p & 0x000000ff) << 16);
+		tiff = tiffOpen(ba, file, handle, pageIdx);
+
+		if (tiff) {
+			success = tiffDecodeImage(tiff, img);
+			TIFFClose(tiff);
+		}
 	}
+
+	return success;
 #else
-	Q_UNUSED(buffer);
-	Q_UNUSED(width);
+	Q_UNUSED(ba);
+	Q_UNUSED(filePath);
+	Q_UNUSED(pageIdx);
+	Q_UNUSED(img);
+	return false;
 #endif
 }
 
@@ -1183,6 +1727,20 @@ bool DkBasicLoader::saveToBuffer(const QString& filePath, const QImage& img, QSh
 	return saved;
 }
 
+/**
+ * Sets the metadata shared by the image's container.
+ * If set, loadGeneral() does not parse the metadata 
+ * if it was loaded before (e.g. by the preview).
+ * @param metaData the container's metadata.
+ **/ 
+void DkBasicLoader::setSharedMetaData(QSharedPointer<DkSharedMetaData> metaData) {
+	mSharedMetaData = metaData;
+}
+
+QSharedPointer<DkSharedMetaData> DkBasicLoader::sharedMetaData() const {
+	return mSharedMetaData;
+}
+
 void DkBasicLoader::saveThumbToMetaData(const QString& filePath) {
 
 	QSharedPointer<QByteArray> ba;	// dummy
@@ -1204,25 +1762,16 @@ void DkBasicLoader::saveThumbToMetaData(const QString& filePath, QSharedPointer<
 	saveMetaData(filePath, ba);
 }
 
-void DkBasicLoader::saveMetaData(const QString& filePath, QSharedPointer<QByteArray>& ba) {
-
-	if (!ba)
-		ba = QSharedPointer<QByteArray>(new QByteArray());
-
-	if (ba->isEmpty() && mMetaData->isDirty()) {
-		ba = loadFileToBuffer(filePath);
-	}
-
-	bool saved = false;
-	try {
-		saved = mMetaData->saveMetaData(ba);
-	} 
-	catch(...) {
-	}
-	
-	if (saved)
-		writeBufferToFile(filePath, ba);
+/**
+ * Queues edited metadata for writing.
+ * The file is written in the background (see DkMetaDataWriter) 
+ * so the buffer is not updated.
+ * @param filePath the image's file path.
+ **/ 
+void DkBasicLoader::saveMetaData(const QString& filePath, QSharedPointer<QByteArray>&) {
 
+	if (mMetaData && mMetaData->isDirty())
+		DkMetaDataWriter::instance().enqueue(filePath, mMetaData);
 }
 
 bool DkBasicLoader::isContainer(const QString& filePath) {
@@ -1275,8 +1824,12 @@ void DkBasicLoader::release(bool clear) {
 	//metaData.clear();
 	
 	// TODO: where should we clear the metadata?
-	if (clear || !mMetaData->isDirty())
-		mMetaData = QSharedPointer<DkMetaDataT>(new DkMetaDataT());
+	if (clear || !mMetaData->isDirty()) {
+
+		// the shared metadata is kept - we don't need to parse the file again
+		QSharedPointer<DkMetaDataT> metaData = mSharedMetaData ? mSharedMetaData->loadedMetaData() : QSharedPointer<DkMetaDataT>();
+		mMetaData = metaData ? metaData : QSharedPointer<DkMetaDataT>(new DkMetaDataT());
+	}
 
 }
 
@@ -1818,6 +2371,225 @@ QString DkZipContainer::zipMarker() {
 
 #endif
 
+// DkMappedBuffer --------------------------------------------------------------------
+/**
+ * Maps the file into memory.
+ * Mapping is not supported on Windows since mapped files
+ * cannot be deleted or renamed there.
+ * @param filePath the file to be mapped
+ * @return QSharedPointer<QByteArray> the mapped buffer or a NULL pointer if mapping failed
+ **/ 
+QSharedPointer<QByteArray> DkMappedBuffer::map(const QString& filePath) {
+
+#ifdef Q_OS_WIN
+	Q_UNUSED(filePath);
+	return QSharedPointer<QByteArray>();
+#else
+	QFile* file = new QFile(filePath);
+	uchar* data = 0;
+
+	if (file->open(QIODevice::ReadOnly) && file->size() > 0 && file->size() <= std::numeric_limits<int>::max())
+		data = file->map(0, file->size());
+
+	if (!data) {
+		delete file;
+		return QSharedPointer<QByteArray>();
+	}
+
+	int size = (int)file->size();
+
+#ifdef Q_OS_UNIX
+	// start reading in the background - the buffers are typically prefetched by the cacher
+	posix_madvise(data, size, POSIX_MADV_WILLNEED);
+#endif
+
+	// deleting the QFile unmaps it
+	return QSharedPointer<QByteArray>(
+		new QByteArray(QByteArray::fromRawData((const char*)data, size)),
+		[file](QByteArray* ba) {
+			delete ba;
+			delete file;
+		});
+#endif
+}
+
+/**
+ * Loads the file to a buffer.
+ * Large files are mapped into memory (see map()), small files are read.
+ * @param filePath the file to be loaded
+ * @return QSharedPointer<QByteArray> the file buffer (empty if the file could not be read)
+ **/ 
+QSharedPointer<QByteArray> DkMappedBuffer::read(const QString& filePath) {
+
+	QFile file(filePath);
+	
+	if (!file.open(QIODevice::ReadOnly))
+		return QSharedPointer<QByteArray>(new QByteArray());
+
+	// a QByteArray cannot hold files > 2 GB - loaders read these from the file (e.g. tiffs)
+	if (file.size() > std::numeric_limits<int>::max())
+		return QSharedPointer<QByteArray>(new QByteArray());
+
+	if (file.size() >= map_min_size) {
+
+		QSharedPointer<QByteArray> ba = map(filePath);
+
+		if (ba)
+			return ba;
+	}
+
+	return QSharedPointer<QByteArray>(new QByteArray(file.readAll()));
+}
+
+// DkFormatProbe --------------------------------------------------------------------
+/**
+ * Identifies the image format by its signature.
+ * @param header the first bytes of the file (see probe_size)
+ * @param suffix the file's suffix - just needed to tell RAW from TIFF files
+ * @return DkFormatProbe::Format the format or fmt_unknown if the signature is not known.
+ **/ 
+DkFormatProbe::Format DkFormatProbe::probe(const QByteArray& header, const QString& suffix) {
+
+	if (header.size() < 12)
+		return fmt_unknown;
+
+	auto at = [&](int offset, const char* sig, int len) {
+		return header.size() >= offset + len && memcmp(header.constData() + offset, sig, len) == 0;
+	};
+
+	if (at(0, "\xFF\xD8\xFF", 3))
+		return fmt_jpg;
+	if (at(0, "\x89PNG\r\n\x1a\n", 8))
+		return fmt_png;
+	if (at(0, "GIF87a", 6) || at(0, "GIF89a", 6))
+		return fmt_gif;
+	if (at(0, "RIFF", 4) && at(8, "WEBP", 4))
+		return fmt_webp;
+	if (at(0, "8BPS", 4))
+		return fmt_psd;
+	if (at(0, "BM", 2) && at(6, "\0\0\0\0", 4))	// reserved bytes must be 0
+		return fmt_bmp;
+	if (at(0, "\0\0\0\x0CjP  \r\n\x87\n", 12))
+		return fmt_jp2;
+	if (at(0, "\xFF\x4F\xFF\x51", 4))
+		return fmt_j2k;
+
+	// signatures that are RAW only
+	if (at(0, "IIRO", 4) || at(0, "IIRS", 4) ||		// Olympus
+		at(0, "IIU\0", 4) ||							// Panasonic
+		at(0, "FUJIFILM", 8) ||							// Fujifilm
+		at(0, "\0MRM", 4) ||							// Minolta
+		at(0, "FOVb", 4) ||								// Sigma
+		at(6, "HEAPCCDR", 8) ||							// Canon CRW
+		at(4, "ftypcrx ", 8))							// Canon CR3
+		return fmt_raw;
+
+	// ISO base media files
+	if (at(4, "ftyp", 4)) {
+
+		// NOTE: mif1/msf1 are shared by HEIF and AVIF -> we leave them to the suffix
+		if (at(8, "heic", 4) || at(8, "heix", 4) || at(8, "hevc", 4))
+			return fmt_heif;
+		if (at(8, "avif", 4) || at(8, "avis", 4))
+			return fmt_avif;
+	}
+
+	// tiff or BigTIFF
+	if (at(0, "II*\0", 4) || at(0, "MM\0*", 4) || at(0, "II+\0", 4) || at(0, "MM\0+", 4)) {
+
+		// most RAW formats are tiff containers
+		if (at(8, "CR", 2) || isRawSuffix(suffix))
+			return fmt_raw;
+
+		return fmt_tiff;
+	}
+
+	return fmt_unknown;
+}
+
+/**
+ * Returns the first bytes of the file.
+ * If the buffer is not empty, no data is copied - so the buffer must
+ * outlive the header returned.
+ * @param filePath the file which is read if the buffer is empty
+ * @param ba the file buffer (can be empty)
+ * @param size the number of bytes to be read
+ * @return QByteArray the file's header
+ **/ 
+QByteArray DkFormatProbe::readHeader(const QString& filePath, const QSharedPointer<QByteArray>& ba, int size) {
+
+	if (ba && !ba->isEmpty())
+		return QByteArray::fromRawData(ba->constData(), qMin(size, ba->size()));
+
+	QFile file(filePath);
+	
+	if (!file.open(QIODevice::ReadOnly))
+		return QByteArray();
+
+	return file.read(size);
+}
+
+QByteArray DkFormatProbe::qtFormat(Format fmt) {
+
+	switch (fmt) {
+	case fmt_jpg:	return "jpg";
+	case fmt_png:	return "png";
+	case fmt_gif:	return "gif";
+	case fmt_bmp:	return "bmp";
+	case fmt_webp:	return "webp";
+	case fmt_tiff:	return "tiff";
+	case fmt_psd:	return "psd";
+	case fmt_jp2:	return "jp2";
+	case fmt_j2k:	return "j2k";
+	case fmt_heif:	return "heic";
+	case fmt_avif:	return "avif";
+	default:		return QByteArray();
+	}
+}
+
+QString DkFormatProbe::formatName(Format fmt) {
+
+	switch (fmt) {
+	case fmt_raw:		return "RAW";
+	case fmt_unknown:	return "unknown";
+	default:			return QString::fromLatin1(qtFormat(fmt)).toUpper();
+	}
+}
+
+bool DkFormatProbe::isRawSuffix(const QString& suffix) {
+
+	if (suffix.isEmpty())
+		return false;
+
+	// raw filters look like: Nikon Raw (*.nef *.nrw)
+	QRegExp exp("\\*\\." + QRegExp::escape(suffix) + "[ )]", Qt::CaseInsensitive);
+
+	for (const QString& filter : DkSettingsManager::param().app().rawFilters) {
+		if (filter.contains(exp))
+			return true;
+	}
+
+	return false;
+}
+
+// DkCancelToken --------------------------------------------------------------------
+void DkCancelToken::cancel() {
+	mCanceled.storeRelease(1);
+}
+
+bool DkCancelToken::isCanceled() const {
+	return mCanceled.loadAcquire() != 0;
+}
+
+/**
+ * Convenience function - empty tokens are never canceled.
+ * @param token the cancel token
+ * @return bool true if the token exists and was canceled
+ **/ 
+bool DkCancelToken::isCanceled(const QSharedPointer<DkCancelToken>& token) {
+	return token && token->isCanceled();
+}
+
 // DkRawLoader --------------------------------------------------------------------
 DkRawLoader::DkRawLoader(const QString & filePath, const QSharedPointer<DkMetaDataT>& metaData) {
 	mFilePath = filePath;
@@ -1832,6 +2604,27 @@ void DkRawLoader::setLoadFast(bool fast) {
 	mLoadFast = fast;
 }
 
+void DkRawLoader::setCancelToken(const QSharedPointer<DkCancelToken>& token) {
+	mCancelToken = token;
+}
+
+#ifdef WITH_LIBRAW
+// LibRaw calls this during unpacking/processing - returning != 0 aborts it
+static int rawProgressCallback(void* data, enum LibRaw_progress, int, int) {
+	return DkCancelToken::isCanceled(*static_cast<const QSharedPointer<DkCancelToken>*>(data)) ? 1 : 0;
+}
+#endif
+
+bool DkRawLoader::isCanceled() const {
+
+	if (DkCancelToken::isCanceled(mCancelToken)) {
+		qDebug() << "[RAW] canceled" << mFilePath;
+		return true;
+	}
+
+	return false;
+}
+
 bool DkRawLoader::load(const QSharedPointer<QByteArray> ba) {
 
 	DkTimer dt;
@@ -1852,6 +2645,9 @@ bool DkRawLoader::load(const QSharedPointer<QByteArray> ba) {
 			return false;
 		}
 
+		if (mCancelToken)
+			iProcessor.set_progress_handler(rawProgressCallback, &mCancelToken);
+
 		// check camera models for specific hacks
 		detectSpecialCamera(iProcessor);
 
@@ -1869,13 +2665,16 @@ bool DkRawLoader::load(const QSharedPointer<QByteArray> ba) {
 		if (std::strcmp(iProcessor.version(), "0.13.5") != 0)	// fixes a bug specific to libraw 13 - version call is UNTESTED
 			iProcessor.raw2image();
 
-		if (error != LIBRAW_SUCCESS)
+		if (error != LIBRAW_SUCCESS || isCanceled())
 			return false;
 
 		// develop using libraw
 		if (mCamType == camera_unknown) {
 			error = iProcessor.dcraw_process();
 
+			if (isCanceled())
+				return false;
+
 			auto rimg = iProcessor.dcraw_make_mem_image();
 
 			if (rimg) {
@@ -1896,18 +2695,22 @@ bool DkRawLoader::load(const QSharedPointer<QByteArray> ba) {
 		else
 			rawMat = prepareImg(iProcessor);
 
-		// color correction + white balance
-		if (mIsChromatic) {
-			whiteBalance(iProcessor, rawMat);
-		}
-		
-		// gamma correction
-		gammaCorrection(iProcessor, rawMat);
+		if (isCanceled())
+			return false;
+
+		// color correction + white balance + gamma correction -> 8U
+		rawMat = develop(iProcessor, rawMat);
+
+		if (isCanceled())
+			return false;
 
 		// reduce color noise
 		if (DkSettingsManager::param().resources().filterRawImages && mIsChromatic)
 			reduceColorNoise(iProcessor, rawMat);
 
+		if (isCanceled())
+			return false;
+
 		mImg = raw2Img(iProcessor, rawMat);
 
 		//qDebug() << "img size" << mImg.size();
@@ -2050,25 +2853,51 @@ void DkRawLoader::detectSpecialCamera(const LibRaw & iProcessor) {
 	// add your camera flag (for hacks) here
 }
 
+// runs fn(startRow, endRow) for row ranges in parallel
+template <typename Fn>
+class DkRowsLoopBody : public cv::ParallelLoopBody {
+
+public:
+	DkRowsLoopBody(const Fn& fn) : mFn(fn) {}
+
+	void operator()(const cv::Range& range) const override {
+		mFn(range.start, range.end);
+	}
+
+private:
+	Fn mFn;
+};
+
+template <typename Fn>
+static void parallelRows(int rows, const Fn& fn) {
+	cv::parallel_for_(cv::Range(0, rows), DkRowsLoopBody<Fn>(fn));
+}
+
 cv::Mat DkRawLoader::demosaic(LibRaw & iProcessor) const {
 
+	DkTimer dt;
+
 	cv::Mat rawMat = cv::Mat(iProcessor.imgdata.sizes.height, iProcessor.imgdata.sizes.width, CV_16UC1);
-	double dynamicRange = (double)(iProcessor.imgdata.color.maximum - iProcessor.imgdata.color.black);
+	
+	cv::Mat nt = normalizationTable(iProcessor);
+	const unsigned short* normLookup = nt.ptr<unsigned short>();
 
 	// normalize all image values
-	for (int rIdx = 0; rIdx < rawMat.rows; rIdx++) {
-		unsigned short *ptrRaw = rawMat.ptr<unsigned short>(rIdx);
+	parallelRows(rawMat.rows, [&](int startRow, int endRow) {
 
-		for (int cIdx = 0; cIdx < rawMat.cols; cIdx++) {
+		for (int rIdx = startRow; rIdx < endRow && !DkCancelToken::isCanceled(mCancelToken); rIdx++) {
+			unsigned short *ptrRaw = rawMat.ptr<unsigned short>(rIdx);
+			const unsigned short (*ptrImg)[4] = iProcessor.imgdata.image + rawMat.cols*rIdx;
 
-			int colIdx = iProcessor.COLOR(rIdx, cIdx);
-			double val = (double)(iProcessor.imgdata.image[(rawMat.cols*rIdx) + cIdx][colIdx]);
-			
-			// normalize the value w.r.t the black point defined
-			val = (val - iProcessor.imgdata.color.black) / dynamicRange;
-			ptrRaw[cIdx] = clip<unsigned short>(val * USHRT_MAX);  // for conversion to 16U
+			for (int cIdx = 0; cIdx < rawMat.cols; cIdx++)
+				ptrRaw[cIdx] = normLookup[ptrImg[cIdx][iProcessor.COLOR(rIdx, cIdx)]];
 		}
-	}
+	});
+
+	qDebug() << "[RAW] normalized in" << dt;
+
+	if (isCanceled())
+		return cv::Mat();
 
 	// no demosaicing
 	if (mIsChromatic) {
@@ -2107,32 +2936,44 @@ cv::Mat DkRawLoader::demosaic(LibRaw & iProcessor) const {
 cv::Mat DkRawLoader::prepareImg(const LibRaw & iProcessor) const {
 
 	cv::Mat rawMat = cv::Mat(iProcessor.imgdata.sizes.height, iProcessor.imgdata.sizes.width, CV_16UC3, cv::Scalar(0));
-	double dynamicRange = (double)(iProcessor.imgdata.color.maximum - iProcessor.imgdata.color.black);
-
-	// normalization function
-	auto normalize = [&](double val) { 
 	
-		val = (val - iProcessor.imgdata.color.black) / dynamicRange;
-		return clip<unsigned short>(val * USHRT_MAX);
-	};
+	cv::Mat nt = normalizationTable(iProcessor);
+	const unsigned short* normLookup = nt.ptr<unsigned short>();
 
-	for (int rIdx = 0; rIdx < rawMat.rows; rIdx++) {
-		unsigned short *ptrI = rawMat.ptr<unsigned short>(rIdx);
+	parallelRows(rawMat.rows, [&](int startRow, int endRow) {
 
-		for (int cIdx = 0; cIdx < rawMat.cols; cIdx++) {
+		for (int rIdx = startRow; rIdx < endRow && !DkCancelToken::isCanceled(mCancelToken); rIdx++) {
+			unsigned short *ptrI = rawMat.ptr<unsigned short>(rIdx);
+			const unsigned short (*ptrImg)[4] = iProcessor.imgdata.image + rawMat.cols*rIdx;
 
-			*ptrI = normalize(iProcessor.imgdata.image[rawMat.cols*rIdx + cIdx][0]);
-			ptrI++;
-			*ptrI = normalize(iProcessor.imgdata.image[rawMat.cols*rIdx + cIdx][1]);
-			ptrI++;
-			*ptrI = normalize(iProcessor.imgdata.image[rawMat.cols*rIdx + cIdx][2]);
-			ptrI++;
+			for (int cIdx = 0; cIdx < rawMat.cols; cIdx++) {
+				*ptrI++ = normLookup[ptrImg[cIdx][0]];
+				*ptrI++ = normLookup[ptrImg[cIdx][1]];
+				*ptrI++ = normLookup[ptrImg[cIdx][2]];
+			}
 		}
-	}
+	});
 
 	return rawMat;
 }
 
+cv::Mat DkRawLoader::normalizationTable(const LibRaw & iProcessor) const {
+
+	double dynamicRange = (double)(iProcessor.imgdata.color.maximum - iProcessor.imgdata.color.black);
+
+	cv::Mat nt(1, USHRT_MAX+1, CV_16UC1);
+	unsigned short* ntp = nt.ptr<unsigned short>();
+
+	// normalize the value w.r.t the black point defined
+	for (int idx = 0; idx < nt.cols; idx++) {
+		double val = ((double)idx - iProcessor.imgdata.color.black) / dynamicRange;
+		ntp[idx] = clip<unsigned short>(val * USHRT_MAX);  // for conversion to 16U
+	}
+
+	// a 1 x 65536 U16 table that maps sensor values to [0 USHRT_MAX]
+	return nt;
+}
+
 cv::Mat DkRawLoader::whiteMultipliers(const LibRaw & iProcessor) const {
 	
 	// get camera white balance multipliers
@@ -2166,6 +3007,26 @@ cv::Mat DkRawLoader::whiteMultipliers(const LibRaw & iProcessor) const {
 	return wm;
 }
 
+cv::Mat DkRawLoader::whiteBalanceTable(const LibRaw & iProcessor) const {
+
+	cv::Mat wb = whiteMultipliers(iProcessor);
+	const float* wbp = wb.ptr<float>();
+	assert(wb.cols == 4);
+
+	cv::Mat wbt(3, USHRT_MAX+1, CV_16UC1);
+
+	for (int ch = 0; ch < wbt.rows; ch++) {
+
+		unsigned short* wbtp = wbt.ptr<unsigned short>(ch);
+
+		for (int idx = 0; idx < wbt.cols; idx++)
+			wbtp[idx] = clip<unsigned short>((float)idx * wbp[ch]);
+	}
+
+	// a 3 x 65536 U16 table (one row per RGB channel)
+	return wbt;
+}
+
 cv::Mat DkRawLoader::gammaTable(const LibRaw & iProcessor) const {
 	
 	// OK this is an instance of reverse engineering:
@@ -2177,78 +3038,93 @@ cv::Mat DkRawLoader::gammaTable(const LibRaw & iProcessor) const {
 	//read gamma value and create gamma table	
 	double gamma = (double)iProcessor.imgdata.params.gamm[0];
 	
-	cv::Mat gmt(1, USHRT_MAX, CV_16UC1);
-	unsigned short* gmtp = gmt.ptr<unsigned short>();
+	cv::Mat gmt(1, USHRT_MAX+1, CV_8UC1);
+	unsigned char* gmtp = gmt.ptr<unsigned char>();
 	
 	for (int idx = 0; idx < gmt.cols; idx++) {
-		gmtp[idx] = clip<unsigned short>(qRound((1.099*std::pow((double)idx / USHRT_MAX, gamma) - 0.099) * 255 * cameraHackMlp));
+
+		unsigned short val;
+		
+		// values close to 0 are treated linear
+		if (idx <= 5)	// 0.018 * 255
+			val = (unsigned short)qRound(idx * (double)iProcessor.imgdata.params.gamm[1] / 255.0);
+		else
+			val = clip<unsigned short>(qRound((1.099*std::pow((double)idx / USHRT_MAX, gamma) - 0.099) * 255 * cameraHackMlp));
+
+		gmtp[idx] = cv::saturate_cast<unsigned char>(val);
 	}
 
-	// a 1 x 65535 U16 gamma table
+	// a 1 x 65536 U8 gamma table
 	return gmt;
 }
 
-void DkRawLoader::whiteBalance(const LibRaw & iProcessor, cv::Mat & img) const {
+/**
+ * Applies white balance, color correction and gamma correction.
+ * All corrections are fused into a single (row parallel) pass
+ * that converts the 16 bit image to an 8 bit image.
+ * @param iProcessor the LibRaw processor
+ * @param img a 16U image with 1 or 3 channels
+ * @return cv::Mat an 8U image with the same number of channels
+ **/ 
+cv::Mat DkRawLoader::develop(const LibRaw & iProcessor, const cv::Mat & img) const {
 
-	// white balance must not be empty at this point
-	cv::Mat wb = whiteMultipliers(iProcessor);
-	const float* wbp = wb.ptr<float>();
-	assert(wb.cols == 4);
+	DkTimer dt;
 
-	for (int rIdx = 0; rIdx < img.rows; rIdx++) {
-		
-		unsigned short *ptr = img.ptr<unsigned short>(rIdx);
-		
-		for (int cIdx = 0; cIdx < img.cols; cIdx++) {
-			
-			//apply white balance correction
-			unsigned short r = clip<unsigned short>(*ptr		* wbp[0]);
-			unsigned short g = clip<unsigned short>(*(ptr+1)	* wbp[1]);
-			unsigned short b = clip<unsigned short>(*(ptr+2)	* wbp[2]);
-
-			//apply color correction					
-			int cr = qRound(iProcessor.imgdata.color.rgb_cam[0][0] * r + 
-							iProcessor.imgdata.color.rgb_cam[0][1] * g + 
-							iProcessor.imgdata.color.rgb_cam[0][2] * b);
-			int cg = qRound(iProcessor.imgdata.color.rgb_cam[1][0] * r + 
-							iProcessor.imgdata.color.rgb_cam[1][1] * g + 
-							iProcessor.imgdata.color.rgb_cam[1][2] * b);
-			int cb = qRound(iProcessor.imgdata.color.rgb_cam[2][0] * r + 
-							iProcessor.imgdata.color.rgb_cam[2][1] * g + 
-							iProcessor.imgdata.color.rgb_cam[2][2] * b);
-
-			// clip & save color corrected values
-			*ptr = clip<unsigned short>(cr);
-			ptr++;
-			*ptr = clip<unsigned short>(cg);
-			ptr++;
-			*ptr = clip<unsigned short>(cb);
-			ptr++;
-		}
-	}
-}
+	cv::Mat gt = gammaTable(iProcessor);
+	const unsigned char* gammaLookup = gt.ptr<unsigned char>();
 
-void DkRawLoader::gammaCorrection(const LibRaw & iProcessor, cv::Mat& img) const {
+	// color correction + white balance
+	bool correctColors = mIsChromatic && img.channels() == 3;
 
-	// white balance must not be empty at this point
-	cv::Mat gt = gammaTable(iProcessor);
-	const unsigned short* gammaLookup = gt.ptr<unsigned short>();
-	assert(gt.cols == USHRT_MAX);
-	
-	for (int rIdx = 0; rIdx < img.rows; rIdx++) {
+	cv::Mat wbt;
+	if (correctColors)
+		wbt = whiteBalanceTable(iProcessor);
 
-		unsigned short *ptr = img.ptr<unsigned short>(rIdx);
+	cv::Mat dst(img.rows, img.cols, CV_8UC(img.channels()));
 
-		for (int cIdx = 0; cIdx < img.cols * img.channels(); cIdx++) {
+	parallelRows(img.rows, [&](int startRow, int endRow) {
 
-			// values close to 0 are treated linear
-			if (ptr[cIdx] <= 5)	// 0.018 * 255
-				ptr[cIdx] = (unsigned short)qRound(ptr[cIdx] * (double)iProcessor.imgdata.params.gamm[1] / 255.0);
-			else
-				ptr[cIdx] = gammaLookup[ptr[cIdx]];
+		const float (*rgbCam)[4] = iProcessor.imgdata.color.rgb_cam;
+
+		for (int rIdx = startRow; rIdx < endRow && !DkCancelToken::isCanceled(mCancelToken); rIdx++) {
+
+			const unsigned short* ptr = img.ptr<unsigned short>(rIdx);
+			unsigned char* ptrDst = dst.ptr<unsigned char>(rIdx);
+
+			if (!correctColors) {
+				for (int cIdx = 0; cIdx < img.cols * img.channels(); cIdx++)
+					ptrDst[cIdx] = gammaLookup[ptr[cIdx]];
+				continue;
+			}
+
+			const unsigned short* wbR = wbt.ptr<unsigned short>(0);
+			const unsigned short* wbG = wbt.ptr<unsigned short>(1);
+			const unsigned short* wbB = wbt.ptr<unsigned short>(2);
+
+			for (int cIdx = 0; cIdx < img.cols; cIdx++, ptr += 3, ptrDst += 3) {
+
+				//apply white balance correction
+				unsigned short r = wbR[ptr[0]];
+				unsigned short g = wbG[ptr[1]];
+				unsigned short b = wbB[ptr[2]];
+
+				//apply color correction
+				int cr = qRound(rgbCam[0][0] * r + rgbCam[0][1] * g + rgbCam[0][2] * b);
+				int cg = qRound(rgbCam[1][0] * r + rgbCam[1][1] * g + rgbCam[1][2] * b);
+				int cb = qRound(rgbCam[2][0] * r + rgbCam[2][1] * g + rgbCam[2][2] * b);
+
+				// clip & gamma correct
+				ptrDst[0] = gammaLookup[clip<unsigned short>(cr)];
+				ptrDst[1] = gammaLookup[clip<unsigned short>(cg)];
+				ptrDst[2] = gammaLookup[clip<unsigned short>(cb)];
+			}
 		}
-	}
+	});
+
+	qDebug() << "[RAW] developed in" << dt;
 
+	// 8U (1 or 3 channeled) Mat
+	return dst;
 }
 
 void DkRawLoader::reduceColorNoise(const LibRaw & iProcessor, cv::Mat & img) const {
@@ -2339,7 +3215,7 @@ namespace tga {
 		// thanks!
 		Header header;
 
-		const char* dataC = ba->data();
+		const char* dataC = ba->constData();
 
 		/* Display the header fields */
 		header.idlength = *dataC; dataC++;
@@ -33,6 +33,7 @@
 #include <QFutureWatcher>
 #include <QUrl>
 #include <QImage>
+#include <QAtomicInt>
 #pragma warning(pop)
 
 #pragma warning(disable: 4251)	// TODO: remove
@@ -69,6 +70,7 @@ class LibRaw;
 namespace nmc {
 
 class DkMetaDataT;
+class DkSharedMetaData;
 
 #ifdef WITH_QUAZIP
 class DllCoreExport DkZipContainer {
@@ -112,6 +114,26 @@ protected:
 
 };
 
+/**
+ * Cooperative cancellation of running decodes.
+ * The token is shared between the thread that requested a decode and
+ * the decoder. Decoders poll isCanceled() between strips, rows and
+ * processing stages and bail out early if the image is not needed anymore.
+ **/ 
+class DllCoreExport DkCancelToken {
+
+public:
+	DkCancelToken() {};
+
+	void cancel();
+	bool isCanceled() const;
+
+	static bool isCanceled(const QSharedPointer<DkCancelToken>& token);
+
+protected:
+	QAtomicInt mCanceled;
+};
+
 class DllCoreExport DkRawLoader {
 
 public:
@@ -119,6 +141,7 @@ public:
 
 	bool isEmpty() const;
 	void setLoadFast(bool fast);
+	void setCancelToken(const QSharedPointer<DkCancelToken>& token);
 
 	bool load(const QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
 
@@ -140,9 +163,11 @@ protected:
 
 	bool mLoadFast = false;
 	bool mIsChromatic = true;
+	QSharedPointer<DkCancelToken> mCancelToken;
 	Cam mCamType = camera_unknown;
 
 	bool loadPreview(const QSharedPointer<QByteArray>& ba);
+	bool isCanceled() const;
 
 #ifdef WITH_LIBRAW
 	cv::Mat mColorMat;
@@ -155,12 +180,12 @@ protected:
 	cv::Mat demosaic(LibRaw& iProcessor) const;
 	cv::Mat prepareImg(const LibRaw& iProcessor) const;
 
+	cv::Mat normalizationTable(const LibRaw& iProcessor) const;
 	cv::Mat whiteMultipliers(const LibRaw& iProcessor) const;
+	cv::Mat whiteBalanceTable(const LibRaw& iProcessor) const;
 	cv::Mat gammaTable(const LibRaw& iProcessor) const;
 
-	void whiteBalance(const LibRaw& iProcessor, cv::Mat& img) const;
-
-	void gammaCorrection(const LibRaw& iProcessor, cv::Mat& img) const;
+	cv::Mat develop(const LibRaw& iProcessor, const cv::Mat& img) const;
 
 	void reduceColorNoise(const LibRaw& iProcessor, cv::Mat& img) const;
 
@@ -183,6 +208,63 @@ protected:
 #endif
 };
 
+/**
+ * Memory mapped file buffers.
+ * The buffer returned wraps the mapping (QByteArray::fromRawData)
+ * so no data is copied to the heap. The file is unmapped as soon as
+ * the last QSharedPointer referencing the buffer is released.
+ * Modifying the buffer detaches it (i.e. creates a heap copy).
+ **/ 
+class DllCoreExport DkMappedBuffer {
+
+public:
+	enum {
+		map_min_size = 256*1024,	// smaller files are simply read
+	};
+
+	static QSharedPointer<QByteArray> map(const QString& filePath);
+	static QSharedPointer<QByteArray> read(const QString& filePath);
+};
+
+/**
+ * Identifies image formats by their signature (magic bytes).
+ * Probing the first few KB of a file allows us to pick the
+ * right decoder at once rather than trying all of them.
+ **/ 
+class DllCoreExport DkFormatProbe {
+
+public:
+	enum Format {
+		fmt_unknown = 0,
+		fmt_jpg,
+		fmt_png,
+		fmt_gif,
+		fmt_bmp,
+		fmt_webp,
+		fmt_tiff,
+		fmt_psd,
+		fmt_jp2,
+		fmt_j2k,
+		fmt_heif,
+		fmt_avif,
+		fmt_raw,
+
+		fmt_end
+	};
+
+	enum {
+		probe_size = 4096,
+	};
+
+	static Format probe(const QByteArray& header, const QString& suffix = QString());
+	static QByteArray readHeader(const QString& filePath, const QSharedPointer<QByteArray>& ba = QSharedPointer<QByteArray>(), int size = probe_size);
+	static QByteArray qtFormat(Format fmt);
+	static QString formatName(Format fmt);
+
+protected:
+	static bool isRawSuffix(const QString& suffix);
+};
+
 /**
  * This class provides image loading and editing capabilities.
  * It additionally stores the currently loaded image.
@@ -277,10 +359,20 @@ public:
 		return mLoader;
 	};
 
+	void setMinSize(const QSize& size, Qt::AspectRatioMode mode = Qt::KeepAspectRatio);
+	QSize minSize() const;
+	bool isScaled() const;
+
+	void setCancelToken(const QSharedPointer<DkCancelToken>& token);
+	bool isCanceled() const;
+
 	QSharedPointer<DkMetaDataT> getMetaData() const {
 		return mMetaData;
 	};
 
+	void setSharedMetaData(QSharedPointer<DkSharedMetaData> metaData);
+	QSharedPointer<DkSharedMetaData> sharedMetaData() const;
+
 	/**
 	 * Returns the 8-bit image, which is rendered.
 	 * @return QImage an 8bit image
@@ -364,8 +456,14 @@ protected:
 	bool loadRohFile(const QString& filePath, QImage& img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>()) const;
 	bool loadTgaFile(const QString& filePath, QImage& img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>()) const;
 	bool loadRawFile(const QString& filePath, QImage& img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>(), bool fast = false) const;
+	bool loadQtFile(const QString& filePath, QImage& img, const QByteArray& format, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+	bool loadScaledQtFile(const QString& filePath, QImage& img, const QByteArray& format, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+	bool loadProbedFile(DkFormatProbe::Format fmt, const QString& filePath, QImage& img, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>(), bool fast = false);
+	static bool hasProbedDecoder(DkFormatProbe::Format fmt);
+	static const QList<QByteArray>& qtImageFormats();
 	void indexPages(const QString& filePath, const QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
 	void convert32BitOrder(void *buffer, int width) const;
+	bool loadTIFFPage(const QSharedPointer<QByteArray>& ba, const QString& filePath, int pageIdx, QImage& img) const;
 
 	int mLoader;
 	bool mTraining;
@@ -376,9 +474,15 @@ protected:
 	int mPageIdx;
 	bool mPageIdxDirty;
 	QSharedPointer<DkMetaDataT> mMetaData;
+	QSharedPointer<DkSharedMetaData> mSharedMetaData;
 	QVector<DkEditImage> mImages;
 	int mMinHistorySize = 2;
 	int mImageIndex = 0;
+
+	QSize mMinSize;
+	Qt::AspectRatioMode mMinSizeMode = Qt::KeepAspectRatio;
+	bool mScaled = false;
+	QSharedPointer<DkCancelToken> mCancelToken;
 };
 
 namespace tga {
@@ -0,0 +1,470 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#include "DkFolderIndex.h"
+#include "DkSettings.h"
+#include "DkUtils.h"
+#include "DkTimer.h"
+#include "DkScheduler.h"
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QFile>
+#include <QSaveFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QDebug>
+#pragma warning(pop)	// no warnings from includes - end
+
+namespace nmc {
+
+// the on-disk layout: header | entries | utf-8 file names
+namespace {
+
+#pragma pack(push, 1)
+struct IndexHeader {
+	char magic[4];
+	quint32 version;
+	qint64 dirModified;
+	quint32 filterHash;
+	quint32 numEntries;
+	quint32 namesSize;
+};
+
+struct IndexEntry {
+	quint32 nameOffset;
+	quint32 nameLength;
+	qint64 size;
+	qint64 modified;
+	qint64 created;
+	qint64 exifDate;
+	qint32 width;
+	qint32 height;
+	qint16 orientation;
+	qint16 rating;
+	qint64 thumbOffset;
+};
+#pragma pack(pop)
+
+const char indexMagic[4] = {'N', 'M', 'F', 'I'};
+const quint32 indexVersion = 1;
+
+}
+
+// DkFolderIndex --------------------------------------------------------------------
+DkFolderIndex::DkFolderIndex(const QString& dirPath) {
+	mDirPath = dirPath;
+}
+
+bool DkFolderIndex::Entry::hasFileInfo() const {
+	return size >= 0;
+}
+
+/**
+ * Loads the index of the folder.
+ * The index file is memory mapped and parsed in a single pass.
+ * @return bool true if a valid index was found.
+ **/ 
+bool DkFolderIndex::load() {
+
+	DkTimer dt;
+	QMutexLocker locker(&mMutex);
+
+	mLoaded = false;
+	mEntries.clear();
+	mEntryIdx.clear();
+
+	if (mDirPath.isEmpty())
+		return false;
+
+	QFile file(indexPath(mDirPath));
+
+	if (!file.exists() || !file.open(QIODevice::ReadOnly))
+		return false;
+
+	qint64 fileSize = file.size();
+
+	if (fileSize < (qint64)sizeof(IndexHeader))
+		return false;
+
+	uchar* data = file.map(0, fileSize);
+
+	if (!data) {
+		qWarning() << "[DkFolderIndex] cannot map" << file.fileName();
+		return false;
+	}
+
+	IndexHeader header;
+	memcpy(&header, data, sizeof(header));
+
+	bool valid = memcmp(header.magic, indexMagic, sizeof(indexMagic)) == 0 && 
+		header.version == indexVersion &&
+		fileSize == (qint64)sizeof(IndexHeader) + (qint64)header.numEntries * (qint64)sizeof(IndexEntry) + (qint64)header.namesSize;
+
+	if (valid) {
+
+		const uchar* entries = data + sizeof(IndexHeader);
+		const char* names = reinterpret_cast<const char*>(entries + header.numEntries * sizeof(IndexEntry));
+
+		mEntries.reserve(header.numEntries);
+		mEntryIdx.reserve(header.numEntries);
+
+		for (quint32 idx = 0; idx < header.numEntries; idx++) {
+
+			IndexEntry ie;
+			memcpy(&ie, entries + idx * sizeof(IndexEntry), sizeof(ie));
+
+			if ((quint64)ie.nameOffset + ie.nameLength > header.namesSize) {
+				valid = false;
+				break;
+			}
+
+			Entry e;
+			e.name = QString::fromUtf8(names + ie.nameOffset, ie.nameLength);
+			e.size = ie.size;
+			e.modified = ie.modified;
+			e.created = ie.created;
+			e.exifDate = ie.exifDate;
+			e.width = ie.width;
+			e.height = ie.height;
+			e.orientation = ie.orientation;
+			e.rating = ie.rating;
+			e.thumbOffset = ie.thumbOffset;
+
+			mEntryIdx.insert(e.name, mEntries.size());
+			mEntries << e;
+		}
+	}
+
+	file.unmap(data);
+
+	if (!valid) {
+		qWarning() << "[DkFolderIndex] ignoring corrupt index" << file.fileName();
+		mEntries.clear();
+		mEntryIdx.clear();
+		return false;
+	}
+
+	mDirModified = header.dirModified;
+	mFilterHash = header.filterHash;
+	mLoaded = true;
+	mDirty = false;
+
+	qInfo() << "[DkFolderIndex]" << mEntries.size() << "entries loaded in" << dt;
+
+	return true;
+}
+
+/**
+ * Writes the index if it changed.
+ * Files that were not stat'ed yet are stat'ed here.
+ * Folders with less than min_files files are not indexed.
+ * @return bool true if the index was written.
+ **/ 
+bool DkFolderIndex::save() {
+
+	if (!isDirty() || mDirPath.isEmpty())
+		return false;
+
+	DkTimer dt;
+	updateFileInfos();
+
+	QMutexLocker locker(&mMutex);
+
+	if (mEntries.size() < min_files)
+		return false;
+
+	QByteArray names;
+	QByteArray entries;
+	entries.reserve(mEntries.size() * (int)sizeof(IndexEntry));
+
+	for (const Entry& e : mEntries) {
+
+		QByteArray name = e.name.toUtf8();
+
+		IndexEntry ie;
+		ie.nameOffset = names.size();
+		ie.nameLength = name.size();
+		ie.size = e.size;
+		ie.modified = e.modified;
+		ie.created = e.created;
+		ie.exifDate = e.exifDate;
+		ie.width = e.width;
+		ie.height = e.height;
+		ie.orientation = (qint16)e.orientation;
+		ie.rating = (qint16)e.rating;
+		ie.thumbOffset = e.thumbOffset;
+
+		names.append(name);
+		entries.append(reinterpret_cast<const char*>(&ie), sizeof(ie));
+	}
+
+	IndexHeader header;
+	memcpy(header.magic, indexMagic, sizeof(indexMagic));
+	header.version = indexVersion;
+	header.dirModified = mDirModified;
+	header.filterHash = mFilterHash;
+	header.numEntries = mEntries.size();
+	header.namesSize = names.size();
+
+	// clear the flag now - changes while writing mark it dirty again
+	mDirty = false;
+	locker.unlock();
+
+	QString path = indexPath(mDirPath);
+	QDir().mkpath(QFileInfo(path).absolutePath());
+
+	QSaveFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		qWarning() << "[DkFolderIndex] cannot write" << path;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(entries);
+	file.write(names);
+
+	if (!file.commit()) {
+		qWarning() << "[DkFolderIndex] cannot write" << path;
+		return false;
+	}
+
+	qInfo() << "[DkFolderIndex]" << header.numEntries << "entries saved in" << dt;
+
+	return true;
+}
+
+/**
+ * Checks & saves the index in the background.
+ * All files are stat'ed in the background: files that were
+ * edited in place (the folder's date does not change) get
+ * their new dates and their attributes are read again.
+ * @param index the index to be saved.
+ **/ 
+void DkFolderIndex::saveThreaded(QSharedPointer<DkFolderIndex> index) {
+
+	if (!index || !index->isLoaded())
+		return;
+
+	DkDecodeScheduler::instance().run<bool>(DkDecodeScheduler::priority_batch, [index]() {
+		index->updateFileInfos(true);
+		return index->save();
+	});
+}
+
+bool DkFolderIndex::isLoaded() const {
+	QMutexLocker locker(&mMutex);
+	return mLoaded;
+}
+
+/**
+ * Returns true if the file list is up-to-date.
+ * Adding, removing or renaming files changes the folder's 
+ * modification date - so we don't need to list the folder.
+ **/ 
+bool DkFolderIndex::isUpToDate() const {
+	
+	QMutexLocker locker(&mMutex);
+
+	return mLoaded && 
+		mDirModified != 0 && 
+		mDirModified == dirModified(mDirPath) && 
+		mFilterHash == filterHash();
+}
+
+bool DkFolderIndex::isDirty() const {
+	QMutexLocker locker(&mMutex);
+	return mDirty;
+}
+
+bool DkFolderIndex::isEmpty() const {
+	QMutexLocker locker(&mMutex);
+	return mEntries.isEmpty();
+}
+
+QString DkFolderIndex::dirPath() const {
+	return mDirPath;
+}
+
+QStringList DkFolderIndex::fileNames() const {
+
+	QMutexLocker locker(&mMutex);
+	QStringList names;
+	names.reserve(mEntries.size());
+
+	for (const Entry& e : mEntries)
+		names << e.name;
+
+	return names;
+}
+
+bool DkFolderIndex::contains(const QString& fileName) const {
+	QMutexLocker locker(&mMutex);
+	return mEntryIdx.contains(fileName);
+}
+
+DkFolderIndex::Entry DkFolderIndex::entry(const QString& fileName) const {
+
+	QMutexLocker locker(&mMutex);
+	int idx = mEntryIdx.value(fileName, -1);
+
+	if (idx == -1)
+		return Entry();
+
+	return mEntries[idx];
+}
+
+void DkFolderIndex::setEntry(const Entry& entry) {
+
+	QMutexLocker locker(&mMutex);
+	int idx = mEntryIdx.value(entry.name, -1);
+
+	if (idx == -1) {
+		mEntryIdx.insert(entry.name, mEntries.size());
+		mEntries << entry;
+	}
+	else
+		mEntries[idx] = entry;
+
+	mDirty = true;
+}
+
+/**
+ * Updates the file list incrementally.
+ * Entries of existing files are kept, new files are added 
+ * (and stat'ed when saving) and removed files are dropped.
+ * @param fileNames the current files of the folder.
+ * @param dirModified the folder's modification date before it was listed.
+ **/ 
+void DkFolderIndex::update(const QStringList& fileNames, qint64 dirModified) {
+
+	QMutexLocker locker(&mMutex);
+
+	QVector<Entry> entries;
+	QHash<QString, int> entryIdx;
+	entries.reserve(fileNames.size());
+	entryIdx.reserve(fileNames.size());
+
+	for (const QString& name : fileNames) {
+
+		int idx = mEntryIdx.value(name, -1);
+
+		if (idx != -1)
+			entries << mEntries[idx];
+		else {
+			Entry e;
+			e.name = name;
+			entries << e;
+		}
+
+		entryIdx.insert(name, entries.size()-1);
+	}
+
+	mEntries = entries;
+	mEntryIdx = entryIdx;
+	mDirModified = dirModified;
+	mFilterHash = filterHash();
+	mLoaded = true;
+	mDirty = true;
+}
+
+/**
+ * Stats the files of the index.
+ * Changed files (size or modification date) are reset
+ * so that their attributes are read again.
+ * @param checkAll if false, only files that were not stat'ed yet are stat'ed.
+ **/ 
+void DkFolderIndex::updateFileInfos(bool checkAll) {
+
+	QVector<Entry> entries;
+
+	QMutexLocker locker(&mMutex);
+	for (const Entry& e : mEntries) {
+		if (checkAll || !e.hasFileInfo())
+			entries << e;
+	}
+	locker.unlock();
+
+	// stat w/o locking the index
+	QVector<Entry> infos;
+
+	for (const Entry& e : entries) {
+		
+		QFileInfo fi(mDirPath, e.name);
+		qint64 size = fi.size();
+		qint64 modified = fi.lastModified().toMSecsSinceEpoch();
+
+		if (e.hasFileInfo() && e.size == size && e.modified == modified)
+			continue;
+
+		Entry info;
+		info.name = e.name;
+		info.size = size;
+		info.modified = modified;
+		info.created = fi.created().toMSecsSinceEpoch();
+		infos << info;
+	}
+
+	locker.relock();
+	for (const Entry& info : infos) {
+
+		int idx = mEntryIdx.value(info.name, -1);
+
+		// the file was updated while we stat'ed it (see setEntry)
+		if (idx == -1 || (mEntries[idx].size == info.size && mEntries[idx].modified == info.modified))
+			continue;
+
+		// exif date, rating, etc. are outdated too
+		mEntries[idx] = info;
+		mDirty = true;
+	}
+}
+
+QString DkFolderIndex::indexPath(const QString& dirPath) {
+
+	QByteArray hash = QCryptographicHash::hash(QDir::cleanPath(dirPath).toUtf8(), QCryptographicHash::Md5).toHex();
+	return DkUtils::getAppDataPath() + "/folder-index/" + QString::fromLatin1(hash) + ".idx";
+}
+
+qint64 DkFolderIndex::dirModified(const QString& dirPath) {
+
+	QFileInfo di(dirPath);
+
+	if (!di.exists())
+		return 0;
+
+	return di.lastModified().toMSecsSinceEpoch();
+}
+
+quint32 DkFolderIndex::filterHash() {
+	return qHash(DkSettingsManager::param().app().browseFilters.join(";"));
+}
+
+}
@@ -0,0 +1,124 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#pragma warning(pop)
+
+#pragma warning(disable: 4251)	// TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+
+namespace nmc {
+
+/**
+ * Persistent index of a folder.
+ * It stores the file list and per file attributes
+ * (size, dates, dimension, exif date, orientation, rating) 
+ * in the app data path. If the folder's modification date did
+ * not change, the file list can be used without listing the folder
+ * and images can be sorted by date without touching the files.
+ * The index is thread-safe so that it can be saved in the background.
+ **/ 
+class DllCoreExport DkFolderIndex {
+
+public:
+	DkFolderIndex(const QString& dirPath = QString());
+
+	struct Entry {
+		QString name;
+		qint64 size = -1;		// -1 if the file was not stat'ed yet
+		qint64 modified = 0;	// msecs since epoch
+		qint64 created = 0;
+		qint64 exifDate = 0;
+		int width = 0;
+		int height = 0;
+		int orientation = -1;	// -1 if unknown
+		int rating = -1;
+		qint64 thumbOffset = -1;
+
+		bool hasFileInfo() const;
+	};
+
+	enum {
+		min_files = 1000,		// smaller folders are not indexed
+	};
+
+	bool load();
+	bool save();
+	bool isLoaded() const;
+	bool isUpToDate() const;
+	bool isDirty() const;
+	bool isEmpty() const;
+
+	QString dirPath() const;
+	QStringList fileNames() const;
+	bool contains(const QString& fileName) const;
+	Entry entry(const QString& fileName) const;
+	void setEntry(const Entry& entry);
+	void update(const QStringList& fileNames, qint64 dirModified);
+
+	static void saveThreaded(QSharedPointer<DkFolderIndex> index);
+
+	static QString indexPath(const QString& dirPath);
+	static qint64 dirModified(const QString& dirPath);
+
+protected:
+	void updateFileInfos(bool checkAll = false);
+	static quint32 filterHash();
+
+	mutable QMutex mMutex;
+
+	QString mDirPath;
+	qint64 mDirModified = 0;
+	quint32 mFilterHash = 0;	// the file list depends on the browse filters
+	bool mLoaded = false;
+	bool mDirty = false;
+
+	QVector<Entry> mEntries;
+	QHash<QString, int> mEntryIdx;
+};
+
+}
@@ -0,0 +1,344 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#include "DkFolderTree.h"
+#include "DkImageLoader.h"
+#include "DkBasicLoader.h"
+#include "DkScheduler.h"
+#include "DkUtils.h"
+#include "DkTimer.h"
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QtConcurrentRun>
+#include <QDir>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <algorithm>
+#pragma warning(pop)	// no warnings from includes - end
+
+namespace nmc {
+
+// DkFolderTree --------------------------------------------------------------------
+DkFolderTree::DkFolderTree(const QString& rootPath, QObject* parent) : QObject(parent) {
+	
+	mRootPath = rootPath;
+	mToken = QSharedPointer<DkCancelToken>(new DkCancelToken());
+}
+
+DkFolderTree::~DkFolderTree() {
+
+	// running walks finish on their own - their results are dropped
+	mToken->cancel();
+}
+
+/**
+ * Walks the tree in the background.
+ **/ 
+void DkFolderTree::buildThreaded() {
+
+	if (mBuilding || isBuilt())
+		return;
+
+	mBuilding = true;
+	startWalk(mRootPath, QStringList(), false);
+}
+
+/**
+ * Rescans a folder of the tree in the background.
+ * Its image count is updated, new sub folders are walked and
+ * removed sub folders are dropped - the rest of the tree is kept.
+ * @param dirPath the folder that changed.
+ **/ 
+void DkFolderTree::updateThreaded(const QString& dirPath) {
+
+	if (!isBuilt() || imageCount(dirPath) == -1)
+		return;
+
+	QString prefix = dirPath.endsWith("/") ? dirPath : dirPath + "/";
+	QStringList knownSubDirs;
+
+	{
+		QMutexLocker locker(&mMutex);
+		for (const QString& f : mFolders) {
+			if (f.startsWith(prefix) && f.indexOf("/", prefix.length()) == -1)
+				knownSubDirs << f;
+		}
+	}
+
+	startWalk(dirPath, knownSubDirs, true);
+}
+
+void DkFolderTree::startWalk(const QString& dirPath, const QStringList& knownSubDirs, bool update) {
+
+	QSharedPointer<DkCancelToken> token = mToken;
+
+	QFutureWatcher<Walk>* watcher = new QFutureWatcher<Walk>(this);
+	connect(watcher, SIGNAL(finished()), this, SLOT(walkFinished()));
+
+	// the walker mostly waits for its scan tasks - so it does not take a scheduler slot
+	watcher->setFuture(QtConcurrent::run([dirPath, knownSubDirs, update, token]() {
+		Walk w = walk(dirPath, knownSubDirs, token);
+		w.update = update;
+		return w;
+	}));
+}
+
+bool DkFolderTree::isBuilt() const {
+
+	QMutexLocker locker(&mMutex);
+	return mBuilt;
+}
+
+/**
+ * Walks the folders below dirPath.
+ * Known sub folders of dirPath are not walked again.
+ * @param dirPath the folder to start with.
+ * @param knownSubDirs the sub folders of dirPath that are already in the tree.
+ * @param token stops the walk if canceled.
+ * @return Walk the folders found & their image counts.
+ **/ 
+DkFolderTree::Walk DkFolderTree::walk(const QString& dirPath, const QStringList& knownSubDirs, QSharedPointer<DkCancelToken> token) {
+
+	DkTimer dt;
+
+	struct Node {
+		QString path;
+		int numImages;
+		QStringList subDirs;
+	};
+
+	Walk w;
+	w.dirPath = dirPath;
+	QStringList folders;
+
+	QVector<Node> level;
+	Node root = {dirPath, 0, QStringList()};
+	level << root;
+
+	std::function<void(Node&)> scanNode = [token](Node& n) {
+		n.numImages = DkDirScanner::scan(n.path, std::function<void(const QStringList&)>(), token, &n.subDirs).size();
+	};
+
+	// breadth-first: all folders of a level are scanned in parallel
+	while (!level.empty() && folders.size() < max_folders && !token->isCanceled()) {
+
+		DkDecodeScheduler::instance().map<Node>(DkDecodeScheduler::priority_prefetch, level, scanNode).waitForFinished();
+
+		QVector<Node> nextLevel;
+
+		for (const Node& n : level) {
+
+			folders << n.path;
+			w.imageCounts.insert(n.path, n.numImages);
+
+			for (const QString& sd : n.subDirs) {
+
+				Node c = {QDir(n.path).filePath(sd), 0, QStringList()};
+
+				// known folders are kept as they are
+				if (n.path == dirPath && knownSubDirs.contains(c.path))
+					continue;
+
+				nextLevel << c;
+			}
+
+			if (n.path == dirPath) {
+				for (const QString& kd : knownSubDirs) {
+					if (!n.subDirs.contains(QFileInfo(kd).fileName()))
+						w.removed << kd;
+				}
+			}
+		}
+
+		level = nextLevel;
+	}
+
+	if (token->isCanceled())
+		return Walk();
+
+	// natural order of the full paths (same as DkUtils::compLogicQString)
+	QVector<QPair<QString, QString> > keys;
+	keys.reserve(folders.size());
+	for (const QString& f : folders)
+		keys << qMakePair(DkUtils::naturalSortKey(f), f);
+
+	std::sort(keys.begin(), keys.end());
+	
+	for (const QPair<QString, QString>& k : keys)
+		w.folders << k.second;
+
+	qInfo() << "[DkFolderTree]" << w.folders.size() << "folders below" << dirPath << "walked in" << dt;
+
+	return w;
+}
+
+void DkFolderTree::walkFinished() {
+
+	QFutureWatcher<Walk>* watcher = static_cast<QFutureWatcher<Walk>*>(QObject::sender());
+	Walk w = watcher->result();
+	watcher->deleteLater();
+
+	// canceled
+	if (w.dirPath.isEmpty())
+		return;
+
+	if (!w.update) {
+		{
+			QMutexLocker locker(&mMutex);
+			mFolders = w.folders;
+
+			// counts of the loader are more recent
+			for (auto it = w.imageCounts.constBegin(); it != w.imageCounts.constEnd(); it++) {
+				if (!mImageCounts.contains(it.key()))
+					mImageCounts.insert(it.key(), it.value());
+			}
+			mBuilt = true;
+		}
+
+		mBuilding = false;
+		emit builtSignal();
+		return;
+	}
+
+	{
+		QMutexLocker locker(&mMutex);
+
+		// drop removed folders & their sub folders
+		for (const QString& r : w.removed) {
+			
+			QString prefix = r + "/";
+			
+			for (int idx = mFolders.size()-1; idx >= 0; idx--) {
+				if (mFolders[idx] == r || mFolders[idx].startsWith(prefix)) {
+					mImageCounts.remove(mFolders[idx]);
+					mFolders.removeAt(idx);
+				}
+			}
+		}
+
+		for (auto it = w.imageCounts.constBegin(); it != w.imageCounts.constEnd(); it++)
+			mImageCounts.insert(it.key(), it.value());
+
+		for (const QString& f : w.folders)
+			insertFolder(f);
+	}
+
+	emit updatedSignal();
+}
+
+/**
+ * Inserts a folder at its (natural) position.
+ * The caller must hold the lock.
+ **/ 
+void DkFolderTree::insertFolder(const QString& dirPath) {
+
+	QString key = DkUtils::naturalSortKey(dirPath);
+
+	auto it = std::lower_bound(mFolders.begin(), mFolders.end(), key, [](const QString& f, const QString& k) {
+		return DkUtils::naturalSortKey(f) < k;
+	});
+
+	if (it != mFolders.end() && *it == dirPath)
+		return;
+
+	mFolders.insert(it, dirPath);
+}
+
+QString DkFolderTree::rootPath() const {
+	return mRootPath;
+}
+
+/**
+ * Returns all folders (naturally sorted).
+ * The list is empty until the tree is walked (see builtSignal).
+ **/ 
+QStringList DkFolderTree::folders() const {
+
+	QMutexLocker locker(&mMutex);
+	return mFolders;
+}
+
+/**
+ * Returns the number of images in a folder.
+ * @param dirPath the folder.
+ * @return int the number of images or -1 if the folder is unknown.
+ **/ 
+int DkFolderTree::imageCount(const QString& dirPath) const {
+
+	QMutexLocker locker(&mMutex);
+	return mImageCounts.value(dirPath, -1);
+}
+
+/**
+ * Updates the image count of a folder (e.g. if it was indexed).
+ * @param dirPath the folder.
+ * @param count the number of images.
+ **/ 
+void DkFolderTree::setImageCount(const QString& dirPath, int count) {
+
+	QMutexLocker locker(&mMutex);
+	mImageCounts.insert(dirPath, count);
+}
+
+/**
+ * Returns the next folder that contains images.
+ * Until the tree is walked, no folder is found.
+ * @param dirPath the current folder.
+ * @param step > 0 searches forward, < 0 backwards.
+ * @param loop if true, the search continues at the other end.
+ * @return QString the next non-empty folder or an empty string if there is none.
+ **/ 
+QString DkFolderTree::nextFolder(const QString& dirPath, int step, bool loop) const {
+
+	QMutexLocker locker(&mMutex);
+
+	int numFolders = mFolders.size();
+	int cIdx = mFolders.indexOf(dirPath);
+	int dir = step < 0 ? -1 : 1;
+
+	if (cIdx == -1 || numFolders < 2)
+		return QString();
+
+	for (int idx = 1; idx < numFolders; idx++) {
+
+		int nIdx = cIdx + dir * idx;
+
+		if (loop)
+			nIdx = (nIdx + numFolders) % numFolders;
+		else if (nIdx < 0 || nIdx >= numFolders)
+			break;
+
+		if (mImageCounts.value(mFolders[nIdx], 0) > 0)
+			return mFolders[nIdx];
+	}
+
+	return QString();
+}
+
+}
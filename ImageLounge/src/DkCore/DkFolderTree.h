@@ -0,0 +1,121 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QMutex>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#pragma warning(pop)
+
+#pragma warning(disable: 4251)	// TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+
+namespace nmc {
+
+// nomacs defines
+class DkCancelToken;
+
+/**
+ * The folder tree below a root folder.
+ * The tree is walked in parallel (one task per folder of 
+ * a level) and every folder's image count is cached. Hence
+ * the next non-empty folder is found without touching the disk.
+ * Counts are updated incrementally if the loader indexes a folder
+ * and changed folders are rescanned without walking the whole tree.
+ * The tree is empty until builtSignal is emitted - no call blocks.
+ * Walks never access the tree, so it can be deleted while they run.
+ **/ 
+class DllCoreExport DkFolderTree : public QObject {
+	Q_OBJECT
+
+public:
+	DkFolderTree(const QString& rootPath, QObject* parent = 0);
+	~DkFolderTree();
+
+	enum {
+		max_folders = 100000,	// stop walking crazy trees
+	};
+
+	void buildThreaded();
+	void updateThreaded(const QString& dirPath);
+	bool isBuilt() const;
+
+	QString rootPath() const;
+	QStringList folders() const;
+	int imageCount(const QString& dirPath) const;
+	void setImageCount(const QString& dirPath, int count);
+	QString nextFolder(const QString& dirPath, int step, bool loop) const;
+
+signals:
+	void builtSignal() const;
+	void updatedSignal() const;
+
+protected slots:
+	void walkFinished();
+
+protected:
+	struct Walk {
+		QString dirPath;
+		QStringList folders;			// naturally sorted, dirPath included
+		QHash<QString, int> imageCounts;
+		QStringList removed;			// known sub folders that do not exist anymore
+		bool update = false;
+	};
+
+	void startWalk(const QString& dirPath, const QStringList& knownSubDirs, bool update);
+	static Walk walk(const QString& dirPath, const QStringList& knownSubDirs, QSharedPointer<DkCancelToken> token);
+	void insertFolder(const QString& dirPath);
+
+	QString mRootPath;
+	QSharedPointer<DkCancelToken> mToken;
+	bool mBuilding = false;
+
+	mutable QMutex mMutex;
+	QStringList mFolders;				// naturally sorted, root included
+	QHash<QString, int> mImageCounts;	// folder -> number of images
+	bool mBuilt = false;
+};
+
+}
@@ -0,0 +1,239 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#include "DkFolderWatcher.h"
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <QFile>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+#pragma warning(pop)	// no warnings from includes - end
+
+namespace nmc {
+
+// DkFolderWatcher --------------------------------------------------------------------
+DkFolderWatcher::DkFolderWatcher(QObject* parent) : QObject(parent) {
+
+	// coalesce bursts of events
+	mFlushTimer.setSingleShot(true);
+	mFlushTimer.setInterval(150);
+	connect(&mFlushTimer, SIGNAL(timeout()), this, SLOT(flush()));
+
+#ifdef Q_OS_LINUX
+	mFd = inotify_init();
+
+	if (mFd != -1) {
+		fcntl(mFd, F_SETFL, fcntl(mFd, F_GETFL) | O_NONBLOCK);
+		fcntl(mFd, F_SETFD, FD_CLOEXEC);
+
+		mNotifier = new QSocketNotifier(mFd, QSocketNotifier::Read, this);
+		connect(mNotifier, SIGNAL(activated(int)), this, SLOT(readEvents()));
+	}
+	else
+		qWarning() << "[DkFolderWatcher] inotify is not available - falling back to QFileSystemWatcher";
+#endif
+
+	if (mFd == -1) {
+		mWatcher = new QFileSystemWatcher(this);
+		connect(mWatcher, SIGNAL(directoryChanged(const QString&)), this, SLOT(directoryChanged(const QString&)));
+	}
+}
+
+DkFolderWatcher::~DkFolderWatcher() {
+
+#ifdef Q_OS_LINUX
+	if (mFd != -1)
+		close(mFd);
+#endif
+}
+
+/**
+ * Watches a new folder.
+ * Nothing is done if the folder is already watched.
+ * @param dirPath the folder to be watched.
+ **/ 
+void DkFolderWatcher::setDir(const QString& dirPath) {
+
+	if (dirPath == mDirPath)
+		return;
+
+	mDirPath = dirPath;
+	mAdded.clear();
+	mRemoved.clear();
+	mRescan = false;
+
+#ifdef Q_OS_LINUX
+	if (mFd != -1) {
+
+		if (mWd != -1)
+			inotify_rm_watch(mFd, mWd);
+
+		mWd = mDirPath.isEmpty() ? -1 : inotify_add_watch(mFd, QFile::encodeName(mDirPath).constData(), 
+			IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+
+		if (mWd == -1 && !mDirPath.isEmpty())
+			qWarning() << "[DkFolderWatcher] cannot watch" << mDirPath;
+		return;
+	}
+#endif
+
+	if (mWatcher) {
+		if (!mWatcher->directories().isEmpty())
+			mWatcher->removePaths(mWatcher->directories());
+		if (!mDirPath.isEmpty())
+			mWatcher->addPath(mDirPath);
+	}
+}
+
+QString DkFolderWatcher::dirPath() const {
+	return mDirPath;
+}
+
+/**
+ * Pauses the watcher.
+ * Deltas are collected while paused and reported
+ * once the watcher is resumed (e.g. while saving).
+ * @param paused if true, no signals are emitted.
+ **/ 
+void DkFolderWatcher::setPaused(bool paused) {
+
+	mPaused = paused;
+
+	if (!mPaused && (mRescan || !mAdded.empty() || !mRemoved.empty()))
+		mFlushTimer.start();
+}
+
+void DkFolderWatcher::readEvents() {
+
+#ifdef Q_OS_LINUX
+	// inotify events are aligned to struct inotify_event
+	char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	for (;;) {
+
+		ssize_t len = read(mFd, buffer, sizeof(buffer));
+
+		if (len <= 0)
+			break;
+
+		for (char* ptr = buffer; ptr < buffer + len; ) {
+
+			const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				requestRescan();
+				continue;
+			}
+
+			// events of old watches might still be in the queue
+			if (event->wd != mWd)
+				continue;
+
+			if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+				requestRescan();
+				continue;
+			}
+
+			if ((event->mask & IN_ISDIR) || !event->len)
+				continue;
+
+			QString fileName = QFile::decodeName(event->name);
+
+			if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+				addFile(fileName);
+			else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				removeFile(fileName);
+		}
+	}
+#endif
+}
+
+void DkFolderWatcher::directoryChanged(const QString& dirPath) {
+
+	if (dirPath == mDirPath)
+		requestRescan();
+}
+
+void DkFolderWatcher::addFile(const QString& fileName) {
+
+	// renamed back and forth (e.g. editors that save to a temp file)
+	mRemoved.remove(fileName);
+	mAdded.insert(fileName);
+
+	if (!mPaused)
+		mFlushTimer.start();
+}
+
+void DkFolderWatcher::removeFile(const QString& fileName) {
+
+	// NOTE: we always report the removal since 'added' might have been an overwrite
+	mAdded.remove(fileName);
+	mRemoved.insert(fileName);
+
+	if (!mPaused)
+		mFlushTimer.start();
+}
+
+void DkFolderWatcher::requestRescan() {
+
+	mRescan = true;
+
+	if (!mPaused)
+		mFlushTimer.start();
+}
+
+void DkFolderWatcher::flush() {
+
+	if (mPaused)
+		return;
+
+	if (mRescan) {
+		qInfo() << "[DkFolderWatcher] full rescan of" << mDirPath;
+		emit dirChangedSignal(mDirPath);
+	}
+	else {
+		if (!mRemoved.empty())
+			emit filesRemovedSignal(mDirPath, mRemoved.toList());
+		if (!mAdded.empty())
+			emit filesAddedSignal(mDirPath, mAdded.toList());
+	}
+
+	mAdded.clear();
+	mRemoved.clear();
+	mRescan = false;
+}
+
+}
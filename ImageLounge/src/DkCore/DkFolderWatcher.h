@@ -0,0 +1,106 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QObject>
+#include <QStringList>
+#include <QSet>
+#include <QTimer>
+#pragma warning(pop)
+
+#pragma warning(disable: 4251)	// TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+class QFileSystemWatcher;
+class QSocketNotifier;
+
+namespace nmc {
+
+/**
+ * Watches the current folder and reports file deltas.
+ * On linux inotify events are translated to added & removed
+ * files. Events are coalesced so that a burst (e.g. a tethered
+ * camera) results in a single update. If the kernel's event 
+ * queue overflows or deltas are not available (other platforms), 
+ * dirChangedSignal requests a full rescan.
+ **/ 
+class DllCoreExport DkFolderWatcher : public QObject {
+	Q_OBJECT
+
+public:
+	DkFolderWatcher(QObject* parent = 0);
+	~DkFolderWatcher();
+
+	void setDir(const QString& dirPath);
+	QString dirPath() const;
+	void setPaused(bool paused);
+
+signals:
+	void filesAddedSignal(const QString& dirPath, const QStringList& fileNames) const;
+	void filesRemovedSignal(const QString& dirPath, const QStringList& fileNames) const;
+	void dirChangedSignal(const QString& dirPath) const;
+
+protected slots:
+	void readEvents();
+	void flush();
+	void directoryChanged(const QString& dirPath);
+
+protected:
+	void addFile(const QString& fileName);
+	void removeFile(const QString& fileName);
+	void requestRescan();
+
+	QString mDirPath;
+	bool mPaused = false;
+
+	// pending deltas
+	QSet<QString> mAdded;
+	QSet<QString> mRemoved;
+	bool mRescan = false;
+
+	QTimer mFlushTimer;
+
+	int mFd = -1;
+	int mWd = -1;
+	QSocketNotifier* mNotifier = 0;
+	QFileSystemWatcher* mWatcher = 0;
+};
+
+}
@@ -0,0 +1,275 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#include "DkImageCache.h"
+#include "DkImageContainer.h"
+#include "DkSettings.h"
+#include "DkTimer.h"
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QFileInfo>
+#include <QDebug>
+#pragma warning(pop)
+
+namespace nmc {
+
+// DkImageCache --------------------------------------------------------------------
+DkImageCache::DkImageCache() {
+	mNavTimer.start();
+}
+
+DkImageCache::~DkImageCache() {
+
+	if (mHits + mMisses > 0)
+		qInfo() << "[Cacher]" << statistics();
+}
+
+/**
+ * Must be called if the user requests an image (before loading it).
+ * Updates the hit/miss statistics and drops stale entries
+ * (i.e. the file was modified after it was cached).
+ * @param img the requested image
+ **/ 
+void DkImageCache::request(QSharedPointer<DkImageContainerT> img) {
+
+	if (!img)
+		return;
+
+	auto e = mEntries.find(img->filePath());
+
+	if (e != mEntries.end() && e->modified != QFileInfo(img->filePath()).lastModified()) {
+		qDebug() << "[Cacher]" << img->fileName() << "changed on disk - dropping it";
+		e->image->clear();
+		remove(img->filePath());
+		e = mEntries.end();
+	}
+
+	// prefetches that are still decoding count as hits too
+	int ls = img->getLoadState();
+	if (e != mEntries.end() && (ls == DkImageContainerT::loaded || ls == DkImageContainerT::loading))
+		mHits++;
+	else
+		mMisses++;
+
+	insert(img);
+}
+
+/**
+ * Updates the cache if the current image changed.
+ * Images in the direction of travel are prefetched - the faster
+ * the user browses the further we look ahead. The image next to 
+ * the current one is decoded, the others are just read to memory.
+ * Least recently used images are released if the budget is exceeded.
+ * @param images the images of the current folder
+ * @param cIdx the current image's index
+ **/ 
+void DkImageCache::update(const QVector<QSharedPointer<DkImageContainerT> >& images, int cIdx) {
+
+	if (cIdx < 0 || cIdx >= images.size())
+		return;
+
+	DkTimer dt;
+	updateNavigation(cIdx);
+
+	QSharedPointer<DkImageContainerT> cImg = images.at(cIdx);
+	QList<DkImageContainerT*> pinned;
+	pinned << cImg.data();
+	insert(cImg);
+
+	// keep the image we came from
+	int lIdx = cIdx - mDirection;
+	if (lIdx >= 0 && lIdx < images.size())
+		pinned << images.at(lIdx).data();
+
+	// edited images are not cached
+	for (const QString& fp : mLru.mid(1)) {
+
+		QSharedPointer<DkImageContainerT> img = mEntries.value(fp).image;
+		if (img->isEdited()) {
+			img->clear();
+			remove(fp);
+		}
+	}
+
+	float budget = DkSettingsManager::param().resources().cacheMemory;
+	double mem = memoryUsage();
+	int la = lookahead();
+
+	for (int idx = 1; idx <= la; idx++) {
+
+		int pIdx = cIdx + mDirection * idx;
+		if (pIdx < 0 || pIdx >= images.size())
+			break;
+
+		QSharedPointer<DkImageContainerT> pImg = images.at(pIdx);
+		pinned << pImg.data();
+
+		if (mem >= budget)
+			break;
+
+		if (pImg->getLoadState() == DkImageContainerT::not_loaded) {
+
+			// fully load the next image - just fetch the files of the others
+			if (idx == 1) {
+				pImg->loadImageThreaded();
+				qDebug() << "[Cacher]" << pImg->fileName() << "fully cached...";
+			}
+			else {
+				pImg->fetchFile();
+				qDebug() << "[Cacher]" << pImg->fileName() << "file fetched...";
+			}
+
+			// estimate the memory since loading is threaded
+			mem += pImg->getFileSize() * (idx == 1 ? 2.0 : 1.0);
+		}
+
+		insert(pImg, false);
+	}
+
+	evict(pinned);
+
+	qDebug() << "[Cacher] updated in" << dt << "lookahead:" << la << "direction:" << mDirection 
+		<< QString("(%1 MB)").arg(memoryUsage(), 0, 'f', 1) << statistics();
+}
+
+/**
+ * Forgets all cached images (e.g. if the folder changed).
+ * The images are not released explicitly since they might still 
+ * be in use (e.g. the current image) - the memory is freed as soon
+ * as the containers are deleted.
+ **/ 
+void DkImageCache::clear() {
+
+	mEntries.clear();
+	mLru.clear();
+	mLastIdx = -1;
+	mSpeed = 0.0;
+}
+
+int DkImageCache::hits() const {
+	return mHits;
+}
+
+int DkImageCache::misses() const {
+	return mMisses;
+}
+
+double DkImageCache::memoryUsage() const {
+
+	double mem = 0.0;
+
+	for (const Entry& e : mEntries)
+		mem += e.image->getMemoryUsage();
+
+	return mem;
+}
+
+QString DkImageCache::statistics() const {
+
+	int total = mHits + mMisses;
+	double rate = total > 0 ? 100.0 * mHits / total : 0.0;
+
+	return QString("hits: %1 misses: %2 (%3%)").arg(mHits).arg(mMisses).arg(rate, 0, 'f', 1);
+}
+
+void DkImageCache::insert(QSharedPointer<DkImageContainerT> img, bool front) {
+
+	const QString& fp = img->filePath();
+
+	if (mEntries.contains(fp))
+		mLru.removeOne(fp);
+	else {
+		Entry e;
+		e.image = img;
+		e.modified = QFileInfo(fp).lastModified();
+		mEntries.insert(fp, e);
+	}
+
+	// prefetched images are added behind the images the user has seen
+	if (front)
+		mLru.prepend(fp);
+	else
+		mLru.append(fp);
+}
+
+void DkImageCache::remove(const QString& filePath) {
+
+	mEntries.remove(filePath);
+	mLru.removeOne(filePath);
+}
+
+void DkImageCache::updateNavigation(int cIdx) {
+
+	if (mLastIdx != -1 && cIdx != mLastIdx) {
+
+		int step = cIdx - mLastIdx;
+		double ivl = qMax(mNavTimer.restart(), (qint64)1) / 1000.0;
+		double speed = qAbs(step) / ivl;
+
+		// restart the estimate if the user paused
+		mSpeed = (ivl > 3.0) ? 0.0 : 0.5 * mSpeed + 0.5 * speed;
+		mDirection = step > 0 ? 1 : -1;
+	}
+
+	mLastIdx = cIdx;
+}
+
+/**
+ * Returns the number of images to prefetch.
+ * One image per second of navigation speed is added to the
+ * next image - bounded by maxImagesCached.
+ * @return int the number of images prefetched
+ **/ 
+int DkImageCache::lookahead() const {
+
+	int maxImages = qMax(DkSettingsManager::param().resources().maxImagesCached, 1);
+	return qBound(1, 1 + qRound(mSpeed), maxImages);
+}
+
+void DkImageCache::evict(const QList<DkImageContainerT*>& pinned) {
+
+	float budget = DkSettingsManager::param().resources().cacheMemory;
+	double mem = memoryUsage();
+
+	for (int idx = mLru.size() - 1; idx >= 0 && mem > budget; idx--) {
+
+		const QString fp = mLru.at(idx);
+		QSharedPointer<DkImageContainerT> img = mEntries.value(fp).image;
+
+		if (pinned.contains(img.data()))
+			continue;
+
+		mem -= img->getMemoryUsage();
+		img->clear();
+		remove(fp);
+
+		qDebug() << "[Cacher]" << fp << "freed";
+	}
+}
+
+}
@@ -0,0 +1,106 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QSharedPointer>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#pragma warning(pop)
+
+#pragma warning(disable: 4251)	// TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+
+namespace nmc {
+
+// nomacs defines
+class DkImageContainerT;
+
+/**
+ * Keeps decoded images of the current folder in memory.
+ * Entries are keyed by file path and modification date so that
+ * changed files are never served from the cache. Images are 
+ * evicted in LRU order if the memory budget (cacheMemory) is 
+ * exceeded. Prefetching follows the direction of travel and 
+ * looks further ahead if the user navigates fast.
+ **/ 
+class DllCoreExport DkImageCache {
+
+public:
+	DkImageCache();
+	~DkImageCache();
+
+	void request(QSharedPointer<DkImageContainerT> img);
+	void update(const QVector<QSharedPointer<DkImageContainerT> >& images, int cIdx);
+	void clear();
+
+	int hits() const;
+	int misses() const;
+	double memoryUsage() const;
+	QString statistics() const;
+
+protected:
+	struct Entry {
+		QSharedPointer<DkImageContainerT> image;
+		QDateTime modified;
+	};
+
+	void insert(QSharedPointer<DkImageContainerT> img, bool front = true);
+	void remove(const QString& filePath);
+	void updateNavigation(int cIdx);
+	void evict(const QList<DkImageContainerT*>& pinned);
+	int lookahead() const;
+
+	QHash<QString, Entry> mEntries;
+	QList<QString> mLru;		// most recently used first
+
+	int mLastIdx = -1;
+	int mDirection = 1;
+	double mSpeed = 0.0;		// images per second (smoothed)
+	QElapsedTimer mNavTimer;
+
+	int mHits = 0;
+	int mMisses = 0;
+};
+
+}
@@ -28,16 +28,20 @@
 #include "DkImageContainer.h"
 #include "DkImageStorage.h"
 #include "DkMetaData.h"
+#include "DkMetaDataWriter.h"
 #include "DkThumbs.h"
 #include "DkBasicLoader.h"
 #include "DkSettings.h"
 #include "DkUtils.h"
 #include "DkTimer.h"
+#include "DkScheduler.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QObject>
 #include <QImage>
 #include <QtConcurrentRun>
+#include <QApplication>
+#include <QDesktopWidget>
 
 // quazip
 #ifdef WITH_QUAZIP
@@ -62,6 +66,7 @@ QString DkZipContainer::mZipMarker = "dIrChAr";
  **/ 
 DkImageContainer::DkImageContainer(const QString& filePath) {
 	
+	mSharedMetaData = QSharedPointer<DkSharedMetaData>(new DkSharedMetaData());
 	setFilePath(filePath);
 	init();
 }
@@ -115,8 +120,7 @@ void DkImageContainer::clear() {
 
 	if (mLoader)
 		mLoader->release();
-	if (mFileBuffer)
-		mFileBuffer->clear();
+	mFileBuffer.clear();	// releases (unmaps) the buffer
 	init();
 }
 
@@ -207,11 +211,18 @@ QSharedPointer<DkBasicLoader> DkImageContainer::getLoader() {
 
 	if (!mLoader) {
 		mLoader = QSharedPointer<DkBasicLoader>(new DkBasicLoader());
+		mLoader->setSharedMetaData(mSharedMetaData);
 	}
 
 	return mLoader;
 }
 
+/**
+ * Returns the image's metadata.
+ * The metadata is parsed once per file (by the loader or the preview)
+ * and shared with thumbnails and widgets.
+ * @return QSharedPointer<DkMetaDataT> the metadata.
+ **/ 
 QSharedPointer<DkMetaDataT> DkImageContainer::getMetaData() {
 
 	return getLoader()->getMetaData();
@@ -228,6 +239,7 @@ QSharedPointer<DkThumbNailT> DkImageContainer::getThumb() {
 #else
 		mThumb = QSharedPointer<DkThumbNailT>(new DkThumbNailT(mFilePath));
 #endif	
+		mThumb->setMetaData(mSharedMetaData);
 	}
 
 	return mThumb;
@@ -241,6 +253,7 @@ QSharedPointer<DkImageContainerT> DkImageContainerT::fromImageContainer(QSharedP
 	QSharedPointer<DkImageContainerT> imgCT = QSharedPointer<DkImageContainerT>(new DkImageContainerT(imgC->filePath()));
 	
 	imgCT->mLoader = imgC->getLoader();
+	imgCT->mSharedMetaData = imgCT->mLoader->sharedMetaData();
 	imgCT->mEdited = imgC->isEdited();
 	imgCT->mSelected = imgC->isSelected();
 	imgCT->mThumb = imgC->getThumb();
@@ -353,6 +366,7 @@ void DkImageContainer::setFilePath(const QString& filePath) {
 
 	mFilePath = filePath;
 	mFileInfo = filePath;
+	invalidateSortKeys();
 
 #ifdef Q_OS_WIN
 #if QT_VERSION < 0x050000
@@ -418,27 +432,63 @@ bool DkImageContainer::saveImage(const QString& filePath, const QImage saveImg,
 
 QSharedPointer<QByteArray> DkImageContainer::loadFileToBuffer(const QString& filePath) {
 
+	QString zipFilePath, zipImageFile;
+	zipFilePaths(zipFilePath, zipImageFile);
+
+	return loadFileToBufferIntern(filePath, isFromZip(), zipFilePath, zipImageFile);
+}
+
+/**
+ * Returns the archive's and the image's path if the image is from a zip file.
+ * @param zipFilePath the zip file's path
+ * @param zipImageFile the image's path within the zip file
+ **/ 
+void DkImageContainer::zipFilePaths(QString& zipFilePath, QString& zipImageFile) {
+
+#ifdef WITH_QUAZIP
+	if (isFromZip()) {
+		zipFilePath = getZipData()->getZipFilePath();
+		zipImageFile = getZipData()->getImageFileName();
+	}
+#else
+	Q_UNUSED(zipFilePath);
+	Q_UNUSED(zipImageFile);
+#endif
+}
+
+/**
+ * Loads a file to a buffer.
+ * This function is static (it runs on the scheduler) - it must not access the container.
+ * @param filePath the file's path
+ * @param fromZip if true, the image is extracted from zipFilePath
+ * @param zipFilePath the zip file's path
+ * @param zipImageFile the image's path within the zip file
+ * @return QSharedPointer<QByteArray> the file's buffer
+ **/ 
+QSharedPointer<QByteArray> DkImageContainer::loadFileToBufferIntern(const QString& filePath, bool fromZip, const QString& zipFilePath, const QString& zipImageFile) {
+
 	QFileInfo fInfo = filePath;
 
 	if (fInfo.isSymLink())
 		fInfo = fInfo.symLinkTarget();
 
 #ifdef WITH_QUAZIP
-	if (isFromZip()) 
-		return getZipData()->extractImage(getZipData()->getZipFilePath(), getZipData()->getImageFileName());
+	if (fromZip) 
+		return DkZipContainer::extractImage(zipFilePath, zipImageFile);
+#else
+	Q_UNUSED(fromZip);
+	Q_UNUSED(zipFilePath);
+	Q_UNUSED(zipImageFile);
 #endif
 
 	if (fInfo.suffix().contains("psd")) {	// for now just psd's are not cached because their file might be way larger than the part we need to read
 		return QSharedPointer<QByteArray>(new QByteArray());
 	}
 
-	QFile file(fInfo.absoluteFilePath());
-	file.open(QIODevice::ReadOnly);
+	// queued metadata edits must be written before we read the file
+	DkMetaDataWriter::instance().write(filePath);
 
-	QSharedPointer<QByteArray> ba(new QByteArray(file.readAll()));
-	file.close();
-
-	return ba;
+	return DkMappedBuffer::read(fInfo.absoluteFilePath());
 }
 
 
@@ -513,6 +563,74 @@ std::wstring DkImageContainer::getFileNameWStr() const {
 }
 #endif
 
+/**
+ * Returns the file name's natural sort key.
+ * The key is computed once (see DkUtils::naturalSortKey).
+ **/ 
+QString DkImageContainer::sortName() const {
+
+	if (mSortName.isEmpty())
+		mSortName = DkUtils::naturalSortKey(fileName());
+
+	return mSortName;
+}
+
+qint64 DkImageContainer::sortDateCreated() const {
+
+	if (!mSortDatesValid)
+		updateSortDates();
+
+	return mSortCreated;
+}
+
+qint64 DkImageContainer::sortDateModified() const {
+
+	if (!mSortDatesValid)
+		updateSortDates();
+
+	return mSortModified;
+}
+
+/**
+ * Computes the keys needed for a sort mode.
+ * Call this (threaded) before sorting to move 
+ * the file system access out of the comparisons.
+ * @param sortMode the DkSettings::sortMode
+ **/ 
+void DkImageContainer::prepareSortKeys(int sortMode) const {
+
+	sortName();	// used for ties too
+
+	if (sortMode == DkSettings::sort_date_created || sortMode == DkSettings::sort_date_modified)
+		sortDateCreated();
+}
+
+/**
+ * Sets the dates used for sorting (e.g. from the folder index).
+ * @param created the creation date in msecs since epoch.
+ * @param modified the modification date in msecs since epoch.
+ **/ 
+void DkImageContainer::setSortDates(qint64 created, qint64 modified) {
+
+	mSortCreated = created;
+	mSortModified = modified;
+	mSortDatesValid = true;
+}
+
+void DkImageContainer::updateSortDates() const {
+
+	QFileInfo fi(mFilePath);
+	mSortCreated = fi.created().toMSecsSinceEpoch();
+	mSortModified = fi.lastModified().toMSecsSinceEpoch();
+	mSortDatesValid = true;
+}
+
+void DkImageContainer::invalidateSortKeys() {
+
+	mSortName.clear();
+	mSortDatesValid = false;
+}
+
 bool imageContainerLessThanPtr(const QSharedPointer<DkImageContainer> l, const QSharedPointer<DkImageContainer> r) {
 
 	if (!l || !r)
@@ -523,51 +641,39 @@ bool imageContainerLessThanPtr(const QSharedPointer<DkImageContainer> l, const Q
 
 bool imageContainerLessThan(const DkImageContainer& l, const DkImageContainer& r) {
 
-	switch(DkSettingsManager::param().global().sortMode) {
+	bool asc = DkSettingsManager::param().global().sortDir == DkSettings::sort_ascending;
 
-	case DkSettings::sort_filename:
-#ifdef Q_OS_WIN
-		// not beautiful if you take a look at the code, but:
-		// time on Win8 with compFilename:
-		//		WinAPI, indexed ( 73872 ) files in:  " 92 ms"
-		//		[DkImageLoader]  73872  containers created in  " 1.825 sec"
-		//		[DkImageLoader] after sorting:  " 52.246 sec"
-		// time on Win8 with direct wCompLogic:
-		//		WinAPI, indexed ( 73872 ) files in:  " 63 ms"
-		//		[DkImageLoader]  73872  containers created in  " 1.203 sec"
-		//		[DkImageLoader] after sorting:  " 14.407 sec"
-		if (DkSettingsManager::param().global().sortDir == DkSettings::sort_ascending)
-			return DkUtils::wCompLogic(l.getFileNameWStr(), r.getFileNameWStr());
-		else
-			return !DkUtils::wCompLogic(l.getFileNameWStr(), r.getFileNameWStr());
-		break;
-#else
-		if (DkSettingsManager::param().global().sortDir == DkSettings::sort_ascending)
-			return DkUtils::compFilename(l.fileInfo(), r.fileInfo());
-		else
-			return DkUtils::compFilenameInv(l.fileInfo(), r.fileInfo());
-		break;
-#endif
+	// NOTE: all comparisons are based on cached keys - so we never touch the file system here
+	// the filename is the tie breaker since the keys of img01 and img1 are the same
+	auto compName = [&l, &r]() {
+		int c = QString::compare(l.sortName(), r.sortName());
+		return c != 0 ? c : QString::compare(l.fileName(), r.fileName());
+	};
 
-	case DkSettings::sort_date_created:
-		if (DkSettingsManager::param().global().sortDir == DkSettings::sort_ascending)
-			return DkUtils::compDateCreated(l.fileInfo(), r.fileInfo());
-		else
-			return DkUtils::compDateCreatedInv(l.fileInfo(), r.fileInfo());
-		break;
+	switch(DkSettingsManager::param().global().sortMode) {
 
-	case DkSettings::sort_date_modified:
-		if (DkSettingsManager::param().global().sortDir == DkSettings::sort_ascending)
-			return DkUtils::compDateModified(l.fileInfo(), r.fileInfo());
-		else
-			return DkUtils::compDateModifiedInv(l.fileInfo(), r.fileInfo());
+	case DkSettings::sort_date_created: {
+		qint64 lc = l.sortDateCreated();
+		qint64 rc = r.sortDateCreated();
+
+		if (lc != rc)
+			return asc ? lc < rc : rc < lc;
+		return compName() < 0;
+	}
+	case DkSettings::sort_date_modified: {
+		qint64 lm = l.sortDateModified();
+		qint64 rm = r.sortDateModified();
 
+		if (lm != rm)
+			return asc ? lm < rm : rm < lm;
+		return compName() < 0;
+	}
 	case DkSettings::sort_random:
 		return DkUtils::compRandom(l.fileInfo(), r.fileInfo());
 
+	case DkSettings::sort_filename:
 	default:
-		// filename
-		return DkUtils::compFilename(l.fileInfo(), r.fileInfo());
+		return asc ? compName() < 0 : compName() > 0;
 	}
 	
 }
@@ -589,6 +695,8 @@ DkImageContainerT::~DkImageContainerT() {
 	mBufferWatcher.cancel();
 	mImageWatcher.blockSignals(true);
 	mImageWatcher.cancel();
+	mPreviewWatcher.blockSignals(true);
+	mPreviewWatcher.cancel();
 
 	saveMetaData();
 
@@ -604,6 +712,7 @@ void DkImageContainerT::clear() {
 	if (mFetchingImage || mFetchingBuffer)
 		return;
 
+	mPreview = QImage();
 	DkImageContainer::clear();
 }
 
@@ -627,6 +736,9 @@ void DkImageContainerT::checkForFileUpdates() {
 	if (mWaitForUpdate != update_loading && mFileInfo.lastModified() != modifiedBefore)
 		mWaitForUpdate = update_pending;
 
+	if (mFileInfo.lastModified() != modifiedBefore)
+		mSortDatesValid = false;
+
 #ifdef WITH_QUAZIP
 	if(isFromZip()) 
 		setFilePath(getZipData()->getImageFileName());
@@ -675,6 +787,7 @@ bool DkImageContainerT::loadImageThreaded(bool force) {
 		qDebug() << "updating image...";
 		getThumb()->setImage(QImage());
 		clear();
+		mSharedMetaData->invalidate();	// the file needs to be parsed again
 	}
 
 	// null file?
@@ -725,8 +838,14 @@ void DkImageContainerT::fetchFile() {
 	mFetchingBuffer = true;	// saves the threaded call
 	connect(&mBufferWatcher, SIGNAL(finished()), this, SLOT(bufferLoaded()), Qt::UniqueConnection);
 
-	mBufferWatcher.setFuture(QtConcurrent::run(this, 
-		&nmc::DkImageContainerT::loadFileToBuffer, filePath()));
+	// the task must not access this container (it might be deleted meanwhile)
+	QString fp = filePath();
+	bool fromZip = isFromZip();
+	QString zipFilePath, zipImageFile;
+	zipFilePaths(zipFilePath, zipImageFile);
+
+	mBufferWatcher.setFuture(DkDecodeScheduler::instance().run<QSharedPointer<QByteArray> >(decodePriority(), 
+		[fp, fromZip, zipFilePath, zipImageFile]() { return loadFileToBufferIntern(fp, fromZip, zipFilePath, zipImageFile); }, mDecodeId));
 }
 
 void DkImageContainerT::bufferLoaded() {
@@ -736,8 +855,10 @@ void DkImageContainerT::bufferLoaded() {
 	if (!mBufferWatcher.isCanceled())
 		mFileBuffer = mBufferWatcher.result();
 
-	if (getLoadState() == loading)
+	if (getLoadState() == loading) {
+		fetchPreview();
 		fetchImage();
+	}
 	else if (getLoadState() == loading_canceled) {
 		mLoadState = not_loaded;
 		clear();
@@ -763,15 +884,125 @@ void DkImageContainerT::fetchImage() {
 	qInfoClean() << "loading " << filePath();
 	mFetchingImage = true;
 
+	renewCancelToken();
+	getLoader()->setCancelToken(mCancelToken);
+
 	connect(&mImageWatcher, SIGNAL(finished()), this, SLOT(imageLoaded()), Qt::UniqueConnection);
 
-	mImageWatcher.setFuture(QtConcurrent::run(this, 
-		&nmc::DkImageContainerT::loadImageIntern, filePath(), mLoader, mFileBuffer));
+	QString fp = filePath();
+	QSharedPointer<DkBasicLoader> loader = mLoader;
+	QSharedPointer<QByteArray> ba = mFileBuffer;
+	mImageWatcher.setFuture(DkDecodeScheduler::instance().run<QSharedPointer<DkBasicLoader> >(decodePriority(), 
+		[fp, loader, ba]() { return loadImageIntern(fp, loader, ba); }, mDecodeId));
+}
+
+/**
+ * Loads a preview of the image while the full image is decoded.
+ * RAW files show their embedded preview and large JPEGs are
+ * decoded at screen resolution. The preview is only loaded
+ * for the current image (not for images that are cached).
+ **/ 
+void DkImageContainerT::fetchPreview() {
+
+	if (!DkSettingsManager::param().resources().progressiveLoading || !mSelected || mFetchingPreview)
+		return;
+
+	if (getLoader()->hasImage() || !mFileBuffer || mFileBuffer->isEmpty())
+		return;
+
+	DkFormatProbe::Format fmt = DkFormatProbe::probe(DkFormatProbe::readHeader(filePath(), mFileBuffer), fileInfo().suffix());
+
+	// the full image is the preview anyway
+	if (fmt == DkFormatProbe::fmt_raw && DkSettingsManager::param().resources().loadRawThumb == DkSettings::raw_thumb_always)
+		return;
+
+	// decoding small jpgs is fast enough
+	const int previewMinFileSize = 2 * 1024 * 1024;
+	if (fmt != DkFormatProbe::fmt_raw && (fmt != DkFormatProbe::fmt_jpg || mFileBuffer->size() < previewMinFileSize))
+		return;
+
+	QSize screenSize = QApplication::desktop()->screenGeometry().size();
+
+	mFetchingPreview = true;
+	renewCancelToken();
+	connect(&mPreviewWatcher, SIGNAL(finished()), this, SLOT(previewLoaded()), Qt::UniqueConnection);
+
+	QString fp = filePath();
+	QSharedPointer<QByteArray> ba = mFileBuffer;
+	QSharedPointer<DkCancelToken> token = mCancelToken;
+	QSharedPointer<DkSharedMetaData> metaData = mSharedMetaData;
+	mPreviewWatcher.setFuture(DkDecodeScheduler::instance().run<QImage>(DkDecodeScheduler::priority_display, 
+		[fp, ba, fmt, screenSize, token, metaData]() { return loadPreviewIntern(fp, ba, (int)fmt, screenSize, token, metaData); }, mDecodeId));
+}
+
+/**
+ * Creates a new cancel token if the current one was canceled.
+ * Tokens that were not canceled are shared by the preview and the full decode.
+ **/ 
+void DkImageContainerT::renewCancelToken() {
+
+	if (!mCancelToken || mCancelToken->isCanceled())
+		mCancelToken = QSharedPointer<DkCancelToken>(new DkCancelToken());
+}
+
+void DkImageContainerT::previewLoaded() {
+
+	mFetchingPreview = false;
+
+	// the full image was faster
+	if (getLoadState() != loading || getLoader()->hasImage())
+		return;
+
+	mPreview = mPreviewWatcher.result();
+
+	if (!mPreview.isNull())
+		emit previewLoadedSignal();
+}
+
+QImage DkImageContainerT::loadPreviewIntern(const QString& filePath, const QSharedPointer<QByteArray> fileBuffer, int format, const QSize& minSize, QSharedPointer<DkCancelToken> token, QSharedPointer<DkSharedMetaData> sharedMetaData) {
+
+	DkTimer dt;
+	DkBasicLoader loader;
+	loader.setCancelToken(token);
+	loader.setSharedMetaData(sharedMetaData);	// the full decode won't parse the metadata again
+	QImage img;
+
+	try {
+		if (format == DkFormatProbe::fmt_raw) {
+
+			QSharedPointer<DkMetaDataT> metaData = sharedMetaData->metaData(filePath, fileBuffer);
+			img = metaData->getPreviewImage();
+
+			int orientation = metaData->getOrientationDegree();
+			if (!img.isNull() && orientation != -1 && !DkSettingsManager::param().metaData().ignoreExifOrientation)
+				img = loader.rotate(img, orientation);
+		}
+		else {
+			loader.setMinSize(minSize);
+
+			// do not show a preview if it is not smaller than the image
+			if (loader.loadGeneral(filePath, fileBuffer, true, true) && loader.isScaled())
+				img = loader.image();
+		}
+	}
+	catch (...) {
+		qWarning() << "[DkImageContainer] exception caught while loading the preview";
+	}
+
+	if (!img.isNull())
+		qDebug() << "[DkImageContainer] preview loaded in" << dt;
+
+	return img;
+}
+
+QImage DkImageContainerT::previewImage() const {
+	return mPreview;
 }
 
 void DkImageContainerT::imageLoaded() {
 
 	mFetchingImage = false;
+	mPreview = QImage();
 
 	if (getLoadState() == loading_canceled) {
 		mLoadState = not_loaded;
@@ -779,6 +1010,13 @@ void DkImageContainerT::imageLoaded() {
 		return;
 	}
 
+	// we were canceled but requested again while decoding - start over
+	if (mCancelToken && mCancelToken->isCanceled()) {
+		qDebug() << "[DkImageContainer] restarting canceled decode of" << fileName();
+		fetchImage();
+		return;
+	}
+
 	// deliver image
 	mLoader = mImageWatcher.result();
 
@@ -825,7 +1063,7 @@ void DkImageContainerT::loadingFinished() {
 
 	// clear file buffer if it exceeds a certain size?! e.g. psd files
 	if (mFileBuffer && mFileBuffer->size()/(1024.0f*1024.0f) > DkSettingsManager::param().resources().cacheMemory*0.5f)
-		mFileBuffer->clear();
+		mFileBuffer.clear();
 	
 	mLoadState = loaded;
 	emit fileLoadedSignal(true);
@@ -885,6 +1123,10 @@ void DkImageContainerT::cancel() {
 		return;
 
 	mLoadState = loading_canceled;
+
+	// stop running decoders (they check the token between strips, rows and stages)
+	if (mCancelToken)
+		mCancelToken->cancel();
 }
 
 void DkImageContainerT::receiveUpdates(QObject* obj, bool connectSignals /* = true */) {
@@ -896,6 +1138,7 @@ void DkImageContainerT::receiveUpdates(QObject* obj, bool connectSignals /* = tr
 		connect(this, SIGNAL(showInfoSignal(const QString&, int, int)), obj, SIGNAL(showInfoSignal(const QString&, int, int)), Qt::UniqueConnection);
 		connect(this, SIGNAL(fileSavedSignal(const QString&, bool, bool)), obj, SLOT(imageSaved(const QString&, bool, bool)), Qt::UniqueConnection);
 		connect(this, SIGNAL(imageUpdatedSignal()), obj, SLOT(currentImageUpdated()), Qt::UniqueConnection);
+		connect(this, SIGNAL(previewLoadedSignal()), obj, SLOT(imagePreviewLoaded()), Qt::UniqueConnection);
 		mFileUpdateTimer.start();
 	}
 	else if (!connectSignals) {
@@ -904,21 +1147,35 @@ void DkImageContainerT::receiveUpdates(QObject* obj, bool connectSignals /* = tr
 		disconnect(this, SIGNAL(showInfoSignal(const QString&, int, int)), obj, SIGNAL(showInfoSignal(const QString&, int, int)));
 		disconnect(this, SIGNAL(fileSavedSignal(const QString&, bool, bool)), obj, SLOT(imageSaved(const QString&, bool, bool)));
 		disconnect(this, SIGNAL(imageUpdatedSignal()), obj, SLOT(currentImageUpdated()));
+		disconnect(this, SIGNAL(previewLoadedSignal()), obj, SLOT(imagePreviewLoaded()));
 		mFileUpdateTimer.stop();
 	}
 
+	// a prefetched image that becomes the current image jumps the queue
+	if (mSelected != connectSignals)
+		DkDecodeScheduler::instance().reprioritize(mDecodeId, 
+			connectSignals ? DkDecodeScheduler::priority_current : DkDecodeScheduler::priority_prefetch);
+
 	mSelected = connectSignals;
 
 }
 
+/**
+ * Returns the scheduler's priority class for decoding this image.
+ * @return int priority_current if the image is shown, priority_prefetch otherwise
+ **/ 
+int DkImageContainerT::decodePriority() const {
+
+	return mSelected ? DkDecodeScheduler::priority_current : DkDecodeScheduler::priority_prefetch;
+}
+
 void DkImageContainerT::saveMetaDataThreaded() {
 
 	if (!exists() || (getLoader()->getMetaData() && !getLoader()->getMetaData()->isDirty()))
 		return;
 
 	mFileUpdateTimer.stop();
-	QFuture<void> future = QtConcurrent::run(this, 
-		&nmc::DkImageContainerT::saveMetaDataIntern, filePath(), getLoader(), getFileBuffer());
+	DkMetaDataWriter::instance().enqueue(filePath(), getLoader()->getMetaData());
 
 }
 
@@ -974,8 +1231,7 @@ void DkImageContainerT::savingFinished() {
 		//// reset thumb - loadImageThreaded should do it anyway
 		//thumb = QSharedPointer<DkThumbNailT>(new DkThumbNailT(saveFile, loader->image()));
 
-		if (mFileBuffer)
-			mFileBuffer->clear();	// do a complete clear?
+		mFileBuffer.clear();	// do a complete clear?
 		
 		if (DkSettingsManager::param().resources().loadSavedImage == DkSettings::ls_load || 
 			filePath().isEmpty() || dirPath() == sInfo.absolutePath()) {
@@ -996,16 +1252,6 @@ void DkImageContainerT::savingFinished() {
 	}
 }
 
-QSharedPointer<QByteArray> DkImageContainerT::loadFileToBuffer(const QString& filePath) {
-
-	return DkImageContainer::loadFileToBuffer(filePath);
-}
-
-QSharedPointer<DkBasicLoader> DkImageContainerT::loadImageIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, const QSharedPointer<QByteArray> fileBuffer) {
-
-	return DkImageContainer::loadImageIntern(filePath, loader, fileBuffer);
-}
-
 QString DkImageContainerT::saveImageIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, QImage saveImg, int compression) {
 
 	return DkImageContainer::saveImageIntern(filePath, loader, saveImg, compression);
@@ -1041,6 +1287,24 @@ bool DkImageContainerT::isFileDownloaded() const {
 	return mDownloaded;
 }
 
+/**
+ * Sets the sidecar group of this image.
+ * If duplicates are filtered, the image shown represents
+ * all files with the same base name (e.g. IMG_01.jpg & IMG_01.cr2).
+ * @param filePaths the files that are hidden behind this image.
+ **/ 
+void DkImageContainerT::setSidecars(const QStringList& filePaths) {
+	mSidecars = filePaths;
+}
+
+QStringList DkImageContainerT::sidecars() const {
+	return mSidecars;
+}
+
+bool DkImageContainerT::hasSidecars() const {
+	return !mSidecars.empty();
+}
+
 void DkImageContainerT::undo() {
 	DkImageContainer::undo();
 	emit imageUpdatedSignal();
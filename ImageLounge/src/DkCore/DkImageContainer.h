@@ -46,12 +46,15 @@
 #endif
 
 #include "DkThumbs.h"
+#include "DkScheduler.h"
 
 namespace nmc {
 
 // nomacs defines
 class DkBasicLoader;
+class DkCancelToken;
 class DkMetaDataT;
+class DkSharedMetaData;
 class DkZipContainer;
 class FileDownloader;
 class DkRotatingRect;
@@ -96,6 +99,12 @@ public:
 	float getMemoryUsage() const;
 	float getFileSize() const;
 
+	QString sortName() const;
+	qint64 sortDateCreated() const;
+	qint64 sortDateModified() const;
+	void prepareSortKeys(int sortMode) const;
+	void setSortDates(qint64 created, qint64 modified);
+
 	virtual QSharedPointer<DkBasicLoader> getLoader();
 	virtual QSharedPointer<DkMetaDataT> getMetaData();
 	virtual QSharedPointer<DkThumbNailT> getThumb();
@@ -125,15 +134,20 @@ public:
 	DkRotatingRect cropRect();
 
 protected:
-	QSharedPointer<DkBasicLoader> loadImageIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, const QSharedPointer<QByteArray> fileBuffer);
+	static QSharedPointer<QByteArray> loadFileToBufferIntern(const QString& filePath, bool fromZip, const QString& zipFilePath, const QString& zipImageFile);
+	static QSharedPointer<DkBasicLoader> loadImageIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, const QSharedPointer<QByteArray> fileBuffer);
+	void zipFilePaths(QString& zipFilePath, QString& zipImageFile);
 	void saveMetaDataIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, QSharedPointer<QByteArray> fileBuffer = QSharedPointer<QByteArray>());
 	QString saveImageIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, QImage saveImg, int compression);
 	void setFilePath(const QString& filePath);
 	void init();
+	void invalidateSortKeys();
+	void updateSortDates() const;
 
 	QSharedPointer<QByteArray> mFileBuffer;
 	QSharedPointer<DkBasicLoader> mLoader;
 	QSharedPointer<DkThumbNailT> mThumb;
+	QSharedPointer<DkSharedMetaData> mSharedMetaData;	// parsed once - shared by the loader, previews & thumbnails
 
 	int mLoadState	= not_loaded;
 	bool mEdited	= false;
@@ -142,6 +156,12 @@ protected:
 	QFileInfo mFileInfo;
 	QVector<QImage> scaledImages;
 
+	// sort keys are computed once (sorting 100k files compares ~2M times)
+	mutable QString mSortName;
+	mutable qint64 mSortCreated = 0;
+	mutable qint64 mSortModified = 0;
+	mutable bool mSortDatesValid = false;
+
 #ifdef WITH_QUAZIP	
 	QSharedPointer<DkZipContainer> mZipData;
 #endif
@@ -175,6 +195,11 @@ public:
 	bool saveImageThreaded(const QString& filePath, int compression = -1);
 	void saveMetaDataThreaded();
 	bool isFileDownloaded() const;
+	QImage previewImage() const;
+
+	void setSidecars(const QStringList& filePaths);
+	QStringList sidecars() const;
+	bool hasSidecars() const;
 
 	virtual QSharedPointer<DkBasicLoader> getLoader() override;
 	virtual QSharedPointer<DkThumbNailT> getThumb() override;
@@ -191,12 +216,14 @@ signals:
 	void errorDialogSignal(const QString& msg) const;
 	void thumbLoadedSignal(bool loaded = true) const;
 	void imageUpdatedSignal() const;
+	void previewLoadedSignal() const;
 
 public slots:
 	void checkForFileUpdates(); 
 
 protected slots:
 	void bufferLoaded();
+	void previewLoaded();
 	void imageLoaded();
 	void savingFinished();
 	void loadingFinished();
@@ -204,14 +231,17 @@ protected slots:
 
 protected:
 	void fetchImage();
+	void fetchPreview();
+	void renewCancelToken();
+	int decodePriority() const;
 	
-	QSharedPointer<QByteArray> loadFileToBuffer(const QString& filePath);
-	QSharedPointer<DkBasicLoader> loadImageIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, const QSharedPointer<QByteArray> fileBuffer);
+	static QImage loadPreviewIntern(const QString& filePath, const QSharedPointer<QByteArray> fileBuffer, int format, const QSize& minSize, QSharedPointer<DkCancelToken> token, QSharedPointer<DkSharedMetaData> metaData);
 	QString saveImageIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, QImage saveImg, int compression);
 	void saveMetaDataIntern(const QString& filePath, QSharedPointer<DkBasicLoader> loader, QSharedPointer<QByteArray> fileBuffer);
 	
 	QFutureWatcher<QSharedPointer<QByteArray> > mBufferWatcher;
 	QFutureWatcher<QSharedPointer<DkBasicLoader> > mImageWatcher;
+	QFutureWatcher<QImage> mPreviewWatcher;
 	QFutureWatcher<QString> mSaveImageWatcher;
 	QFutureWatcher<bool> mSaveMetaDataWatcher;
 
@@ -229,8 +259,14 @@ protected:
 
 	bool mFetchingImage = false;
 	bool mFetchingBuffer = false;
+	bool mFetchingPreview = false;
 	bool mDownloaded = false;
 
+	QImage mPreview;
+	QSharedPointer<DkCancelToken> mCancelToken;
+	int mDecodeId = DkDecodeScheduler::newOwnerId();	// the scheduler's owner id of our decoding tasks
+	QStringList mSidecars;		// files hidden behind this image (e.g. the RAW of a RAW+JPEG pair)
+
 	QTimer mFileUpdateTimer;
 };
 
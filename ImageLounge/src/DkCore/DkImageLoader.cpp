@@ -40,11 +40,13 @@
 #include "DkUtils.h"
 #include "DkStatusBar.h"
 #include "DkActionManager.h"
+#include "DkScheduler.h"
+#include "DkFolderWatcher.h"
+#include "DkFolderTree.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QWidget>
 #include <QImageWriter>
-#include <QFileSystemWatcher>
 #include <QFileInfo>
 #include <QFile>
 #include <QSettings>
@@ -73,8 +75,13 @@
 #include <QPainter>
 #include <qmath.h>
 #include <QtConcurrentRun>
+#include <QtConcurrentMap>
 #include <QStandardPaths>
 #include <QDesktopServices>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <random>
 
 // quazip
 #ifdef WITH_QUAZIP
@@ -95,10 +102,273 @@
 #include <winsock2.h>	// needed since libraw 0.16
 #endif
 
+#ifndef Q_OS_WIN
+#include <dirent.h>
+#endif
+
 #pragma warning(pop)	// no warnings from includes - end
 
 namespace nmc {
 
+// DkDirScanner --------------------------------------------------------------------
+DkDirScanner::DkDirScanner(QObject* parent) : QObject(parent) {
+}
+
+DkDirScanner::~DkDirScanner() {
+
+	// the scan emits signals from this object - so we have to wait for it
+	if (mToken)
+		mToken->cancel();
+
+	if (mFuture.isRunning())
+		mFuture.waitForFinished();
+}
+
+/**
+ * Scans the directory threaded.
+ * Found files are reported in chunks by filesFoundSignal.
+ * The last signal has finished set to true.
+ * @param dirPath the directory to be scanned.
+ * @param token cancels the scan.
+ **/ 
+void DkDirScanner::scanThreaded(const QString& dirPath, const QSharedPointer<DkCancelToken>& token) {
+
+	if (mToken)
+		mToken->cancel();
+	mToken = token;
+
+	mFuture = DkDecodeScheduler::instance().run<QStringList>(DkDecodeScheduler::priority_current,
+		[this, dirPath, token]() -> QStringList {
+			
+			QStringList files = scan(dirPath, [this, dirPath, token](const QStringList& chunk) {
+				
+				if (!DkCancelToken::isCanceled(token))
+					emit filesFoundSignal(dirPath, chunk, false);
+			}, token);
+
+			if (!DkCancelToken::isCanceled(token))
+				emit filesFoundSignal(dirPath, QStringList(), true);
+
+			return files;
+		});
+}
+
+/**
+ * Returns all image files of a directory.
+ * The directory is read only once and files are matched
+ * by their suffix. Only files w/o suffix are opened.
+ * @param dirPath the directory to be scanned.
+ * @param chunkFn if set, it is called with chunks of the file list while scanning.
+ * @param token cancels the scan.
+ * @param subDirs if set, the names of sub folders (w/o hidden folders and links) are appended.
+ * @return QStringList the (unsorted) file names.
+ **/ 
+QStringList DkDirScanner::scan(const QString& dirPath, const std::function<void(const QStringList&)>& chunkFn, const QSharedPointer<DkCancelToken>& token, QStringList* subDirs) {
+
+	DkTimer dt;
+	QStringList fileList;
+
+	if (dirPath.isEmpty())
+		return fileList;
+
+	Filters filters = browseFilters();
+	QStringList chunk;
+	QElapsedTimer chunkTimer;
+	chunkTimer.start();
+
+	auto append = [&](const QString& name) {
+		
+		fileList << name;
+
+		if (!chunkFn)
+			return;
+
+		chunk << name;
+
+		if (chunk.size() >= chunk_size || chunkTimer.elapsed() > chunk_ms) {
+			chunkFn(chunk);
+			chunk.clear();
+			chunkTimer.restart();
+		}
+	};
+
+#ifdef Q_OS_WIN
+
+	QString winPath = QDir::toNativeSeparators(dirPath) + "\\*.*";
+
+	const wchar_t* fname = reinterpret_cast<const wchar_t *>(winPath.utf16());
+
+	WIN32_FIND_DATAW findFileData;
+	HANDLE MyHandle = FindFirstFileW(fname, &findFileData);
+
+	if (MyHandle != INVALID_HANDLE_VALUE) {
+
+		do {
+
+			if (DkCancelToken::isCanceled(token))
+				break;
+
+			QString name = QString::fromWCharArray(findFileData.cFileName);
+
+			// FindFirstFile already knows the file type - no need for a stat
+			if (findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+
+				if (subDirs && !name.startsWith(".") && 
+					!(findFileData.dwFileAttributes & (FILE_ATTRIBUTE_REPARSE_POINT | FILE_ATTRIBUTE_HIDDEN)))
+					*subDirs << name;
+				continue;
+			}
+
+			if (matches(name, filters) || (!name.contains(".") && DkUtils::isValid(QFileInfo(dirPath, name))))
+				append(name);
+
+		} while (FindNextFileW(MyHandle, &findFileData) != 0);
+
+		FindClose(MyHandle);
+	}
+
+	qInfoClean() << "WinAPI, indexed (" << fileList.size() << ") files in: " << dt;
+#else
+
+	DIR* dir = opendir(QFile::encodeName(dirPath).constData());
+
+	if (!dir) {
+		qWarning() << "[DkDirScanner] cannot open" << dirPath;
+		return fileList;
+	}
+
+	struct dirent* entry;
+
+	while ((entry = readdir(dir)) != 0) {
+
+		if (DkCancelToken::isCanceled(token))
+			break;
+
+		// skip . .. and hidden files (like QDir does)
+		if (entry->d_name[0] == '.')
+			continue;
+
+		bool needsStat = true;
+		QString name = QFile::decodeName(entry->d_name);
+
+#ifdef DT_REG
+		// most file systems report the type - so we don't need to stat each file
+		if (entry->d_type == DT_REG)
+			needsStat = false;
+		else if (entry->d_type == DT_DIR) {
+			if (subDirs)
+				*subDirs << name;
+			continue;
+		}
+		else if (entry->d_type != DT_UNKNOWN && entry->d_type != DT_LNK)
+			continue;
+#endif
+
+		if (subDirs && needsStat) {
+
+			QFileInfo fi(dirPath, name);
+
+			if (fi.isDir()) {
+				if (!fi.isSymLink())
+					*subDirs << name;
+				continue;
+			}
+		}
+
+		if (matches(name, filters)) {
+
+			if (!needsStat || QFileInfo(dirPath, name).isFile())
+				append(name);
+		}
+		else if (!name.contains(".") && DkUtils::isValid(QFileInfo(dirPath, name)))
+			append(name);
+	}
+
+	closedir(dir);
+
+	qDebug() << "[DkDirScanner]" << fileList.size() << "files indexed in" << dt;
+#endif
+
+	if (chunkFn && !chunk.isEmpty() && !DkCancelToken::isCanceled(token))
+		chunkFn(chunk);
+
+	return fileList;
+}
+
+/**
+ * Returns the images of a list of file names.
+ * The same rules as in scan() are applied.
+ * @param dirPath the directory of the files.
+ * @param fileNames the file names.
+ * @return QStringList the file names of images.
+ **/ 
+QStringList DkDirScanner::filter(const QString& dirPath, const QStringList& fileNames) {
+
+	Filters filters = browseFilters();
+	QStringList fileList;
+
+	for (const QString& name : fileNames) {
+
+		if (name.startsWith("."))
+			continue;
+
+		if (matches(name, filters) || (!name.contains(".") && DkUtils::isValid(QFileInfo(dirPath, name))))
+			fileList << name;
+	}
+
+	return fileList;
+}
+
+DkDirScanner::Filters DkDirScanner::browseFilters() {
+
+	Filters filters;
+
+	for (QString f : DkSettingsManager::param().app().browseFilters) {
+
+		f = f.trimmed().toLower();
+
+		if (f.startsWith("*."))
+			f = f.mid(2);
+		else if (f.startsWith("."))
+			f = f.mid(1);
+
+		if (f.isEmpty())
+			continue;
+
+		if (f.contains("*") || f.contains("?"))
+			filters.wildcards << QRegExp("*." + f, Qt::CaseInsensitive, QRegExp::Wildcard);
+		else if (f.contains("."))
+			filters.compound << "." + f;
+		else
+			filters.suffixes.insert(f);
+	}
+
+	return filters;
+}
+
+bool DkDirScanner::matches(const QString& fileName, const Filters& filters) {
+
+	int dotIdx = fileName.lastIndexOf(".");
+
+	if (dotIdx == -1)
+		return false;
+
+	if (filters.suffixes.contains(fileName.mid(dotIdx + 1).toLower()))
+		return true;
+
+	for (const QString& c : filters.compound) {
+		if (fileName.endsWith(c, Qt::CaseInsensitive))
+			return true;
+	}
+
+	for (const QRegExp& w : filters.wildcards) {
+		if (w.exactMatch(fileName))
+			return true;
+	}
+
+	return false;
+}
+
 // DkImageLoader -> is nomacs file handling routine --------------------------------------------------------------------
 /**
  * Default constructor.
@@ -109,14 +379,19 @@ DkImageLoader::DkImageLoader(const QString& filePath) {
 
 	qRegisterMetaType<QFileInfo>("QFileInfo");
 
-	mDirWatcher = new QFileSystemWatcher(this);
-	connect(mDirWatcher, SIGNAL(directoryChanged(QString)), this, SLOT(directoryChanged(QString)));
+	mDirWatcher = new DkFolderWatcher(this);
+	connect(mDirWatcher, SIGNAL(filesAddedSignal(const QString&, const QStringList&)), this, SLOT(dirFilesAdded(const QString&, const QStringList&)));
+	connect(mDirWatcher, SIGNAL(filesRemovedSignal(const QString&, const QStringList&)), this, SLOT(dirFilesRemoved(const QString&, const QStringList&)));
+	connect(mDirWatcher, SIGNAL(dirChangedSignal(const QString&)), this, SLOT(directoryChanged(const QString&)));
 
 	mSortingIsDirty = false;
 	mSortingImages = false;
 
 	connect(&mCreateImageWatcher, SIGNAL(finished()), this, SLOT(imagesSorted()));
 
+	mDirScanner = new DkDirScanner(this);
+	connect(mDirScanner, SIGNAL(filesFoundSignal(const QString&, const QStringList&, bool)), this, SLOT(dirFilesFound(const QString&, const QStringList&, bool)), Qt::QueuedConnection);
+
 	mDelayedUpdateTimer.setSingleShot(true);
 	connect(&mDelayedUpdateTimer, SIGNAL(timeout()), this, SLOT(directoryChanged()));
 
@@ -124,6 +399,7 @@ DkImageLoader::DkImageLoader(const QString& filePath) {
     connect(DkActionManager::instance().action(DkActionManager::menu_edit_undo), SIGNAL(triggered()), this, SLOT(undo()));
 	connect(DkActionManager::instance().action(DkActionManager::menu_edit_redo), SIGNAL(triggered()), this, SLOT(redo()));
 	connect(DkActionManager::instance().action(DkActionManager::menu_view_gps_map), SIGNAL(triggered()), this, SLOT(showOnMap()));
+	connect(DkActionManager::instance().action(DkActionManager::menu_file_open_sidecar), SIGNAL(triggered()), this, SLOT(loadSidecar()));
 	connect(DkActionManager::instance().action(DkActionManager::sc_delete_silent), SIGNAL(triggered()), this, SLOT(deleteFile()), Qt::UniqueConnection);
 
 	//saveDir = DkSettingsManager::param().global().lastSaveDir;	// loading save dir is obsolete ?!
@@ -143,6 +419,11 @@ DkImageLoader::~DkImageLoader() {
 	
 	if (mCreateImageWatcher.isRunning())
 		mCreateImageWatcher.blockSignals(true);
+
+	if (mDirScanToken)
+		mDirScanToken->cancel();
+
+	mFolderIndex->save();
 }
 
 /**
@@ -158,6 +439,7 @@ void DkImageLoader::clearPath() {
 		mCurrentImage->receiveUpdates(this, false);
 		mLastImageLoaded = mCurrentImage;
 		mImages.clear();
+		invalidateIndex();
 
 		// only clear the current image if it exists
 		mCurrentImage.clear();
@@ -230,13 +512,20 @@ bool DkImageLoader::loadDir(const QString& newDirPath, bool scanRecursive) {
 	// folder changed signal was emitted
 	if (mFolderUpdated && newDirPath == mCurrentDir) {
 		
+		cancelDirScan();
 		mFolderUpdated = false;
-		QFileInfoList files = getFilteredFileInfoList(newDirPath, mIgnoreKeywords, mKeywords, mFolderFilterString);		// this line takes seconds if you have lots of files and slow loading (e.g. network)
+		QHash<QString, QStringList> sidecars;
+		QFileInfoList files = getIndexedFileInfoList(newDirPath, &sidecars);		// this line takes seconds if you have lots of files and slow loading (e.g. network)
 
 		// might get empty too (e.g. someone deletes all images)
  		if (files.empty()) {
 			emit showInfoSignal(tr("%1 \n does not contain any image").arg(newDirPath), 4000);	// stop showing
 			mImages.clear();
+			invalidateIndex();
+
+			if (mFolderTree)
+				mFolderTree->setImageCount(newDirPath, 0);
+
 			emit updateDirSignal(mImages);
 			return false;
 		}
@@ -247,7 +536,7 @@ bool DkImageLoader::loadDir(const QString& newDirPath, bool scanRecursive) {
 		//	sortImagesThreaded(images);
 		//}
 		//else
-			createImages(files, true);
+			createImages(files, true, sidecars);
 
 		qDebug() << "getting file list.....";
 	}
@@ -255,28 +544,44 @@ bool DkImageLoader::loadDir(const QString& newDirPath, bool scanRecursive) {
 	else if ((newDirPath != mCurrentDir || mImages.empty()) && !newDirPath.isEmpty() && QDir(newDirPath).exists()) {
 
 		QFileInfoList files;
+		QHash<QString, QStringList> sidecars;
 
 		//newDir.setNameFilters(DkSettingsManager::param().app().fileFilters);
 		//newDir.setSorting(QDir::LocaleAware);		// TODO: extend
 
 		// update save directory
+		cancelDirScan();
 		mCurrentDir = newDirPath;
 		mFolderUpdated = false;
+		mLoadFirstSubFolder = false;
+		mCache.clear();
 
 		mFolderFilterString.clear();	// delete key words -> otherwise user may be confused
 
 		if (scanRecursive && DkSettingsManager::param().global().scanSubFolders)
 			files = updateSubFolders(mCurrentDir);
 		else 
-			files = getFilteredFileInfoList(mCurrentDir, mIgnoreKeywords, mKeywords, mFolderFilterString);		// this line takes seconds if you have lots of files and slow loading (e.g. network)
+			files = getIndexedFileInfoList(mCurrentDir, &sidecars);		// this line takes seconds if you have lots of files and slow loading (e.g. network)
+
+		// the sub folders are still walked - the first folder with images is loaded afterwards
+		if (files.empty() && scanRecursive && DkSettingsManager::param().global().scanSubFolders && mPendingFolderTree) {
+			mLoadFirstSubFolder = true;
+			emit showInfoSignal(tr("Searching sub folders..."), 4000);
+			return false;
+		}
 
 		if (files.empty()) {
+
+			if (mFolderTree)
+				mFolderTree->setImageCount(mCurrentDir, 0);
+
 			emit showInfoSignal(tr("%1 \n does not contain any image").arg(mCurrentDir), 4000);	// stop showing
 			return false;
 		}
 
 		// ok new folder, this should speed-up loading
 		mImages.clear();
+		invalidateIndex();
 		
 		//// TODO: creating ~120 000 images takes about 2 secs
 		//// but sorting (just filenames) takes ages (on windows)
@@ -288,7 +593,7 @@ bool DkImageLoader::loadDir(const QString& newDirPath, bool scanRecursive) {
 		//	sortImagesThreaded(mImages);
 		//}
 		//else
-			createImages(files, true);
+			createImages(files, true, sidecars);
 
 		qInfoClean() << newDirPath << " [" << mImages.size() << "] indexed in " << dt;
 	}
@@ -298,6 +603,220 @@ bool DkImageLoader::loadDir(const QString& newDirPath, bool scanRecursive) {
 	return true;
 }
 
+/**
+ * Loads a new directory threaded.
+ * The file list is streamed in chunks (see dirFilesFound)
+ * so that huge folders can be browsed while they are still indexed.
+ * @param dirPath the directory to be loaded.
+ **/ 
+void DkImageLoader::loadDirThreaded(const QString& dirPath) {
+
+	// the index is up-to-date -> we don't need to list the folder
+	loadFolderIndex(dirPath);
+
+	if (mFolderIndex->isUpToDate()) {
+		loadDir(dirPath);
+		return;
+	}
+
+	cancelDirScan();
+	mDirScanToken = QSharedPointer<DkCancelToken>(new DkCancelToken());
+
+	// update save directory
+	mCurrentDir = dirPath;
+	mFolderUpdated = false;
+	mCache.clear();
+	mFolderFilterString.clear();	// delete key words -> otherwise user may be confused
+
+	mDirScanFiles.clear();
+	mImages.clear();
+
+	// keep the current image while the folder is indexed
+	if (mCurrentImage && QFileInfo(mCurrentImage->filePath()).absolutePath() == dirPath)
+		mImages << mCurrentImage;
+
+	invalidateIndex();
+
+	mDirScanModified = DkFolderIndex::dirModified(dirPath);
+	mDirScanner->scanThreaded(dirPath, mDirScanToken);
+}
+
+/**
+ * Returns the filtered files of a folder.
+ * If the folder index is up-to-date, its file list is used.
+ * Otherwise the folder is listed and the index is updated.
+ * @param dirPath the folder.
+ * @param sidecars if set, it is filled with the duplicates that are hidden.
+ * @return QFileInfoList the filtered files.
+ **/ 
+QFileInfoList DkImageLoader::getIndexedFileInfoList(const QString& dirPath, QHash<QString, QStringList>* sidecars) {
+
+	loadFolderIndex(dirPath);
+
+	QStringList fileList;
+
+	if (mFolderIndex->isUpToDate()) {
+		fileList = mFolderIndex->fileNames();
+		qInfo() << "[DkImageLoader] file list of" << dirPath << "taken from the index";
+	}
+	else {
+		qint64 dirModified = DkFolderIndex::dirModified(dirPath);
+		fileList = DkDirScanner::scan(dirPath);
+
+		if (fileList.size() >= DkFolderIndex::min_files || !mFolderIndex->isEmpty()) {
+			mFolderIndex->update(fileList, dirModified);
+			DkFolderIndex::saveThreaded(mFolderIndex);
+		}
+	}
+
+	fileList = filterFileNames(dirPath, fileList, mIgnoreKeywords, mKeywords, mFolderFilterString, sidecars);
+
+	QFileInfoList fileInfoList;
+	fileInfoList.reserve(fileList.size());
+
+	for (const QString& name : fileList)
+		fileInfoList.append(QFileInfo(dirPath, name));
+
+	return fileInfoList;
+}
+
+/**
+ * Loads the folder index if the folder changed.
+ * Changes of the previous folder's index are saved.
+ * @param dirPath the folder.
+ **/ 
+void DkImageLoader::loadFolderIndex(const QString& dirPath) {
+
+	if (mFolderIndex->dirPath() == dirPath)
+		return;
+
+	DkFolderIndex::saveThreaded(mFolderIndex);
+	mFolderIndex = QSharedPointer<DkFolderIndex>(new DkFolderIndex(dirPath));
+	
+	// files edited in place keep the folder's date - so the entries are checked in the background
+	if (mFolderIndex->load())
+		DkFolderIndex::saveThreaded(mFolderIndex);
+}
+
+/**
+ * Stores the attributes of a loaded image in the folder index.
+ * @param imgC the image loaded.
+ **/ 
+void DkImageLoader::updateFolderIndex(QSharedPointer<DkImageContainerT> imgC) {
+
+	if (!imgC || !mFolderIndex->isLoaded() || imgC->dirPath() != mFolderIndex->dirPath())
+		return;
+
+	QString name = imgC->fileName();
+
+	if (!mFolderIndex->contains(name))
+		return;
+
+	DkFolderIndex::Entry e = mFolderIndex->entry(name);
+
+	QFileInfo fi(imgC->filePath());
+	e.size = fi.size();
+	e.modified = fi.lastModified().toMSecsSinceEpoch();
+	e.created = fi.created().toMSecsSinceEpoch();
+
+	QSize size = imgC->getLoader()->image().size();
+	e.width = size.width();
+	e.height = size.height();
+
+	QSharedPointer<DkMetaDataT> metaData = imgC->getMetaData();
+
+	if (metaData) {
+		e.orientation = metaData->getOrientationDegree();
+		e.rating = metaData->getRating();
+
+		QDateTime exifDate = QDateTime::fromString(metaData->getExifValue("DateTimeOriginal"), "yyyy:MM:dd hh:mm:ss");
+		if (exifDate.isValid())
+			e.exifDate = exifDate.toMSecsSinceEpoch();
+	}
+
+	mFolderIndex->setEntry(e);
+}
+
+/**
+ * Cancels the threaded indexing of a folder (if any).
+ * Synchronous loads override folders that are currently scanned.
+ **/ 
+void DkImageLoader::cancelDirScan() {
+
+	if (mDirScanToken) {
+		mDirScanToken->cancel();
+		mDirScanToken.clear();
+	}
+}
+
+void DkImageLoader::dirFilesFound(const QString& dirPath, const QStringList& fileNames, bool finished) {
+
+	// scan was canceled or the folder changed in the meantime
+	if (!mDirScanToken || mDirScanToken->isCanceled() || dirPath != mCurrentDir)
+		return;
+
+	mDirScanFiles << fileNames;
+
+	if (!finished) {
+
+		// NOTE: duplicates are filtered per chunk - the final pass fixes pairs that span two chunks
+		QStringList names = filterFileNames(dirPath, fileNames, mIgnoreKeywords, mKeywords, mFolderFilterString);
+		QString cFilePath = mCurrentImage ? mCurrentImage->filePath() : QString();
+
+		QVector<QSharedPointer<DkImageContainerT> > newImages;
+		newImages.reserve(names.size());
+
+		for (const QString& n : names) {
+			
+			QString fp = QFileInfo(dirPath, n).absoluteFilePath();
+			
+			if (fp != cFilePath)
+				newImages << QSharedPointer<DkImageContainerT>(new DkImageContainerT(fp));
+		}
+
+		if (newImages.empty())
+			return;
+
+		// sort the chunk & merge it - re-sorting everything per chunk is too slow for huge folders
+		newImages = sortImages(newImages);
+		int mid = mImages.size();
+		mImages << newImages;
+		std::inplace_merge(mImages.begin(), mImages.begin() + mid, mImages.end(), imageContainerLessThanPtr);
+		invalidateIndex();
+
+		emit updateDirSignal(mImages);
+		return;
+	}
+
+	DkTimer dt;
+	mDirScanToken.clear();
+
+	if (mDirScanFiles.size() >= DkFolderIndex::min_files || !mFolderIndex->isEmpty()) {
+		mFolderIndex->update(mDirScanFiles, mDirScanModified);
+		DkFolderIndex::saveThreaded(mFolderIndex);
+	}
+
+	QHash<QString, QStringList> sidecars;
+	QStringList names = filterFileNames(dirPath, mDirScanFiles, mIgnoreKeywords, mKeywords, mFolderFilterString, &sidecars);
+	mDirScanFiles.clear();
+
+	if (names.empty()) {
+		emit showInfoSignal(tr("%1 \n does not contain any image").arg(dirPath), 4000);	// stop showing
+		mImages.clear();
+		invalidateIndex();
+		emit updateDirSignal(mImages);
+		return;
+	}
+
+	QFileInfoList files;
+	for (const QString& n : names)
+		files.append(QFileInfo(dirPath, n));
+
+	createImages(files, true, sidecars);
+
+	qInfoClean() << dirPath << " [" << mImages.size() << "] indexed (streamed) - final pass: " << dt;
+}
+
 void DkImageLoader::sortImagesThreaded(QVector<QSharedPointer<DkImageContainerT > > images) {
 
 	if (mSortingImages) {
@@ -317,6 +836,7 @@ void DkImageLoader::imagesSorted() {
 
 	mSortingImages = false;
 	mImages = mCreateImageWatcher.result();
+	invalidateIndex();
 
 	if (mSortingIsDirty) {
 		qDebug() << "re-sorting because it's dirty...";
@@ -326,53 +846,156 @@ void DkImageLoader::imagesSorted() {
 
 	emit updateDirSignal(mImages);
 
-	if (mDirWatcher) {
-		if (!mDirWatcher->directories().isEmpty())
-			mDirWatcher->removePaths(mDirWatcher->directories());
-		mDirWatcher->addPath(mCurrentDir);
-	}
+	if (mDirWatcher)
+		mDirWatcher->setDir(mCurrentDir);
 
 	qDebug() << "images sorted...";
 }
 
-void DkImageLoader::createImages(const QFileInfoList& files, bool sort) {
+void DkImageLoader::createImages(const QFileInfoList& files, bool sort, const QHash<QString, QStringList>& sidecars) {
 
 	// TODO: change files to QStringList
 	DkTimer dt;
-	QVector<QSharedPointer<DkImageContainerT > > oldImages = mImages;
+	QHash<QString, QSharedPointer<DkImageContainerT> > oldImages;
+	oldImages.reserve(mImages.size());
+
+	for (const QSharedPointer<DkImageContainerT>& img : mImages)
+		oldImages.insert(img->filePath(), img);
+
 	mImages.clear();
+	mImages.reserve(files.size());
 
-	QDate today = QDate::currentDate();
+	bool useIndex = mFolderIndex->isUpToDate();
 
 	for (const QFileInfo& f : files) {
 
-		const QString& fp = f.absoluteFilePath();
-		int oIdx = findFileIdx(fp, oldImages);
+		QString fp = f.absoluteFilePath();
+		fp.replace("\\", QDir::separator());	// see findFileIdx
+		QSharedPointer<DkImageContainerT> oImg = oldImages.value(fp);
 
 		// NOTE: we had this here: oIdx != -1 && QFileInfo(oldImages.at(oIdx)->filePath()).lastModified() == f.lastModified())
 		// however, that did not detect file changes & slowed down the process - so I removed it...
-		mImages << ((oIdx != -1) ? oldImages.at(oIdx) : QSharedPointer<DkImageContainerT >(new DkImageContainerT(fp)));
+		if (!oImg)
+			oImg = QSharedPointer<DkImageContainerT >(new DkImageContainerT(fp));
+
+		// sort by date w/o touching the files
+		if (useIndex && f.absolutePath() == mFolderIndex->dirPath()) {
+			DkFolderIndex::Entry e = mFolderIndex->entry(f.fileName());
+			if (e.hasFileInfo())
+				oImg->setSortDates(e.created, e.modified);
+		}
+
+		QStringList sidecarPaths;
+		for (const QString& name : sidecars.value(f.fileName()))
+			sidecarPaths << QFileInfo(f.absolutePath(), name).absoluteFilePath();
+		oImg->setSidecars(sidecarPaths);
+
+		mImages << oImg;
 	}
+	invalidateIndex();
 	qInfo() << "[DkImageLoader]" << mImages.size() << "containers created in" << dt;
 
+	if (mFolderTree)
+		mFolderTree->setImageCount(mCurrentDir, mImages.size());
+
 	if (sort) {
-		qSort(mImages.begin(), mImages.end(), imageContainerLessThanPtr);
+		mImages = sortImages(mImages);
+		invalidateIndex();
 		qInfo() << "[DkImageLoader] after sorting: " << dt;
 
 		emit updateDirSignal(mImages);
 
-		if (mDirWatcher) {
-			if (!mDirWatcher->directories().isEmpty())
-				mDirWatcher->removePaths(mDirWatcher->directories());
-			mDirWatcher->addPath(mCurrentDir);
-		}
+		if (mDirWatcher)
+			mDirWatcher->setDir(mCurrentDir);
 	}
 
 }
 
+/**
+ * Sorts images according to the user's sort mode.
+ * Sort keys are computed once per image, then chunks
+ * are sorted in parallel and merged. The global thread pool
+ * is used (and the calling thread helps) - so sorting never
+ * waits for decoding tasks (see DkDecodeScheduler).
+ * @param images the images to be sorted.
+ * @return QVector<QSharedPointer<DkImageContainerT > > the sorted images.
+ **/ 
 QVector<QSharedPointer<DkImageContainerT > > DkImageLoader::sortImages(QVector<QSharedPointer<DkImageContainerT > > images) const {
 
-	qSort(images.begin(), images.end(), imageContainerLessThanPtr);
+	DkTimer dt;
+	int sortMode = DkSettingsManager::param().global().sortMode;
+
+	if (sortMode == DkSettings::sort_random) {
+		std::mt19937 rng(std::random_device{}());
+		std::shuffle(images.begin(), images.end(), rng);
+		return images;
+	}
+
+	// NOTE: imageContainerLessThanPtr would copy (and ref count) both pointers per comparison
+	auto lessThan = [](const QSharedPointer<DkImageContainerT>& l, const QSharedPointer<DkImageContainerT>& r) {
+		return imageContainerLessThan(*l, *r);
+	};
+
+	struct Range {
+		int begin;
+		int mid;
+		int end;
+	};
+
+	QSharedPointer<DkImageContainerT>* data = images.data();
+	int numImages = images.size();
+	int numChunks = numImages < 5000 ? 1 : qMax(1, QThread::idealThreadCount());
+
+	QVector<Range> chunks;
+	for (int idx = 0; idx < numChunks; idx++) {
+		Range r = {idx*numImages/numChunks, 0, (idx+1)*numImages/numChunks};
+		chunks << r;
+	}
+
+	// compute the keys (dates need a stat) & sort each chunk
+	std::function<void(Range&)> sortChunk = [data, sortMode, lessThan](Range& r) {
+		
+		for (int idx = r.begin; idx < r.end; idx++)
+			data[idx]->prepareSortKeys(sortMode);
+		
+		std::sort(data + r.begin, data + r.end, lessThan);
+	};
+
+	if (numChunks == 1) {
+		sortChunk(chunks[0]);
+		return images;
+	}
+
+	// blockingMap runs chunks in the calling thread too - so a busy pool cannot stall us
+	QtConcurrent::blockingMap(chunks, sortChunk);
+
+	// merge neighbouring chunks (in parallel) until a single one is left
+	std::function<void(Range&)> mergeChunks = [data, lessThan](Range& r) {
+		std::inplace_merge(data + r.begin, data + r.mid, data + r.end, lessThan);
+	};
+
+	while (chunks.size() > 1) {
+
+		QVector<Range> merges;
+		QVector<Range> merged;
+
+		for (int idx = 0; idx < chunks.size(); idx += 2) {
+
+			if (idx + 1 < chunks.size()) {
+				Range r = {chunks[idx].begin, chunks[idx].end, chunks[idx+1].end};
+				merges << r;
+				merged << r;
+			}
+			else
+				merged << chunks[idx];
+		}
+
+		QtConcurrent::blockingMap(merges, mergeChunks);
+		chunks = merged;
+	}
+
+	qInfo() << "[DkImageLoader]" << numImages << "images sorted in" << dt << "using" << numChunks << "threads";
+
 	return images;
 }
 
@@ -449,12 +1072,8 @@ QSharedPointer<DkImageContainerT> DkImageLoader::getSkippedImage(int skipIdx, bo
 		// could not locate the file -> it was deleted?!
 		if (mTmpFileIdx == -1) {
 
-			mTmpFileIdx = 0;
-			for (; mTmpFileIdx < mImages.size(); mTmpFileIdx++) {
-
-				if (*(mCurrentImage.data()) < *(mImages[mTmpFileIdx].data()))
-					break;
-			}
+			// first image that is sorted after the current one
+			mTmpFileIdx = (int)(std::upper_bound(mImages.begin(), mImages.end(), mCurrentImage, imageContainerLessThanPtr) - mImages.begin());
 
 			if (skipIdx > 0)
 				mTmpFileIdx--;	// -1 because the current file does not exist
@@ -660,24 +1279,13 @@ QSharedPointer<DkImageContainerT> DkImageLoader::findFile(const QString& filePat
 
 	// if one image is from zip than all should be
 	// for images in zip the "images[idx]->file() == file" comparison somahow does not work
-	if(mImages.size() > 0) {
-
-		if (mImages[0]->isFromZip()) {
-			int idx = findFileIdx(filePath, mImages);
-			if (idx < 0) 
-				return QSharedPointer<DkImageContainerT>();
-			else 
-				return mImages[idx];
-		}
-	}
+	// -> findFileIdx unifies the separators
+	int idx = findFileIdx(filePath, mImages);
 
-	for (int idx = 0; idx < mImages.size(); idx++) {
-
-		if (mImages[idx]->filePath() == filePath)
-			return mImages[idx];
-	}
-
-	return QSharedPointer<DkImageContainerT>();
+	if (idx < 0) 
+		return QSharedPointer<DkImageContainerT>();
+	else 
+		return mImages[idx];
 }
 
 int DkImageLoader::findFileIdx(const QString& filePath, const QVector<QSharedPointer<DkImageContainerT> >& images) const {
@@ -687,6 +1295,10 @@ int DkImageLoader::findFileIdx(const QString& filePath, const QVector<QSharedPoi
 	QString lFilePath = filePath;
 	lFilePath.replace("\\", QDir::separator());
 
+	// the current folder is indexed
+	if (&images == &mImages)
+		return imageIndex(lFilePath);
+
 	for (int idx = 0; idx < images.size(); idx++) {
 
 		if (images[idx]->filePath() == lFilePath)
@@ -696,6 +1308,49 @@ int DkImageLoader::findFileIdx(const QString& filePath, const QVector<QSharedPoi
 	return -1;
 }
 
+/**
+ * Returns the index of a file in the current folder in O(1).
+ * The path -> index hash is rebuilt lazily if mImages changed.
+ * @param filePath the file's path (with unified separators).
+ * @return int the index in mImages or -1 if the file is not in the folder.
+ **/ 
+int DkImageLoader::imageIndex(const QString& filePath) const {
+
+	if (mImageIndexDirty)
+		rebuildIndex();
+
+	int idx = mImageIndex.value(filePath, -1);
+
+	// check the cached position - so a missed invalidation can never return a wrong index
+	if (idx != -1 && (idx >= mImages.size() || mImages[idx]->filePath() != filePath)) {
+		qWarning() << "[DkImageLoader] image index is out of date - rebuilding";
+		rebuildIndex();
+		idx = mImageIndex.value(filePath, -1);
+	}
+
+	return idx;
+}
+
+/**
+ * Marks the path -> index hash as dirty.
+ * Call this whenever mImages is changed or re-sorted.
+ **/ 
+void DkImageLoader::invalidateIndex() {
+	mImageIndexDirty = true;
+}
+
+void DkImageLoader::rebuildIndex() const {
+
+	mImageIndex.clear();
+	mImageIndex.reserve(mImages.size());
+
+	// backwards -> the first image wins if a path is listed twice
+	for (int idx = mImages.size() - 1; idx >= 0; idx--)
+		mImageIndex.insert(mImages[idx]->filePath(), idx);
+
+	mImageIndexDirty = false;
+}
+
 QStringList DkImageLoader::getFileNames() const {
 
 	QStringList fileNames;
@@ -715,6 +1370,7 @@ QVector<QSharedPointer<DkImageContainerT> > DkImageLoader::getImages() {
 void DkImageLoader::setImages(QVector<QSharedPointer<DkImageContainerT> > images) {
 
 	mImages = images;
+	invalidateIndex();
 	emit updateDirSignal(images);
 }
 
@@ -869,6 +1525,7 @@ void DkImageLoader::reloadImage() {
 
 	mCurrentDir = "";
 	mImages.clear();
+	invalidateIndex();
 	mCurrentImage->clear();
 	setCurrentImage(mCurrentImage);
 	loadDir(mCurrentImage->dirPath());
@@ -887,6 +1544,19 @@ void DkImageLoader::showOnMap() {
 	QDesktopServices::openUrl(QUrl(DkMetaDataHelper::getInstance().getGpsCoordinates(metaData)));
 }
 
+/**
+ * Loads the first sidecar of the current image.
+ * If duplicates are filtered (e.g. RAW+JPEG pairs), only the preferred
+ * file is listed and the others can be opened on demand.
+ **/ 
+void DkImageLoader::loadSidecar() {
+
+	if (!mCurrentImage || !mCurrentImage->hasSidecars())
+		return;
+
+	load(mCurrentImage->sidecars().first());
+}
+
 void DkImageLoader::load(const QString& filePath) {
 
 	bool hasZipMarker = false;
@@ -895,7 +1565,9 @@ void DkImageLoader::load(const QString& filePath) {
 	hasZipMarker = filePath.contains(DkZipContainer::zipMarker()) != 0;
 #endif
 
-	if (QFileInfo(filePath).isFile() || hasZipMarker) {
+	bool isFile = QFileInfo(filePath).isFile();
+
+	if (isFile || hasZipMarker) {
 		QSharedPointer<DkImageContainerT> newImg = findOrCreateFile(filePath);
 		setCurrentImage(newImg);
 		load(mCurrentImage);
@@ -903,8 +1575,19 @@ void DkImageLoader::load(const QString& filePath) {
 	else
 		firstFile();
 	
-	// if here is a folder upate bug - this was before -- if (QFileInfo(filePath).isFile() || hasZipMarker) { 
-	loadDir(QFileInfo(filePath).absolutePath());
+	QString dirPath = QFileInfo(filePath).absolutePath();
+
+	// the folder is currently indexed
+	if (mDirScanToken && dirPath == mCurrentDir)
+		return;
+
+	bool newDir = !(mFolderUpdated && dirPath == mCurrentDir) && (dirPath != mCurrentDir || mImages.empty());
+
+	// stream new folders - the image is shown while the folder is indexed
+	if (isFile && !hasZipMarker && newDir && !DkSettingsManager::param().global().scanSubFolders)
+		loadDirThreaded(dirPath);
+	else	// if here is a folder upate bug - this was before -- if (QFileInfo(filePath).isFile() || hasZipMarker) { 
+		loadDir(dirPath);
 }
 
 void DkImageLoader::load(QSharedPointer<DkImageContainerT> image /* = QSharedPointer<DkImageContainerT> */) {
@@ -924,6 +1607,9 @@ void DkImageLoader::load(QSharedPointer<DkImageContainerT> image /* = QSharedPoi
 
 	setCurrentImage(image);
 
+	if (mCurrentImage && DkSettingsManager::param().resources().cacheMemory)
+		mCache.request(mCurrentImage);
+
 	if (mCurrentImage && mCurrentImage->getLoadState() == DkImageContainerT::loading)
 		return;
 
@@ -951,23 +1637,27 @@ void DkImageLoader::imageLoaded(bool loaded /* = false */) {
 
 	emit imageUpdatedSignal(mCurrentImage);
 
+	int cIdx = mCurrentImage ? findFileIdx(mCurrentImage->filePath(), mImages) : -1;
+
 	if (mCurrentImage) {
 		// this signal is needed by the folder scrollbar
-		int idx = findFileIdx(mCurrentImage->filePath(), mImages);
-		emit imageUpdatedSignal(idx);
+		emit imageUpdatedSignal(cIdx);
 	}
 
 	QApplication::sendPostedEvents();	// force an event post here
 
 	updateCacher(mCurrentImage);
 	updateHistory();
+	updateFolderIndex(mCurrentImage);
 
 	if (mCurrentImage)
 		emit imageHasGPSSignal(DkMetaDataHelper::getInstance().hasGPS(mCurrentImage->getMetaData()));
 
+	emit imageHasSidecarSignal(mCurrentImage && mCurrentImage->hasSidecars());
+
 	// update status bar info
-	if (mCurrentImage && !mImages.empty() && mImages.indexOf(mCurrentImage) >= 0)
-		DkStatusBarManager::instance().setMessage(tr("%1 of %2").arg(mImages.indexOf(mCurrentImage)+1).arg(mImages.size()), DkStatusBar::status_filenumber_info);
+	if (mCurrentImage && !mImages.empty() && cIdx >= 0)
+		DkStatusBarManager::instance().setMessage(tr("%1 of %2").arg(cIdx+1).arg(mImages.size()), DkStatusBar::status_filenumber_info);
 	else
 		DkStatusBarManager::instance().setMessage("", DkStatusBar::status_filenumber_info);
 
@@ -1340,7 +2030,7 @@ void DkImageLoader::saveFile(const QString& filePath, const QImage& saveImg, con
 	emit updateSpinnerSignalDelayed(true);
 	QImage sImg = (saveImg.isNull()) ? imgC->image() : saveImg;
 
-	mDirWatcher->blockSignals(true);
+	mDirWatcher->setPaused(true);
 	bool saveStarted = (threaded) ? imgC->saveImageThreaded(lFilePath, sImg, compression) : imgC->saveImage(lFilePath, sImg, compression);
 
 	if (!saveStarted) {
@@ -1354,7 +2044,7 @@ void DkImageLoader::saveFile(const QString& filePath, const QImage& saveImg, con
 void DkImageLoader::imageSaved(const QString& filePath, bool saved, bool loadToTab) {
 
 	emit updateSpinnerSignalDelayed(false);
-	mDirWatcher->blockSignals(false);
+	mDirWatcher->setPaused(false);
 
 	QFileInfo fInfo(filePath);
 	if (!fInfo.exists() || !fInfo.isFile() || !saved)
@@ -1590,6 +2280,10 @@ void DkImageLoader::directoryChanged(const QString& path) {
 		// greater offset and slow down the system
 		if ((path.isEmpty() && mTimerBlockedUpdate) || (!path.isEmpty() && !mDelayedUpdateTimer.isActive())) {
 
+			// sub folders might have been added or removed
+			if (DkSettingsManager::param().global().scanSubFolders && mFolderTree)
+				mFolderTree->updateThreaded(mCurrentDir);
+
 			loadDir(mCurrentDir, false);
 			mTimerBlockedUpdate = false;
 
@@ -1602,6 +2296,87 @@ void DkImageLoader::directoryChanged(const QString& path) {
 	
 }
 
+/**
+ * Inserts files that were added to the current folder.
+ * Existing containers (and their decoded images) are kept
+ * and the new files are inserted at their sorted position.
+ * @param dirPath the folder that changed.
+ * @param fileNames the names of the new files.
+ **/ 
+void DkImageLoader::dirFilesAdded(const QString& dirPath, const QStringList& fileNames) {
+
+	if (dirPath != mCurrentDir || mDirScanToken)
+		return;
+
+	// duplicates are paired across the whole folder -> full rescan
+	if (DkSettingsManager::param().resources().filterDuplicats) {
+		directoryChanged(dirPath);
+		return;
+	}
+
+	DkTimer dt;
+	QStringList names = filterFileNames(dirPath, DkDirScanner::filter(dirPath, fileNames), mIgnoreKeywords, mKeywords, mFolderFilterString);
+	QVector<QSharedPointer<DkImageContainerT> > newImages;
+
+	for (const QString& n : names) {
+
+		QString fp = QFileInfo(dirPath, n).absoluteFilePath();
+
+		// overwritten files are updated by their containers
+		if (findFileIdx(fp, mImages) == -1)
+			newImages << QSharedPointer<DkImageContainerT>(new DkImageContainerT(fp));
+	}
+
+	if (newImages.empty())
+		return;
+
+	for (const QSharedPointer<DkImageContainerT>& imgC : newImages) {
+		auto pos = std::upper_bound(mImages.begin(), mImages.end(), imgC, imageContainerLessThanPtr);
+		mImages.insert(pos, imgC);
+	}
+	invalidateIndex();
+
+	qInfo() << "[DkImageLoader]" << newImages.size() << "files added in" << dt;
+
+	if (mFolderTree)
+		mFolderTree->setImageCount(mCurrentDir, mImages.size());
+	emit updateDirSignal(mImages);
+}
+
+/**
+ * Removes files that were deleted from the current folder.
+ * @param dirPath the folder that changed.
+ * @param fileNames the names of the deleted files.
+ **/ 
+void DkImageLoader::dirFilesRemoved(const QString& dirPath, const QStringList& fileNames) {
+
+	if (dirPath != mCurrentDir || mDirScanToken)
+		return;
+
+	if (DkSettingsManager::param().resources().filterDuplicats) {
+		directoryChanged(dirPath);
+		return;
+	}
+
+	QSet<QString> removed;
+	for (const QString& n : fileNames)
+		removed.insert(QFileInfo(dirPath, n).absoluteFilePath());
+
+	int oldSize = mImages.size();
+	mImages.erase(std::remove_if(mImages.begin(), mImages.end(), [&removed](const QSharedPointer<DkImageContainerT>& imgC) {
+		return removed.contains(imgC->filePath());
+	}), mImages.end());
+
+	if (oldSize != mImages.size()) {
+		invalidateIndex();
+		qInfo() << "[DkImageLoader]" << oldSize - mImages.size() << "files removed";
+
+		if (mFolderTree)
+			mFolderTree->setImageCount(mCurrentDir, mImages.size());
+		emit updateDirSignal(mImages);
+	}
+}
+
 /**
  * Returns true if a file was specified.
  * @return bool true if a file name/path was specified
@@ -1659,49 +2434,120 @@ QString DkImageLoader::getDirPath() const {
 	return mCurrentDir;
 }
 
+/**
+ * Returns the folders below dirPath (naturally sorted, dirPath included).
+ * The call does not block: if the tree of dirPath was not walked yet,
+ * the walk is started and just dirPath is returned.
+ * @param dirPath the root folder.
+ * @return QStringList the folders known so far.
+ **/ 
 QStringList DkImageLoader::getFoldersRecursive(const QString& dirPath) {
 
-	//DkTimer dt;
-	QStringList subFolders;
-	//qDebug() << "scanning recursively: " << dir.absolutePath();
+	if (!DkSettingsManager::param().global().scanSubFolders)
+		return QStringList() << dirPath;
 
-	if (DkSettingsManager::param().global().scanSubFolders) {
+	if (mFolderTree && mFolderTree->rootPath() == dirPath)
+		return mFolderTree->folders();
 
-		QDirIterator dirs(dirPath, QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks, QDirIterator::Subdirectories);
-	
-		int nFolders = 0;
-		while (dirs.hasNext()) {
-			dirs.next();
-			subFolders << dirs.filePath();
-			nFolders++;
+	if (!mPendingFolderTree || mPendingFolderTree->rootPath() != dirPath)
+		refreshFolderTree(dirPath);
 
-			if (nFolders > 100)
-				break;
-			
-			//getFoldersRecursive(dirs.filePath(), subFolders);
-			//qDebug() << "loop: " << dirs.filePath();
-		}
-	}	
+	return QStringList() << dirPath;
+}
+
+/**
+ * Walks the folders below rootDirPath in the background.
+ * The current tree is used until the new tree is walked (see folderTreeBuilt()).
+ * @param rootDirPath the root folder.
+ **/ 
+void DkImageLoader::refreshFolderTree(const QString& rootDirPath) {
 
-	subFolders << dirPath;
+	mPendingFolderTree = QSharedPointer<DkFolderTree>(new DkFolderTree(rootDirPath));
+	connect(mPendingFolderTree.data(), SIGNAL(builtSignal()), this, SLOT(folderTreeBuilt()));
+	connect(mPendingFolderTree.data(), SIGNAL(updatedSignal()), this, SLOT(folderTreeUpdated()));
+	mPendingFolderTree->buildThreaded();
+}
 
-	qSort(subFolders.begin(), subFolders.end(), DkUtils::compLogicQString);
+void DkImageLoader::folderTreeUpdated() {
 
-	qDebug() << dirPath << "loaded recursively...";
-	
-	//qDebug() << "scanning folders recursively took me: " << QString::fromStdString(dt.getTotal());
-	return subFolders;
+	if (!mFolderTree || sender() != mFolderTree.data())
+		return;
+
+	mSubFolders = mFolderTree->folders();
 }
 
+void DkImageLoader::folderTreeBuilt() {
+
+	// an outdated walk
+	if (!mPendingFolderTree || sender() != mPendingFolderTree.data())
+		return;
+
+	mFolderTree = mPendingFolderTree;
+	mPendingFolderTree.clear();
+
+	// counts of the loader are more recent
+	if (!mImages.empty())
+		mFolderTree->setImageCount(mCurrentDir, mImages.size());
+
+	mSubFolders = mFolderTree->folders();
+
+	if (!mLoadFirstSubFolder)
+		return;
+
+	mLoadFirstSubFolder = false;
+	bool hasKeywords = !mIgnoreKeywords.empty() || !mKeywords.empty();
+
+	// the root is empty - find the first subfolder that has images
+	for (const QString& dirPath : mSubFolders) {
+
+		if (mFolderTree->imageCount(dirPath) <= 0)
+			continue;
+
+		if (hasKeywords && getFilteredFileInfoList(dirPath, mIgnoreKeywords, mKeywords).empty())
+			continue;
+
+		if (loadDir(dirPath, false))
+			firstFile();
+		return;
+	}
+
+	emit showInfoSignal(tr("%1 \n does not contain any image").arg(mFolderTree->rootPath()), 4000);
+}
+
+/**
+ * Starts walking the folders below rootDirPath and returns the first files found.
+ * The tree is walked in the background. Until it is built, the last tree 
+ * of the same root is used - or just the root's files are returned.
+ * @param rootDirPath the root folder.
+ * @return QFileInfoList the files of the first folder that has images.
+ **/ 
 QFileInfoList DkImageLoader::updateSubFolders(const QString& rootDirPath) {
 	
-	mSubFolders = getFoldersRecursive(rootDirPath);
+	if (mFolderTree && mFolderTree->rootPath() != rootDirPath)
+		mFolderTree.clear();
+
+	// rescan the root only - sub folders might have been added since the last walk
+	if (mFolderTree)
+		mFolderTree->updateThreaded(rootDirPath);
+	else if (!mPendingFolderTree || mPendingFolderTree->rootPath() != rootDirPath)
+		refreshFolderTree(rootDirPath);
+
+	if (mFolderTree)
+		mSubFolders = mFolderTree->folders();
+	
+	if (mSubFolders.empty() || !mFolderTree)
+		mSubFolders = QStringList() << rootDirPath;
+
 	QFileInfoList files;
-	qDebug() << mSubFolders;
 
 	// find the first subfolder that has images
 	for (int idx = 0; idx < mSubFolders.size(); idx++) {
 		mCurrentDir = mSubFolders[idx];
+		
+		// the tree already knows empty folders
+		if (mFolderTree && mFolderTree->imageCount(mCurrentDir) == 0)
+			continue;
+
 		files = getFilteredFileInfoList(mCurrentDir, mIgnoreKeywords, mKeywords);		// this line takes seconds if you have lots of files and slow loading (e.g. network)
 		if (!files.empty())
 			break;
@@ -1712,58 +2558,43 @@ QFileInfoList DkImageLoader::updateSubFolders(const QString& rootDirPath) {
 
 int DkImageLoader::getNextFolderIdx(int folderIdx) {
 	
-	int nextIdx = -1;
-
-	if (mSubFolders.empty())
-		return nextIdx;
-
-	// find the first sub folder that has images
-	for (int idx = 1; idx < mSubFolders.size(); idx++) {
-		
-		int tmpNextIdx = folderIdx + idx;
-
-		if (DkSettingsManager::param().global().loop)
-			tmpNextIdx %= mSubFolders.size();
-		else if (tmpNextIdx >= mSubFolders.size())
-			return -1;
-
-		QDir cDir = mSubFolders[tmpNextIdx];
-		QFileInfoList cFiles = getFilteredFileInfoList(cDir.absolutePath(), mIgnoreKeywords, mKeywords);		// this line takes seconds if you have lots of files and slow loading (e.g. network)
-		if (!cFiles.empty()) {
-			nextIdx = tmpNextIdx;
-			break;
-		}
-	}
-
-	return nextIdx;
+	return findNonEmptyFolderIdx(folderIdx, 1);
 }
 
 int DkImageLoader::getPrevFolderIdx(int folderIdx) {
 	
-	int prevIdx = -1;
+	return findNonEmptyFolderIdx(folderIdx, -1);
+}
+
+/**
+ * Returns the index of the next sub folder that has images.
+ * The search is answered by the cached folder tree. Folders
+ * are only listed if keywords could hide their images.
+ * @param folderIdx the current folder's index in mSubFolders.
+ * @param step > 0 searches forward, < 0 backwards.
+ * @return int the index of the next non-empty folder or -1.
+ **/ 
+int DkImageLoader::findNonEmptyFolderIdx(int folderIdx, int step) {
 
-	if (mSubFolders.empty())
-		return prevIdx;
+	if (!mFolderTree || folderIdx < 0 || folderIdx >= mSubFolders.size())
+		return -1;
+
+	bool loop = DkSettingsManager::param().global().loop;
+	bool hasKeywords = !mIgnoreKeywords.empty() || !mKeywords.empty();
+	QString cDir = mSubFolders[folderIdx];
 
-	// find the first sub folder that has images
 	for (int idx = 1; idx < mSubFolders.size(); idx++) {
 
-		int tmpPrevIdx = folderIdx - idx;
+		cDir = mFolderTree->nextFolder(cDir, step, loop);
 
-		if (DkSettingsManager::param().global().loop && tmpPrevIdx < 0)
-			tmpPrevIdx += mSubFolders.size();
-		else if (tmpPrevIdx < 0)
+		if (cDir.isEmpty() || cDir == mSubFolders[folderIdx])
 			return -1;
 
-		QDir cDir = mSubFolders[tmpPrevIdx];
-		QFileInfoList cFiles = getFilteredFileInfoList(cDir.absolutePath(), mIgnoreKeywords, mKeywords);		// this line takes seconds if you have lots of files and slow loading (e.g. network)
-		if (!cFiles.empty()) {
-			prevIdx = tmpPrevIdx;
-			break;
-		}
+		if (!hasKeywords || !getFilteredFileInfoList(cDir, mIgnoreKeywords, mKeywords).empty())
+			return mSubFolders.indexOf(cDir);
 	}
 
-	return prevIdx;
+	return -1;
 }
 
 void DkImageLoader::errorDialog(const QString& msg) const {
@@ -1777,169 +2608,97 @@ void DkImageLoader::errorDialog(const QString& msg) const {
 	errorDialog.exec();
 }
 
+/**
+ * Updates the image cache if the current image changed.
+ * @param imgC the current image
+ **/ 
 void DkImageLoader::updateCacher(QSharedPointer<DkImageContainerT> imgC) {
 
 	if (!imgC || !DkSettingsManager::param().resources().cacheMemory)
 		return;
 
-	DkTimer dt;
-
-	//// no caching? delete all
-	//if (!DkSettingsManager::param().resources().cacheMemory) {
-	//	for (int idx = 0; idx < images.size(); idx++) {
-	//		images.at(idx)->clear();
-	//	}
-	//	return;
-	//}
-
 	int cIdx = findFileIdx(imgC->filePath(), mImages);
-	double mem = 0;
-	double totalMem = 0;
 
 	if (cIdx == -1) {
 		qWarning() << "WARNING: image not found for caching!";
 		return;
 	}
 
-	for (int idx = 0; idx < mImages.size(); idx++) {
-
-		auto cImg = mImages.at(idx);
-
-		// clear images if they are edited
-		if (idx != cIdx && cImg->isEdited()) {
-			cImg->clear();
-			continue;
-		}
-
-		// do not count the last & the current image
-		if (idx > cIdx && idx <= cIdx+DkSettingsManager::param().resources().maxImagesCached)
-			mem += cImg->getMemoryUsage();
-		else if (abs(cIdx-idx) > 1) {
-			cImg->clear();
-			if (cImg->hasImage())
-				qDebug() << "[Cacher]" << cImg->filePath() << "freed";
-
-			continue;
-		}
-		else
-			totalMem += cImg->getMemoryUsage();
-
-		// ignore the last and current one
-		if (idx == cIdx-1 || idx == cIdx) {
-			continue;
-		}
-		// fully load the next image
-		else if (idx == cIdx+1 && mem < DkSettingsManager::param().resources().cacheMemory && mImages.at(idx)->getLoadState() == DkImageContainerT::not_loaded) {
-			cImg->loadImageThreaded();
-			qDebug() << "[Cacher] " <<cImg->filePath() << " fully cached...";
-		}
-		else if (idx > cIdx && idx < cIdx+DkSettingsManager::param().resources().maxImagesCached-2 && mem < DkSettingsManager::param().resources().cacheMemory && mImages.at(idx)->getLoadState() == DkImageContainerT::not_loaded) {
-			//dt.getIvl();
-			mImages.at(idx)->fetchFile();		// TODO: crash detected here
-			qDebug() << "[Cacher] " << cImg->filePath() << " file fetched...";
-		}
-	}
-
-	qDebug() << "[Cacher] created in" << dt << "(" << mem + totalMem << "MB)";
+	mCache.update(mImages, cIdx);
 }
 
 /**
  * Returns the file list of the directory dir.
+ * The directory is read in a single pass (see DkDirScanner).
  * Note: this function might get slow if lots of files (> 10000) are in the
  * directory or if the directory is in the net.
- * Currently the file list is sorted according to the system specification.
+ * The file list is not sorted - createImages sorts the containers.
  * @param dir the directory to load the file list from.
  * @param ignoreKeywords if one of these keywords is in the file name, the file will be ignored.
  * @param keywords if one of these keywords is not in the file name, the file will be ignored.
+ * @param sidecars if set, it is filled with the duplicates that are hidden (see DkImageContainerT::sidecars).
  * @return QStringList all filtered files of the current directory.
  **/ 
-QFileInfoList DkImageLoader::getFilteredFileInfoList(const QString& dirPath, QStringList ignoreKeywords, QStringList keywords, QString folderKeywords) {
-
-	DkTimer dt;
+QFileInfoList DkImageLoader::getFilteredFileInfoList(const QString& dirPath, QStringList ignoreKeywords, QStringList keywords, QString folderKeywords, QHash<QString, QStringList>* sidecars) {
 
 	if (dirPath.isEmpty())
 		return QFileInfoList();
 
-#ifdef Q_OS_WIN
+	QStringList fileList = DkDirScanner::scan(dirPath);
+	fileList = filterFileNames(dirPath, fileList, ignoreKeywords, keywords, folderKeywords, sidecars);
 
-	QString winPath = QDir::toNativeSeparators(dirPath) + "\\*.*";
+	QFileInfoList fileInfoList;
+	fileInfoList.reserve(fileList.size());
+	
+	for (const QString& name : fileList)
+		fileInfoList.append(QFileInfo(dirPath, name));
 
-	const wchar_t* fname = reinterpret_cast<const wchar_t *>(winPath.utf16());
+	return fileInfoList;
+}
 
-	WIN32_FIND_DATAW findFileData;
-	HANDLE MyHandle = FindFirstFileW(fname, &findFileData);
+/**
+ * Applies the user's filters to a list of file names.
+ * @param dirPath the directory of the files.
+ * @param fileList the file names.
+ * @param ignoreKeywords if one of these keywords is in the file name, the file will be ignored.
+ * @param keywords if one of these keywords is not in the file name, the file will be ignored.
+ * @param folderKeywords the folder filter query.
+ * @param sidecars if set, it is filled with the files that were filtered as duplicates (keyed by the file shown).
+ * @return QStringList the filtered file names.
+ **/ 
+QStringList DkImageLoader::filterFileNames(const QString& dirPath, QStringList fileList, const QStringList& ignoreKeywords, const QStringList& keywords, const QString& folderKeywords, QHash<QString, QStringList>* sidecars) const {
 
-	std::vector<std::wstring> fileNameList;
-	std::wstring fileName;
+	Q_UNUSED(dirPath);
 
-	if( MyHandle != INVALID_HANDLE_VALUE) {
-		
-		do {
+	// remove files that contain ignore keywords - compile the expressions once
+	if (!ignoreKeywords.empty() || !keywords.empty()) {
 
-			fileName = findFileData.cFileName;
-			fileNameList.push_back(fileName);	// TODO: sort correct according to numbers
-		} while(FindNextFileW(MyHandle, &findFileData) != 0);
-	}
+		QVector<QRegExp> ignoreExps;
+		for (const QString& kw : ignoreKeywords)
+			ignoreExps << QRegExp(kw, Qt::CaseInsensitive);
 
-	FindClose(MyHandle);
-	
-	// remove the * in fileFilters
-	QStringList fileFiltersClean = DkSettingsManager::param().app().browseFilters;
-	for (QString& filter : fileFiltersClean)
-		filter.replace("*", "");
-	
-	//qDebug() << "browse filters: " << DkSettingsManager::param().app().browseFilters;
+		QStringList resultList;
+		resultList.reserve(fileList.size());
 
-	QStringList fileList;
-	std::vector<std::wstring>::iterator lIter = fileNameList.begin();
+		for (const QString& name : fileList) {
 
-	// convert to QStringList
-	for (unsigned int idx = 0; idx < fileNameList.size(); idx++, lIter++) {
-		
-		QString qFilename = DkUtils::stdWStringToQString(*lIter);
+			bool keep = true;
 
-		// believe it or not, but this is 10 times faster than QRegExp
-		// drawback: we also get files that contain *.jpg*
-		for (int i = 0; i < fileFiltersClean.size(); i++) {
-
-			if (qFilename.contains(fileFiltersClean[i], Qt::CaseInsensitive)) {
-				fileList.append(qFilename);
-				break;
+			for (const QRegExp& exp : ignoreExps) {
+				if (exp.indexIn(name) != -1) {
+					keep = false;
+					break;
+				}
 			}
-		}
-	}
-
-	qInfoClean() << "WinAPI, indexed (" << fileList.size() <<") files in: " << dt;
-#else
-
-	// true file list
-	QDir tmpDir(dirPath);
-	tmpDir.setSorting(QDir::LocaleAware);
-	QStringList fileList = tmpDir.entryList(DkSettingsManager::param().app().browseFilters);
-
-#endif
 
-	// append files with no suffix
-	QDir cDir(dirPath);
-	QStringList allFiles = cDir.entryList();
-	QStringList noSuffixFiles;
+			for (int idx = 0; keep && idx < keywords.size(); idx++)
+				keep = name.contains(keywords[idx], Qt::CaseInsensitive);
 
-	for (const QString& name : allFiles) {
-		
-		if (!name.contains(".") && DkUtils::isValid(QFileInfo(dirPath, name))) {
-			fileList << name;
+			if (keep)
+				resultList << name;
 		}
-	}
-
-	// remove files that contain ignore keywords
-	for (int idx = 0; idx < ignoreKeywords.size(); idx++) {
-		QRegExp exp = QRegExp("^((?!" + ignoreKeywords[idx] + ").)*$");
-		exp.setCaseSensitivity(Qt::CaseInsensitive);
-		fileList = fileList.filter(exp);
-	}
 
-	for (int idx = 0; idx < keywords.size(); idx++) {
-		fileList = fileList.filter(keywords[idx], Qt::CaseInsensitive);
+		fileList = resultList;
 	}
 
 	if (folderKeywords != "") {
@@ -1953,49 +2712,52 @@ QFileInfoList DkImageLoader::getFilteredFileInfoList(const QString& dirPath, QSt
 		preferredExtension = preferredExtension.replace("*.", "");
 		qDebug() << "preferred extension: " << preferredExtension;
 
-		QStringList resultList = fileList;
-		fileList.clear();
-		
-		for (int idx = 0; idx < resultList.size(); idx++) {
-			
-			QFileInfo cFName = QFileInfo(resultList.at(idx));
+		// same as QFileInfo::baseName() & QFileInfo::suffix() but w/o file system access
+		auto baseName = [](const QString& name) { int idx = name.indexOf("."); return idx == -1 ? name : name.left(idx); };
+		auto isPreferred = [&preferredExtension](const QString& name) {
+			int idx = name.lastIndexOf(".");
+			return idx != -1 && preferredExtension.compare(name.mid(idx + 1), Qt::CaseInsensitive) == 0;
+		};
 
-			if (preferredExtension.compare(cFName.suffix(), Qt::CaseInsensitive) == 0) {
-				fileList.append(resultList.at(idx));
-				continue;
-			}
+		// base name -> file with the preferred extension
+		QHash<QString, QString> preferredFiles;
+		preferredFiles.reserve(fileList.size());
+
+		for (const QString& name : fileList) {
+			if (isPreferred(name))
+				preferredFiles.insert(baseName(name), name);
+		}
 
-			QString cFBase = cFName.baseName();
-			bool remove = false;
+		QStringList resultList;
+		resultList.reserve(fileList.size());
 
-			for (int cIdx = 0; cIdx < resultList.size(); cIdx++) {
+		for (const QString& name : fileList) {
 
-				QString ccBase = QFileInfo(resultList.at(cIdx)).baseName();
+			if (!isPreferred(name)) {
 
-				if (cIdx != idx && ccBase == cFBase && resultList.at(cIdx).contains(preferredExtension, Qt::CaseInsensitive)) {
-					remove = true;
-					break;
+				auto pIt = preferredFiles.constFind(baseName(name));
+
+				// there is a preferred file -> hide this one behind it
+				if (pIt != preferredFiles.constEnd()) {
+					if (sidecars)
+						(*sidecars)[pIt.value()] << name;
+					continue;
 				}
 			}
-			
-			if (!remove)
-				fileList.append(resultList.at(idx));
-		}
-	}
 
-	//fileList = sort(fileList, dir);
+			resultList << name;
+		}
 
-	QFileInfoList fileInfoList;
-	
-	for (int idx = 0; idx < fileList.size(); idx++)
-		fileInfoList.append(QFileInfo(mCurrentDir, fileList.at(idx)));
+		fileList = resultList;
+	}
 
-	return fileInfoList;
+	return fileList;
 }
 
 void DkImageLoader::sort() {
 	
-	qSort(mImages.begin(), mImages.end(), imageContainerLessThanPtr);
+	mImages = sortImages(mImages);
+	invalidateIndex();
 	emit updateDirSignal(mImages);
 }
 
@@ -2007,6 +2769,14 @@ void DkImageLoader::currentImageUpdated() const {
 	emit imageUpdatedSignal(mCurrentImage);
 }
 
+void DkImageLoader::imagePreviewLoaded() const {
+
+	if (mCurrentImage.isNull())
+		return;
+
+	emit imagePreviewSignal(mCurrentImage);
+}
+
 /**
  * Returns the directory where files are copied to.
  * @return QDir the directory where the user copied the last file to.
@@ -30,8 +30,14 @@
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QTimer>
 #include <QImage>
+#include <QSet>
+#include <QFileInfo>
+#include <QFuture>
+#include <QRegExp>
 #pragma warning(pop)	// no warnings from includes - end
 
+#include <functional>
+
 #ifndef DllCoreExport
 #ifdef DK_CORE_DLL_EXPORT
 #define DllCoreExport Q_DECL_EXPORT
@@ -44,17 +50,68 @@
 
 // my classes
 #include "DkImageContainer.h"
+#include "DkImageCache.h"
+#include "DkFolderIndex.h"
 
 #ifdef Q_OS_LINUX
 	typedef  unsigned char byte;
 #endif
 
 // Qt defines
-class QFileSystemWatcher;
 class QUrl;
 
 namespace nmc {
 
+class DkCancelToken;
+class DkFolderWatcher;
+class DkFolderTree;
+
+/**
+ * Lists the images of a folder in a single pass.
+ * On unix the folder is read with readdir and files are only
+ * stat'ed if the file system does not report their type.
+ * Files are matched against the browse filters by their suffix.
+ * Files without a suffix are identified by their content.
+ * The results can be streamed in chunks so that the first 
+ * images can be shown while huge folders are still scanned.
+ **/ 
+class DllCoreExport DkDirScanner : public QObject {
+	Q_OBJECT
+
+public:
+	DkDirScanner(QObject* parent = 0);
+	~DkDirScanner();
+
+	static QStringList scan(const QString& dirPath, 
+		const std::function<void(const QStringList&)>& chunkFn = std::function<void(const QStringList&)>(),
+		const QSharedPointer<DkCancelToken>& token = QSharedPointer<DkCancelToken>(),
+		QStringList* subDirs = 0);
+
+	static QStringList filter(const QString& dirPath, const QStringList& fileNames);
+	void scanThreaded(const QString& dirPath, const QSharedPointer<DkCancelToken>& token);
+
+signals:
+	void filesFoundSignal(const QString& dirPath, const QStringList& fileNames, bool finished) const;
+
+protected:
+	enum {
+		chunk_size = 2000,	// max files per chunk
+		chunk_ms = 200,		// max time between two chunks
+	};
+
+	struct Filters {
+		QSet<QString> suffixes;		// e.g. jpg
+		QStringList compound;		// e.g. .tar.gz
+		QVector<QRegExp> wildcards;	// e.g. *.jp?
+	};
+
+	static Filters browseFilters();
+	static bool matches(const QString& fileName, const Filters& filters);
+
+	QFuture<QStringList> mFuture;
+	QSharedPointer<DkCancelToken> mToken;
+};
+
 /**
  * This class is a basic image loader class.
  * It takes care of the file watches for the current folder,
@@ -70,9 +127,9 @@ public:
 	DkImageLoader(const QString& filePath = QString());
 	virtual ~DkImageLoader();
 
-	static QStringList getFoldersRecursive(const QString& dirPath);
+	QStringList getFoldersRecursive(const QString& dirPath);
 	QFileInfoList updateSubFolders(const QString& rootDirPath);
-	QFileInfoList getFilteredFileInfoList(const QString& dirPath, QStringList ignoreKeywords = QStringList(), QStringList keywords = QStringList(), QString folderKeywords = QString());
+	QFileInfoList getFilteredFileInfoList(const QString& dirPath, QStringList ignoreKeywords = QStringList(), QStringList keywords = QStringList(), QString folderKeywords = QString(), QHash<QString, QStringList>* sidecars = 0);
 
 	void rotateImage(double angle);
 	QSharedPointer<DkImageContainerT> getCurrentImage() const;
@@ -139,9 +196,11 @@ signals:
 	void imageUpdatedSignal(QSharedPointer<DkImageContainerT> image) const;
 	void imageUpdatedSignal(int idx) const;	// folder scrollbar needs that
 	void imageLoadedSignal(QSharedPointer<DkImageContainerT> image, bool loaded = true) const;
+	void imagePreviewSignal(QSharedPointer<DkImageContainerT> image) const;
 	void showInfoSignal(const QString& msg, int time = 3000, int position = 0) const;
 	void updateDirSignal(QVector<QSharedPointer<DkImageContainerT> > images) const;
 	void imageHasGPSSignal(bool hasGPS) const;
+	void imageHasSidecarSignal(bool hasSidecar) const;
 	void loadImageToTab(const QString& filePath) const;
 
 public slots:
@@ -168,21 +227,41 @@ public slots:
 
 	// new slots
 	void currentImageUpdated() const;
+	void imagePreviewLoaded() const;
 	void imageLoaded(bool loaded = false);
 	void imageSaved(const QString& file, bool saved = true, bool loadToTab = true);
 	void imagesSorted();
+	void dirFilesFound(const QString& dirPath, const QStringList& fileNames, bool finished);
+	void dirFilesAdded(const QString& dirPath, const QStringList& fileNames);
+	void dirFilesRemoved(const QString& dirPath, const QStringList& fileNames);
 	bool unloadFile();
 	void reloadImage();
 	void showOnMap();
+	void loadSidecar();
+
+protected slots:
+	void folderTreeBuilt();
+	void folderTreeUpdated();
 
 protected:
 	// functions
 	void updateCacher(QSharedPointer<DkImageContainerT> imgC);
 	int getNextFolderIdx(int folderIdx);
 	int getPrevFolderIdx(int folderIdx);
+	int findNonEmptyFolderIdx(int folderIdx, int step);
+	void refreshFolderTree(const QString& rootDirPath);
 	void updateHistory();
 	void sortImagesThreaded(QVector<QSharedPointer<DkImageContainerT > > images);
-	void createImages(const QFileInfoList& files, bool sort = true);
+	void loadDirThreaded(const QString& dirPath);
+	void cancelDirScan();
+	QFileInfoList getIndexedFileInfoList(const QString& dirPath, QHash<QString, QStringList>* sidecars = 0);
+	void loadFolderIndex(const QString& dirPath);
+	void updateFolderIndex(QSharedPointer<DkImageContainerT> imgC);
+	int imageIndex(const QString& filePath) const;
+	void invalidateIndex();
+	void rebuildIndex() const;
+	QStringList filterFileNames(const QString& dirPath, QStringList fileList, const QStringList& ignoreKeywords, const QStringList& keywords, const QString& folderKeywords, QHash<QString, QStringList>* sidecars = 0) const;
+	void createImages(const QFileInfoList& files, bool sort = true, const QHash<QString, QStringList>& sidecars = QHash<QString, QStringList>());
 	QVector<QSharedPointer<DkImageContainerT > > sortImages(QVector<QSharedPointer<DkImageContainerT > > images) const;
 
 	QStringList mIgnoreKeywords;
@@ -194,7 +273,10 @@ protected:
 	QString mCurrentDir;
 	QString mSaveDir;
 	QString mCopyDir;
-	QFileSystemWatcher* mDirWatcher = 0;
+	DkFolderWatcher* mDirWatcher = 0;
+	QSharedPointer<DkFolderTree> mFolderTree;
+	QSharedPointer<DkFolderTree> mPendingFolderTree;	// walked in the background - replaces mFolderTree once it is built
+	bool mLoadFirstSubFolder = false;					// the root was empty - load the first sub folder with images once the tree is walked
 	QStringList mSubFolders;
 	QVector<QSharedPointer<DkImageContainerT > > mImages;
 	QSharedPointer<DkImageContainerT > mCurrentImage;
@@ -204,6 +286,15 @@ protected:
 	bool mSortingImages = false;
 	bool mSortingIsDirty = false;
 	QFutureWatcher<QVector<QSharedPointer<DkImageContainerT > > > mCreateImageWatcher;
+	DkImageCache mCache;
+	DkDirScanner* mDirScanner = 0;
+	QSharedPointer<DkCancelToken> mDirScanToken;
+	QStringList mDirScanFiles;
+	qint64 mDirScanModified = 0;
+	QSharedPointer<DkFolderIndex> mFolderIndex = QSharedPointer<DkFolderIndex>(new DkFolderIndex());
+
+	mutable QHash<QString, int> mImageIndex;	// file path -> index in mImages
+	mutable bool mImageIndexDirty = true;
 
 };
 
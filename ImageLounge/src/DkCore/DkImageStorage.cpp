@@ -31,6 +31,7 @@
 #include "DkTimer.h"
 #include "DkMath.h"
 #include "DkThumbs.h"
+#include "DkScheduler.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QDebug>
@@ -1559,7 +1560,10 @@ void DkImageStorage::compute() {
 
 	mComputeState = l_computing;
 
-	mFutureWatcher.setFuture(QtConcurrent::run(this, &nmc::DkImageStorage::computeIntern, mImg, mScale));
+	QImage img = mImg;
+	double scale = mScale;
+	mFutureWatcher.setFuture(DkDecodeScheduler::instance().run<QImage>(DkDecodeScheduler::priority_display, 
+		[img, scale]() { return computeIntern(img, scale); }));
 }
 
 QImage DkImageStorage::computeIntern(const QImage & src, double scale) {
@@ -1579,12 +1583,12 @@ QImage DkImageStorage::computeIntern(const QImage & src, double scale) {
 		}
 
 		// for extreme panorama images the Qt scaling crashes (if we have a width > 30000) so we simply 
-		if (cs != mImg.size()) {
+		if (cs != src.size()) {
 			resizedImg = resizedImg.scaled(cs, Qt::KeepAspectRatio, Qt::FastTransformation);
 		}
 	}
 
-	QSize s = mImg.size() * scale;
+	QSize s = src.size() * scale;
 
 	if (s.height() == 0)
 		s.setHeight(1);
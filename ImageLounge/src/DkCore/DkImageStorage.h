@@ -196,7 +196,7 @@ protected:
 
 	ComputeState mComputeState = l_not_computed;
 
-	QImage computeIntern(const QImage& src, double scale);
+	static QImage computeIntern(const QImage& src, double scale);
 	void init();
 
 };
@@ -38,8 +38,12 @@
 #include <QImage>
 #include <QDebug>
 #include <QBuffer>
+#include <QSaveFile>
 #include <QVector2D>
 #include <QApplication>
+#include <QMutexLocker>
+
+#include <exiv2/convert.hpp>
 #pragma warning(pop)		// no warnings from includes - end
 
 #include <iostream>
@@ -54,6 +58,8 @@ DkMetaDataT::DkMetaDataT() {
 
 void DkMetaDataT::readMetaData(const QString& filePath, QSharedPointer<QByteArray> ba) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mUseSidecar) {
 		loadSidecar(filePath);
 		return;
@@ -115,6 +121,8 @@ void DkMetaDataT::readMetaData(const QString& filePath, QSharedPointer<QByteArra
 
 bool DkMetaDataT::saveMetaData(const QString& filePath, bool force) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState != loaded && mExifState != dirty)
 		return false;
 
@@ -133,17 +141,13 @@ bool DkMetaDataT::saveMetaData(const QString& filePath, bool force) {
 		return false;
 	}
 
-	file.open(QFile::WriteOnly);
-	file.write(ba->data(), ba->size());
-	file.close();
-
-	qDebug() << "[DkMetaDataT] I saved: " << ba->size() << " bytes";
-
-	return true;
+	return writeBuffer(filePath, ba);
 }
 
 bool DkMetaDataT::saveMetaData(QSharedPointer<QByteArray>& ba, bool force) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (!ba)
 		return false;
 
@@ -152,9 +156,147 @@ bool DkMetaDataT::saveMetaData(QSharedPointer<QByteArray>& ba, bool force) {
 	else if (mExifState == not_loaded || mExifState == no_data)
 		return false;
 
-	Exiv2::ExifData &exifData = mExifImg->exifData();
-	Exiv2::XmpData &xmpData = mExifImg->xmpData();
-	Exiv2::IptcData &iptcData = mExifImg->iptcData();
+	Exiv2::Image::AutoPtr exifImgN = writeMetaData(ba, mExifImg->exifData(), mExifImg->iptcData(), mExifImg->xmpData());
+
+	if (exifImgN.get() == 0)
+		return false;
+
+	mExifImg = exifImgN;
+	mExifState = loaded;
+
+	return true;
+}
+
+/**
+ * Copies the metadata (e.g. for writing it in the background).
+ * @return bool false if no metadata is loaded.
+ **/ 
+bool DkMetaDataT::copyMetaData(Exiv2::ExifData& exifData, Exiv2::IptcData& iptcData, Exiv2::XmpData& xmpData) const {
+
+	QMutexLocker locker(&mMutex);
+
+	if (mExifState != loaded && mExifState != dirty)
+		return false;
+
+	exifData = mExifImg->exifData();
+	iptcData = mExifImg->iptcData();
+	xmpData = mExifImg->xmpData();
+
+	return true;
+}
+
+/**
+ * Marks edited metadata as saved.
+ * Call this if the metadata was copied to be written elsewhere (see DkMetaDataWriter).
+ **/ 
+void DkMetaDataT::setSaved() {
+
+	QMutexLocker locker(&mMutex);
+
+	if (mExifState == dirty)
+		mExifState = loaded;
+}
+
+/**
+ * Marks edited metadata as saved if it was not edited since revision.
+ * @param revision the revision that was written (see revision()).
+ * @return bool true if the metadata is not dirty anymore.
+ **/ 
+bool DkMetaDataT::setSaved(int revision) {
+
+	QMutexLocker locker(&mMutex);
+
+	if (mRevision != revision)
+		return false;
+
+	setSaved();
+	return true;
+}
+
+/**
+ * Returns the edit count - it is increased with every edit.
+ **/ 
+int DkMetaDataT::revision() const {
+
+	QMutexLocker locker(&mMutex);
+	return mRevision;
+}
+
+/**
+ * Writes metadata to a file (in place).
+ * @param filePath the image's file path.
+ * @return bool true if the file was written.
+ **/ 
+bool DkMetaDataT::writeMetaData(const QString& filePath, const Exiv2::ExifData& exifData, const Exiv2::IptcData& iptcData, const Exiv2::XmpData& xmpData) {
+
+	QFile file(filePath);
+
+	if (!file.open(QFile::ReadOnly))
+		return false;
+
+	QSharedPointer<QByteArray> ba(new QByteArray(file.readAll()));
+	file.close();
+
+	if (ba->isEmpty() || writeMetaData(ba, exifData, iptcData, xmpData).get() == 0) {
+		qDebug() << "[DkMetaDataT] could not save: " << QFileInfo(filePath).fileName();
+		return false;
+	}
+
+	return writeBuffer(filePath, ba);
+}
+
+/**
+ * Writes metadata to the image's XMP sidecar (<name>.xmp).
+ * EXIF and IPTC values are converted to XMP. Properties 
+ * that are only stored in an existing sidecar are kept.
+ * @param filePath the image's file path.
+ * @return bool true if the sidecar was written.
+ **/ 
+bool DkMetaDataT::writeSidecar(const QString& filePath, const Exiv2::ExifData& exifData, const Exiv2::IptcData& iptcData, const Exiv2::XmpData& xmpData) {
+
+	Exiv2::XmpData xmp = xmpData;
+	Exiv2::copyExifToXmp(exifData, xmp);
+	Exiv2::copyIptcToXmp(iptcData, xmp);
+
+	QString xmpFilePath = sidecarPath(filePath);
+
+	try {
+		Exiv2::Image::AutoPtr xmpImg;
+
+		if (QFileInfo(xmpFilePath).exists()) {
+			xmpImg = Exiv2::ImageFactory::open(xmpFilePath.toStdString());
+			xmpImg->readMetadata();
+		}
+		else
+			xmpImg = Exiv2::ImageFactory::create(Exiv2::ImageType::xmp, xmpFilePath.toStdString());
+
+		Exiv2::XmpData& sidecarData = xmpImg->xmpData();
+
+		for (Exiv2::XmpData::const_iterator it = xmp.begin(); it != xmp.end(); ++it) {
+
+			Exiv2::XmpData::iterator pos = sidecarData.findKey(Exiv2::XmpKey(it->key()));
+			if (pos != sidecarData.end())
+				sidecarData.erase(pos);
+
+			sidecarData.add(*it);
+		}
+
+		xmpImg->writeMetadata();
+	}
+	catch (...) {
+		qWarning() << "[DkMetaDataT] could not write sidecar:" << xmpFilePath;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Writes metadata to an image buffer.
+ * @param ba the image buffer - it is replaced by the updated buffer.
+ * @return Exiv2::Image::AutoPtr the updated image or NULL if the metadata could not be written.
+ **/ 
+Exiv2::Image::AutoPtr DkMetaDataT::writeMetaData(QSharedPointer<QByteArray>& ba, const Exiv2::ExifData& exifData, const Exiv2::IptcData& iptcData, const Exiv2::XmpData& xmpData) {
 
 	Exiv2::Image::AutoPtr exifImgN;
 	Exiv2::MemIo::AutoPtr exifMem;
@@ -167,12 +309,12 @@ bool DkMetaDataT::saveMetaData(QSharedPointer<QByteArray>& ba, bool force) {
 	catch (...) {
 
 		qDebug() << "could not open image for exif data";
-		return false;
+		return Exiv2::Image::AutoPtr();
 	}
 
 	if (exifImgN.get() == 0) {
 		qDebug() << "image could not be opened for exif data extraction";
-		return false;
+		return exifImgN;
 	}
 
 
@@ -192,19 +334,46 @@ bool DkMetaDataT::saveMetaData(QSharedPointer<QByteArray>& ba, bool force) {
 		if (tmp->size() > qRound(ba->size()*0.5f))
 			ba = tmp;
 		else
-			return false;	// catch exif bug - observed e.g. for hasselblad RAW (3fr) files - see: Bug #995 (http://dev.exiv2.org/issues/995)
+			return Exiv2::Image::AutoPtr();	// catch exif bug - observed e.g. for hasselblad RAW (3fr) files - see: Bug #995 (http://dev.exiv2.org/issues/995)
 	}
 	else
+		return Exiv2::Image::AutoPtr();
+
+	return exifImgN;
+}
+
+bool DkMetaDataT::writeBuffer(const QString& filePath, QSharedPointer<QByteArray> ba) {
+
+	// do not truncate the file - it might be mapped (see DkMappedBuffer)
+	QSaveFile saveFile(filePath);
+
+	if (!saveFile.open(QFile::WriteOnly)) {
+		qWarning() << "[DkMetaDataT] could not write" << QFileInfo(filePath).fileName() << "-" << saveFile.errorString();
 		return false;
+	}
 
-	mExifImg = exifImgN;
-	mExifState = loaded;
+	saveFile.write(ba->constData(), ba->size());
+	
+	if (!saveFile.commit()) {
+		qWarning() << "[DkMetaDataT] could not write" << QFileInfo(filePath).fileName() << "-" << saveFile.errorString();
+		return false;
+	}
+
+	qDebug() << "[DkMetaDataT] I saved: " << ba->size() << " bytes";
 
 	return true;
 }
 
+QString DkMetaDataT::sidecarPath(const QString& filePath) {
+
+	QString ext = QFileInfo(filePath).suffix();
+	return filePath.left(filePath.length() - ext.length() - 1) + ".xmp";
+}
+
 QString DkMetaDataT::getDescription() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString description;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -235,6 +404,8 @@ QString DkMetaDataT::getDescription() const {
 
 int DkMetaDataT::getOrientationDegree() const {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState != loaded && mExifState != dirty)
 		return 0;
 
@@ -275,6 +446,8 @@ int DkMetaDataT::getOrientationDegree() const {
 
 DkMetaDataT::ExifOrientationState DkMetaDataT::checkExifOrientation() const {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState != loaded && mExifState != dirty)
 		return or_not_set;
 
@@ -298,6 +471,8 @@ DkMetaDataT::ExifOrientationState DkMetaDataT::checkExifOrientation() const {
 }
 
 int DkMetaDataT::getRating() const {
+
+	QMutexLocker locker(&mMutex);
 	
 	if (mExifState != loaded && mExifState != dirty)
 		return -1;
@@ -354,6 +529,8 @@ int DkMetaDataT::getRating() const {
 
 QSize DkMetaDataT::getImageSize() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QSize size;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -375,6 +552,8 @@ QSize DkMetaDataT::getImageSize() const {
 
 QString DkMetaDataT::getNativeExifValue(const QString& key) const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString info;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -416,6 +595,8 @@ QString DkMetaDataT::getNativeExifValue(const QString& key) const {
 
 QString DkMetaDataT::getXmpValue(const QString& key) const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString info;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -447,6 +628,8 @@ QString DkMetaDataT::getXmpValue(const QString& key) const {
 
 QString DkMetaDataT::getExifValue(const QString& key) const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString info;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -489,6 +672,8 @@ QString DkMetaDataT::getExifValue(const QString& key) const {
 
 QString DkMetaDataT::getIptcValue(const QString& key) const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString info;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -518,6 +703,8 @@ QString DkMetaDataT::getIptcValue(const QString& key) const {
 
 void DkMetaDataT::getFileMetaData(QStringList& fileKeys, QStringList& fileValues) const {
 
+	QMutexLocker locker(&mMutex);
+
 	QFileInfo fileInfo(mFilePath);
 	fileKeys.append(QObject::tr("Filename"));
 	fileValues.append(fileInfo.fileName());
@@ -596,6 +783,8 @@ void DkMetaDataT::getFileMetaData(QStringList& fileKeys, QStringList& fileValues
 
 void DkMetaDataT::getAllMetaData(QStringList& keys, QStringList& values) const {
 
+	QMutexLocker locker(&mMutex);
+
 	QStringList exifKeys = getExifKeys();
 
 	for (int idx = 0; idx < exifKeys.size(); idx++) {
@@ -640,6 +829,8 @@ void DkMetaDataT::getAllMetaData(QStringList& keys, QStringList& values) const {
 
 QImage DkMetaDataT::getThumbnail() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QImage qThumb;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -666,6 +857,8 @@ QImage DkMetaDataT::getThumbnail() const {
 
 QImage DkMetaDataT::getPreviewImage(int minPreviewWidth) const {
 
+	QMutexLocker locker(&mMutex);
+
 	QImage qImg;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -711,51 +904,69 @@ QImage DkMetaDataT::getPreviewImage(int minPreviewWidth) const {
 }
 
 void DkMetaDataT::setUseSidecar(bool useSidecar) {
+
+	QMutexLocker locker(&mMutex);
 	
 	mUseSidecar = useSidecar;
 }
 
 bool DkMetaDataT::useSidecar() const {
 
+	QMutexLocker locker(&mMutex);
+
 	return mUseSidecar;
 }
 
 
 bool DkMetaDataT::hasMetaData() const {
 
+	QMutexLocker locker(&mMutex);
+
 	return !(mExifState == no_data || mExifState == not_loaded);
 }
 
 bool DkMetaDataT::isLoaded() const {
 
+	QMutexLocker locker(&mMutex);
+
 	return mExifState == loaded || mExifState == dirty || mExifState == no_data;
 }
 
 bool DkMetaDataT::isTiff() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString newSuffix = QFileInfo(mFilePath).suffix();
 	return newSuffix.contains(QRegExp("(tif|tiff)", Qt::CaseInsensitive)) != 0;
 }
 
 bool DkMetaDataT::isJpg() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString newSuffix = QFileInfo(mFilePath).suffix();
 	return newSuffix.contains(QRegExp("(jpg|jpeg)", Qt::CaseInsensitive)) != 0;
 }
 
 bool DkMetaDataT::isRaw() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QString newSuffix = QFileInfo(mFilePath).suffix();
 	return newSuffix.contains(QRegExp("(nef|crw|cr2|arw)", Qt::CaseInsensitive)) != 0;
 }
 
 bool DkMetaDataT::isDirty() const {
 
+	QMutexLocker locker(&mMutex);
+
 	return mExifState == dirty;
 }
 
 QStringList DkMetaDataT::getExifKeys() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QStringList exifKeys;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -781,6 +992,8 @@ QStringList DkMetaDataT::getExifKeys() const {
 
 QStringList DkMetaDataT::getXmpKeys() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QStringList xmpKeys;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -807,6 +1020,8 @@ QStringList DkMetaDataT::getXmpKeys() const {
 
 QStringList DkMetaDataT::getIptcKeys() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QStringList iptcKeys;
 	
 	if (mExifState != loaded && mExifState != dirty)
@@ -829,6 +1044,8 @@ QStringList DkMetaDataT::getIptcKeys() const {
 
 QStringList DkMetaDataT::getExifValues() const {
 
+	QMutexLocker locker(&mMutex);
+
 	QStringList exifValues;
 
 	if (mExifState != loaded && mExifState != dirty)
@@ -851,6 +1068,8 @@ QStringList DkMetaDataT::getExifValues() const {
 }
 
 QStringList DkMetaDataT::getIptcValues() const {
+
+	QMutexLocker locker(&mMutex);
 	
 	QStringList iptcValues;
 
@@ -873,6 +1092,8 @@ QStringList DkMetaDataT::getIptcValues() const {
 
 void DkMetaDataT::setQtValues(const QImage& cImg) {
 
+	QMutexLocker locker(&mMutex);
+
 	QStringList qtKeysInit = cImg.textKeys();
 
 	for (QString cKey : qtKeysInit) {
@@ -890,6 +1111,8 @@ void DkMetaDataT::setQtValues(const QImage& cImg) {
 
 QString DkMetaDataT::getQtValue(const QString& key) const {
 
+	QMutexLocker locker(&mMutex);
+
 	int idx = mQtKeys.indexOf(key);
 
 	if (idx >= 0 && idx < mQtValues.size())
@@ -901,10 +1124,14 @@ QString DkMetaDataT::getQtValue(const QString& key) const {
 
 QStringList DkMetaDataT::getQtKeys() const {
 
+	QMutexLocker locker(&mMutex);
+
 	return mQtKeys;
 }
 
 QStringList DkMetaDataT::getQtValues() const {
+
+	QMutexLocker locker(&mMutex);
 	
 	return mQtValues;
 }
@@ -912,6 +1139,8 @@ QStringList DkMetaDataT::getQtValues() const {
 
 void DkMetaDataT::setThumbnail(QImage thumb) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState == not_loaded || mExifState == no_data) 
 		return;
 
@@ -946,6 +1175,7 @@ void DkMetaDataT::setThumbnail(QImage thumb) {
 
 		mExifImg->setExifData(exifData);
 		mExifState = dirty;
+		mRevision++;
 
 	} catch (...) {
 		qDebug() << "I could not save the thumbnail...";
@@ -954,6 +1184,8 @@ void DkMetaDataT::setThumbnail(QImage thumb) {
 
 QVector2D DkMetaDataT::getResolution() const {
 
+	QMutexLocker locker(&mMutex);
+
 
 	QVector2D resV = QVector2D(72,72);
 	QString xRes, yRes;
@@ -990,6 +1222,8 @@ QVector2D DkMetaDataT::getResolution() const {
 
 void DkMetaDataT::setResolution(const QVector2D& res) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (getResolution() == res)
 		return;
 
@@ -1005,6 +1239,8 @@ void DkMetaDataT::setResolution(const QVector2D& res) {
 
 void DkMetaDataT::clearOrientation() {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState == not_loaded || mExifState == no_data)
 		return;
 
@@ -1013,6 +1249,8 @@ void DkMetaDataT::clearOrientation() {
 
 void DkMetaDataT::setOrientation(int o) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState == not_loaded || mExifState == no_data)
 		return;
 
@@ -1073,10 +1311,13 @@ void DkMetaDataT::setOrientation(int o) {
 	mExifImg->setExifData(exifData);
 
 	mExifState = dirty;
+	mRevision++;
 }
 
 bool DkMetaDataT::setDescription(const QString& description) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState == not_loaded || mExifState == no_data)
 		return false;
 
@@ -1085,6 +1326,8 @@ bool DkMetaDataT::setDescription(const QString& description) {
 
 void DkMetaDataT::setRating(int r) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState == not_loaded || mExifState == no_data || getRating() == r)
 		return;
 
@@ -1134,6 +1377,7 @@ void DkMetaDataT::setRating(int r) {
 		mExifImg->setXmpData(xmpData);
 
 		mExifState = dirty;
+		mRevision++;
 	}
 	catch (...) {
 		qDebug() << "[WARNING] I could not set the exif data for this image format...";
@@ -1142,6 +1386,8 @@ void DkMetaDataT::setRating(int r) {
 
 bool DkMetaDataT::updateImageMetaData(const QImage& img) {
 
+	QMutexLocker locker(&mMutex);
+
 	bool success = true;
 
 	success &= setExifValue("Exif.Image.ImageWidth", QString::number(img.width()));
@@ -1161,6 +1407,8 @@ bool DkMetaDataT::updateImageMetaData(const QImage& img) {
 
 bool DkMetaDataT::setExifValue(QString key, QString taginfo) {
 
+	QMutexLocker locker(&mMutex);
+
 	bool setExifSuccessfull = false;
 
 	if (mExifState == not_loaded || mExifState == no_data)
@@ -1186,6 +1434,7 @@ bool DkMetaDataT::setExifValue(QString key, QString taginfo) {
 			//tag.setValue(&val);
 			if (!tag.setValue(taginfo.toStdString())) {
 				mExifState = dirty;
+				mRevision++;
 				setExifSuccessfull = true;
 			}
 		}
@@ -1195,6 +1444,7 @@ bool DkMetaDataT::setExifValue(QString key, QString taginfo) {
 			Exiv2::Exifdatum tag(exivKey);
 			if (!tag.setValue(taginfo.toStdString())) {
 				mExifState = dirty;
+				mRevision++;
 				setExifSuccessfull = true;
 			}
 
@@ -1225,6 +1475,8 @@ QString DkMetaDataT::exiv2ToQString(std::string exifString) {
 
 void DkMetaDataT::printMetaData() const {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState != loaded && mExifState != dirty)
 		return;
 
@@ -1271,6 +1523,8 @@ void DkMetaDataT::printMetaData() const {
 
 bool DkMetaDataT::saveRectToXMP(const DkRotatingRect& rect, const QSize& size) {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState != loaded && mExifState != dirty)
 		return false;
 
@@ -1298,6 +1552,7 @@ bool DkMetaDataT::saveRectToXMP(const DkRotatingRect& rect, const QSize& size) {
 	try {
 		mExifImg->setXmpData(xmpData);
 		mExifState = dirty;
+		mRevision++;
 
 		qInfo() << r << "written to XMP";
 
@@ -1311,6 +1566,8 @@ bool DkMetaDataT::saveRectToXMP(const DkRotatingRect& rect, const QSize& size) {
 
 bool DkMetaDataT::clearXMPRect() {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState != loaded && mExifState != dirty)
 		return false;
 
@@ -1318,12 +1575,15 @@ bool DkMetaDataT::clearXMPRect() {
 	setXMPValue(xmpData, "Xmp.crs.HasCrop", "False");
 	mExifImg->setXmpData(xmpData);
 	mExifState = dirty;
+	mRevision++;
 
 	return true;
 }
 
 DkRotatingRect DkMetaDataT::getXMPRect(const QSize& size) const {
 
+	QMutexLocker locker(&mMutex);
+
 	if (mExifState != loaded && mExifState != dirty)
 		return DkRotatingRect();
 
@@ -1350,16 +1610,14 @@ DkRotatingRect DkMetaDataT::getXMPRect(const QSize& size) const {
 
 Exiv2::Image::AutoPtr DkMetaDataT::loadSidecar(const QString& filePath) const {
 
+	QMutexLocker locker(&mMutex);
+
 	Exiv2::Image::AutoPtr xmpImg;
 
 	//TODO: check if the file type supports xmp
 
 	// Create the path to the XMP file:	
-	QString dir = filePath;
-	QString ext = QFileInfo(filePath).suffix();
-	QString xmpPath = dir.left(dir.length() - ext.length() - 1);
-	QString xmpExt = ".xmp";
-	QString xmpFilePath = xmpPath + xmpExt;
+	QString xmpFilePath = sidecarPath(filePath);
 
 	QFileInfo xmpFileInfo = QFileInfo(xmpFilePath);
 
@@ -1416,6 +1674,60 @@ bool DkMetaDataT::setXMPValue(Exiv2::XmpData& xmpData, QString xmpKey, QString x
 
 }
 
+// DkSharedMetaData --------------------------------------------------------------------
+DkSharedMetaData::DkSharedMetaData() {
+}
+
+/**
+ * Returns the metadata and parses the file if needed.
+ * Concurrent callers wait for the first one - so the file is parsed only once.
+ * @param filePath the image's file path.
+ * @param ba the file buffer (if it is loaded already).
+ * @return QSharedPointer<DkMetaDataT> the metadata.
+ **/ 
+QSharedPointer<DkMetaDataT> DkSharedMetaData::metaData(const QString& filePath, QSharedPointer<QByteArray> ba) {
+
+	QMutexLocker locker(&mMutex);
+
+	if (mMetaData)
+		return mMetaData;
+
+	DkTimer dt;
+	QSharedPointer<DkMetaDataT> metaData(new DkMetaDataT());
+
+	try {
+		metaData->readMetaData(filePath, ba);
+	}
+	catch (...) {}	// ignore if we cannot read the metadata
+
+	qDebug() << "[DkSharedMetaData]" << QFileInfo(filePath).fileName() << "parsed in" << dt;
+
+	mMetaData = metaData;
+
+	return mMetaData;
+}
+
+/**
+ * Returns the metadata if the file was parsed already.
+ * @return QSharedPointer<DkMetaDataT> the metadata or NULL (never reads the file).
+ **/ 
+QSharedPointer<DkMetaDataT> DkSharedMetaData::loadedMetaData() const {
+
+	QMutexLocker locker(&mMutex);
+	return mMetaData;
+}
+
+void DkSharedMetaData::invalidate() {
+
+	QMutexLocker locker(&mMutex);
+
+	// edits that were not queued yet must not get lost
+	if (mMetaData && mMetaData->isDirty())
+		return;
+
+	mMetaData.clear();
+}
+
 // DkMetaDataHelper --------------------------------------------------------------------
 void DkMetaDataHelper::init() {
 
@@ -31,6 +31,7 @@
 #include <QSharedPointer>
 #include <QStringList>
 #include <QMap>
+#include <QMutex>
 
 //code for metadata crop:
 #include "DkMath.h"
@@ -94,6 +95,13 @@ public:
 	void readMetaData(const QString& filePath, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
 	bool saveMetaData(const QString& filePath, bool force = false);
 	bool saveMetaData(QSharedPointer<QByteArray>& ba, bool force = false);
+	bool copyMetaData(Exiv2::ExifData& exifData, Exiv2::IptcData& iptcData, Exiv2::XmpData& xmpData) const;
+	void setSaved();
+	bool setSaved(int revision);
+	int revision() const;
+
+	static bool writeMetaData(const QString& filePath, const Exiv2::ExifData& exifData, const Exiv2::IptcData& iptcData, const Exiv2::XmpData& xmpData);
+	static bool writeSidecar(const QString& filePath, const Exiv2::ExifData& exifData, const Exiv2::IptcData& iptcData, const Exiv2::XmpData& xmpData);
 
 	int getOrientationDegree() const;
 	ExifOrientationState checkExifOrientation() const;
@@ -148,6 +156,9 @@ public:
 protected:
 	
 	Exiv2::Image::AutoPtr loadSidecar(const QString& filePath) const;
+	static Exiv2::Image::AutoPtr writeMetaData(QSharedPointer<QByteArray>& ba, const Exiv2::ExifData& exifData, const Exiv2::IptcData& iptcData, const Exiv2::XmpData& xmpData);
+	static bool writeBuffer(const QString& filePath, QSharedPointer<QByteArray> ba);
+	static QString sidecarPath(const QString& filePath);
 
 	enum {
 		not_loaded,
@@ -162,7 +173,31 @@ protected:
 	QStringList mQtValues;
 
 	int mExifState = not_loaded;
+	int mRevision = 0;
 	bool mUseSidecar = false;
+
+	// the metadata is shared by threads (see DkSharedMetaData) - every call holds the lock
+	mutable QMutex mMutex{QMutex::Recursive};
+};
+
+/**
+ * The metadata of one file - shared by its loader, previews, thumbnails and widgets.
+ * The file is parsed once (when it is first needed) until invalidate() is called
+ * (e.g. if the file was modified). Loading is thread-safe and DkMetaDataT locks
+ * every read & edit - so the loader can edit it while thumbnails read it.
+ **/ 
+class DllCoreExport DkSharedMetaData {
+
+public:
+	DkSharedMetaData();
+
+	QSharedPointer<DkMetaDataT> metaData(const QString& filePath, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+	QSharedPointer<DkMetaDataT> loadedMetaData() const;
+	void invalidate();
+
+protected:
+	QSharedPointer<DkMetaDataT> mMetaData;
+	mutable QMutex mMutex;
 };
 
 class DllCoreExport DkMetaDataHelper {
@@ -0,0 +1,449 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#include "DkMetaDataProbe.h"
+
+#pragma warning(push, 0)	// no warnings from includes - begin
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QDateTime>
+#include <QRegExp>
+#include <QVector>
+#include <QPair>
+#include <QDebug>
+
+#include <cstring>
+#include <cctype>
+#pragma warning(pop)	// no warnings from includes - end
+
+namespace nmc {
+
+static quint16 probeU16(const uchar* data, bool littleEndian) {
+
+	return littleEndian ? 
+		quint16(data[0] | (data[1] << 8)) : 
+		quint16((data[0] << 8) | data[1]);
+}
+
+static quint32 probeU32(const uchar* data, bool littleEndian) {
+
+	return littleEndian ? 
+		quint32(data[0] | (data[1] << 8) | (data[2] << 16) | (quint32(data[3]) << 24)) : 
+		quint32((quint32(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+}
+
+// DkMetaDataProbe --------------------------------------------------------------------
+DkMetaDataProbe::DkMetaDataProbe() {
+}
+
+/**
+ * Reads the header of an image.
+ * The file is mapped so that only the pages touched by the
+ * header are read from disk.
+ * @param filePath the image's file path.
+ * @param ba the file buffer (if the file is already loaded).
+ * @return bool true if a JPEG, PNG or TIFF header was found.
+ **/ 
+bool DkMetaDataProbe::probe(const QString& filePath, QSharedPointer<QByteArray> ba) {
+
+	mFilePath = filePath;
+	mBuffer = ba;
+	mOrientation = -1;
+	mExifRating = -1;
+	mXmpRating = -1;
+	mDateTimeOriginal.clear();
+	mSize = QSize();
+	mThumbOffset = -1;
+	mThumbLength = 0;
+	mValid = false;
+
+	QFile file;
+	QByteArray header;
+	const uchar* data = 0;
+	qint64 size = 0;
+
+	if (ba && !ba->isEmpty()) {
+		data = (const uchar*)ba->constData();
+		size = ba->size();
+	}
+	else {
+		file.setFileName(filePath);
+
+		if (!file.open(QIODevice::ReadOnly) || file.size() < 8)
+			return false;
+
+		size = file.size();
+		data = file.map(0, size);
+
+		// e.g. some network shares cannot be mapped
+		if (!data) {
+			header = file.read(max_header_size);
+			data = (const uchar*)header.constData();
+			size = header.size();
+		}
+	}
+
+	if (size < 8)
+		return false;
+
+	if (data[0] == 0xFF && data[1] == 0xD8)
+		mValid = parseJpg(data, size);
+	else if (std::memcmp(data, "\x89PNG\r\n\x1a\n", 8) == 0)
+		mValid = parsePng(data, size);
+	else
+		mValid = parseTiff(data, size, 0);
+
+	return mValid;	// the file gets unmapped when it is closed
+}
+
+bool DkMetaDataProbe::parseJpg(const uchar* data, qint64 size) {
+
+	qint64 pos = 2;
+	bool exifFound = false;
+
+	while (pos + 4 <= size) {
+
+		if (data[pos] != 0xFF)
+			break;
+
+		uchar marker = data[pos+1];
+
+		// fill bytes & markers without payload
+		if (marker == 0xFF) {
+			pos++;
+			continue;
+		}
+		if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+			pos += 2;
+			continue;
+		}
+
+		// start of scan - there are no headers after this marker
+		if (marker == 0xDA || marker == 0xD9)
+			break;
+
+		qint64 segLength = probeU16(data + pos + 2, false) - 2;
+		const uchar* seg = data + pos + 4;
+
+		if (segLength < 0 || pos + 4 + segLength > size)
+			break;
+
+		// APP1
+		if (marker == 0xE1) {
+
+			if (segLength > 6 && std::memcmp(seg, "Exif\0\0", 6) == 0 && !exifFound)
+				exifFound = parseTiff(seg + 6, segLength - 6, pos + 4 + 6);
+			else if (segLength > 29 && std::memcmp(seg, "http://ns.adobe.com/xap/1.0/\0", 29) == 0)
+				parseXmp((const char*)seg + 29, segLength - 29);
+		}
+		// SOFn (C4, C8 and CC are DHT, JPG & DAC)
+		else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC && segLength >= 5) {
+			mSize = QSize(probeU16(seg + 3, false), probeU16(seg + 1, false));
+		}
+
+		pos += 4 + segLength;
+	}
+
+	return true;
+}
+
+bool DkMetaDataProbe::parsePng(const uchar* data, qint64 size) {
+
+	qint64 pos = 8;
+
+	while (pos + 12 <= size) {
+
+		qint64 length = probeU32(data + pos, false);
+		const uchar* type = data + pos + 4;
+		const uchar* chunk = data + pos + 8;
+
+		if (pos + 12 + length > size)
+			break;
+
+		if (std::memcmp(type, "IHDR", 4) == 0 && length >= 8)
+			mSize = QSize(probeU32(chunk, false), probeU32(chunk + 4, false));
+		else if (std::memcmp(type, "eXIf", 4) == 0)
+			parseTiff(chunk, length, pos + 8);
+		else if (std::memcmp(type, "iTXt", 4) == 0 && length > 19 &&
+			std::memcmp(chunk, "XML:com.adobe.xmp\0", 18) == 0 && chunk[18] == 0)	// uncompressed XMP only
+			parseXmp((const char*)chunk + 18, length - 18);
+		else if (std::memcmp(type, "IDAT", 4) == 0 || std::memcmp(type, "IEND", 4) == 0)
+			break;	// metadata must be stored before the image data
+
+		pos += 12 + length;
+	}
+
+	return mSize.isValid();
+}
+
+/**
+ * Parses a TIFF structure (TIFF/DNG/RAW files or an EXIF block).
+ * IFD0 (orientation, rating, size), the EXIF IFD (date), 
+ * the SubIFDs (RAW/DNG size) and IFD1 (thumbnail) are read.
+ * @param data pointer to the TIFF header.
+ * @param size the number of bytes available.
+ * @param fileOffset the TIFF header's offset within the file.
+ * @return bool true if the TIFF header is valid.
+ **/ 
+bool DkMetaDataProbe::parseTiff(const uchar* data, qint64 size, qint64 fileOffset) {
+
+	if (size < 8)
+		return false;
+
+	bool le = false;
+
+	if (data[0] == 'I' && data[1] == 'I')
+		le = true;
+	else if (data[0] != 'M' || data[1] != 'M')
+		return false;
+
+	// 42: TIFF, 0x4F52 & 0x5352: ORF, 0x55: RW2
+	quint16 magic = probeU16(data + 2, le);
+	if (magic != 42 && magic != 0x4F52 && magic != 0x5352 && magic != 0x55)
+		return false;
+
+	enum {
+		ifd_0,
+		ifd_1,
+		ifd_exif,
+		ifd_sub,
+	};
+
+	QVector<QPair<qint64, int> > ifds;
+	ifds << qMakePair((qint64)probeU32(data + 4, le), (int)ifd_0);
+
+	QSize imgSize;
+	QSize exifSize;
+
+	for (int idx = 0; idx < ifds.size() && idx < max_ifds; idx++) {
+
+		qint64 offset = ifds[idx].first;
+		int kind = ifds[idx].second;
+
+		if (offset < 8 || offset + 2 > size)
+			continue;
+
+		int numEntries = probeU16(data + offset, le);
+
+		if (numEntries > max_ifd_entries)
+			continue;
+
+		QSize ifdSize;
+		bool reducedImage = false;
+		qint64 jpgOffset = 0;
+		qint64 jpgLength = 0;
+
+		for (int eIdx = 0; eIdx < numEntries; eIdx++) {
+
+			qint64 e = offset + 2 + eIdx * 12;
+
+			if (e + 12 > size)
+				break;
+
+			quint16 tag = probeU16(data + e, le);
+			quint16 type = probeU16(data + e + 2, le);
+			qint64 count = probeU32(data + e + 4, le);
+			qint64 value = type == 3 ? probeU16(data + e + 8, le) : probeU32(data + e + 8, le);	// SHORT or LONG/offset
+
+			switch (tag) {
+			case 0x00FE:	reducedImage = (value & 1) != 0; break;		// NewSubfileType
+			case 0x0100:	ifdSize.setWidth((int)value); break;		// ImageWidth
+			case 0x0101:	ifdSize.setHeight((int)value); break;		// ImageLength
+			case 0x0201:	jpgOffset = value; break;					// JPEGInterchangeFormat
+			case 0x0202:	jpgLength = value; break;					// JPEGInterchangeFormatLength
+			case 0xA002:	exifSize.setWidth((int)value); break;		// PixelXDimension
+			case 0xA003:	exifSize.setHeight((int)value); break;		// PixelYDimension
+			case 0x0112:												// Orientation
+				if (kind == ifd_0) 
+					mOrientation = (int)value; 
+				break;
+			case 0x4746:												// Rating
+				if (kind == ifd_0) 
+					mExifRating = (int)value; 
+				break;
+			case 0x8769:												// ExifIFD
+				if (kind == ifd_0)
+					ifds << qMakePair(value, (int)ifd_exif);
+				break;
+			case 0x014A:												// SubIFDs
+				if (count == 1)
+					ifds << qMakePair(value, (int)ifd_sub);
+				else if (count > 1 && value + count * 4 <= size) {
+					for (int sIdx = 0; sIdx < count && ifds.size() < max_ifds; sIdx++)
+						ifds << qMakePair((qint64)probeU32(data + value + sIdx * 4, le), (int)ifd_sub);
+				}
+				break;
+			case 0x02BC:												// XMP
+				if (count > 4 && value + count <= size)
+					parseXmp((const char*)data + value, count);
+				break;
+			case 0x9003:												// DateTimeOriginal
+				if (kind == ifd_exif && count > 4 && value + count <= size)
+					mDateTimeOriginal = QString::fromLatin1((const char*)data + value, (int)qstrnlen((const char*)data + value, (uint)count));
+				break;
+			}
+		}
+
+		// IFD0 links to IFD1 which holds the EXIF thumbnail
+		if (kind == ifd_0 && offset + 2 + numEntries * 12 + 4 <= size)
+			ifds << qMakePair((qint64)probeU32(data + offset + 2 + numEntries * 12, le), (int)ifd_1);
+
+		if (kind == ifd_1 && jpgOffset > 0 && jpgLength > 0 && jpgOffset + jpgLength <= size) {
+			mThumbOffset = fileOffset + jpgOffset;
+			mThumbLength = jpgLength;
+		}
+
+		// the largest full resolution image (DNGs store a thumbnail in IFD0)
+		if ((kind == ifd_0 || kind == ifd_sub) && !reducedImage && ifdSize.isValid() &&
+			(!imgSize.isValid() || ifdSize.width() * (qint64)ifdSize.height() > imgSize.width() * (qint64)imgSize.height()))
+			imgSize = ifdSize;
+	}
+
+	if (!mSize.isValid())
+		mSize = imgSize.isValid() ? imgSize : exifSize;
+
+	return true;
+}
+
+void DkMetaDataProbe::parseXmp(const char* data, qint64 size) {
+
+	QByteArray xmp = QByteArray::fromRawData(data, (int)size);
+	int idx = xmp.indexOf("xmp:Rating");
+
+	if (idx == -1)
+		return;
+
+	// attribute (xmp:Rating="3") or element (<xmp:Rating>3</xmp:Rating>)
+	idx += 10;
+	while (idx < xmp.size() && (xmp.at(idx) == '=' || xmp.at(idx) == '"' || xmp.at(idx) == '\'' || xmp.at(idx) == '>'))
+		idx++;
+
+	int end = idx;
+	while (end < xmp.size() && (isdigit(xmp.at(end)) || xmp.at(end) == '-' || xmp.at(end) == '.'))
+		end++;
+
+	bool ok = false;
+	float rating = xmp.mid(idx, end - idx).toFloat(&ok);
+
+	if (ok)
+		mXmpRating = qRound(rating);
+}
+
+bool DkMetaDataProbe::isValid() const {
+	return mValid;
+}
+
+bool DkMetaDataProbe::isJpg() const {
+
+	QString newSuffix = QFileInfo(mFilePath).suffix();
+	return newSuffix.contains(QRegExp("(jpg|jpeg)", Qt::CaseInsensitive)) != 0;
+}
+
+bool DkMetaDataProbe::isRaw() const {
+
+	QString newSuffix = QFileInfo(mFilePath).suffix();
+	return newSuffix.contains(QRegExp("(nef|crw|cr2|arw)", Qt::CaseInsensitive)) != 0;
+}
+
+/**
+ * Returns the orientation in degrees (see DkMetaDataT::getOrientationDegree).
+ * @return int 0 if no orientation is set, -1 if the orientation is illegal.
+ **/ 
+int DkMetaDataProbe::getOrientationDegree() const {
+
+	switch (mOrientation) {
+	case -1:	return 0;	// not set
+	case 6:		return 90;
+	case 7:		return 90;
+	case 3:		return 180;
+	case 4:		return 180;
+	case 8:		return -90;
+	case 5:		return -90;
+	case 1:		return 0;
+	default:	return -1;
+	}
+}
+
+/**
+ * Returns the rating. EXIF ratings are preferred to XMP ratings (see DkMetaDataT::getRating).
+ * @return int the rating or -1 if no rating is set.
+ **/ 
+int DkMetaDataProbe::getRating() const {
+
+	return mExifRating != -1 ? mExifRating : mXmpRating;
+}
+
+QString DkMetaDataProbe::getDateTimeOriginal() const {
+	return mDateTimeOriginal;
+}
+
+QDateTime DkMetaDataProbe::getDateTimeOriginalDate() const {
+	return QDateTime::fromString(mDateTimeOriginal, "yyyy:MM:dd hh:mm:ss");
+}
+
+QSize DkMetaDataProbe::getImageSize() const {
+	return mSize;
+}
+
+qint64 DkMetaDataProbe::thumbnailOffset() const {
+	return mThumbOffset;
+}
+
+qint64 DkMetaDataProbe::thumbnailLength() const {
+	return mThumbLength;
+}
+
+/**
+ * Loads the EXIF thumbnail.
+ * Only the thumbnail's bytes are read.
+ * @return QImage the thumbnail or a null image.
+ **/ 
+QImage DkMetaDataProbe::getThumbnail() const {
+
+	if (mThumbOffset < 0 || mThumbLength <= 0)
+		return QImage();
+
+	QByteArray ba;
+
+	if (mBuffer && !mBuffer->isEmpty())
+		ba = mBuffer->mid((int)mThumbOffset, (int)mThumbLength);
+	else {
+		QFile file(mFilePath);
+
+		if (file.open(QIODevice::ReadOnly) && file.seek(mThumbOffset))
+			ba = file.read(mThumbLength);
+	}
+
+	QImage thumb;
+	thumb.loadFromData(ba);
+
+	return thumb;
+}
+
+}
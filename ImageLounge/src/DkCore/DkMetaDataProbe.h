@@ -0,0 +1,108 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QString>
+#include <QSize>
+#include <QSharedPointer>
+#include <QByteArray>
+#pragma warning(pop)
+
+#pragma warning(disable: 4251)	// TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+class QImage;
+class QDateTime;
+
+namespace nmc {
+
+/**
+ * Reads the few metadata fields needed for thumbnails, sorting and
+ * the file info directly from the file header (JPEG APP1, TIFF/DNG IFD0
+ * or the PNG eXIf chunk). No Exiv2 objects are created - use DkMetaDataT
+ * if you need the full EXIF/IPTC/XMP tree or want to write metadata.
+ **/ 
+class DllCoreExport DkMetaDataProbe {
+
+public:
+	DkMetaDataProbe();
+
+	enum {
+		max_header_size = 256*1024,	// read if the file cannot be mapped
+		max_ifds = 8,
+		max_ifd_entries = 1000,
+	};
+
+	bool probe(const QString& filePath, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+
+	bool isValid() const;
+	bool isJpg() const;
+	bool isRaw() const;
+
+	int getOrientationDegree() const;
+	int getRating() const;
+	QString getDateTimeOriginal() const;
+	QDateTime getDateTimeOriginalDate() const;
+	QSize getImageSize() const;
+
+	qint64 thumbnailOffset() const;
+	qint64 thumbnailLength() const;
+	QImage getThumbnail() const;
+
+protected:
+	bool parseJpg(const uchar* data, qint64 size);
+	bool parsePng(const uchar* data, qint64 size);
+	bool parseTiff(const uchar* data, qint64 size, qint64 fileOffset);
+	void parseXmp(const char* data, qint64 size);
+
+	QString mFilePath;
+	QSharedPointer<QByteArray> mBuffer;
+
+	int mOrientation = -1;	// the raw EXIF value
+	int mExifRating = -1;
+	int mXmpRating = -1;
+	QString mDateTimeOriginal;
+	QSize mSize;
+	qint64 mThumbOffset = -1;
+	qint64 mThumbLength = 0;
+	bool mValid = false;
+};
+
+}
@@ -0,0 +1,271 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#include "DkMetaDataWriter.h"
+#include "DkTimer.h"
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QThreadPool>
+#include <QRunnable>
+#include <QTimer>
+#include <QFileInfo>
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QDebug>
+#pragma warning(pop)
+
+#include <functional>
+
+namespace nmc {
+
+// DkMetaDataWriterRunnable --------------------------------------------------------------------
+class DkMetaDataWriterRunnable : public QRunnable {
+
+public:
+	DkMetaDataWriterRunnable(const std::function<void()>& fn) : mFn(fn) {}
+
+	void run() override {
+		mFn();
+	}
+
+private:
+	std::function<void()> mFn;
+};
+
+// DkMetaDataWriter --------------------------------------------------------------------
+DkMetaDataWriter::DkMetaDataWriter() {
+
+	// the timer needs an event loop - metadata might be queued from loader threads
+	if (QCoreApplication::instance())
+		moveToThread(QCoreApplication::instance()->thread());
+
+	mPool = new QThreadPool();
+	mPool->setMaxThreadCount(max_threads);
+
+	mTimer = new QTimer(this);
+	mTimer->setSingleShot(true);
+	mTimer->setInterval(write_delay);
+	connect(mTimer, SIGNAL(timeout()), this, SLOT(startWrites()));
+}
+
+DkMetaDataWriter& DkMetaDataWriter::instance() {
+
+	static DkMetaDataWriter inst;
+	return inst;
+}
+
+/**
+ * Queues the metadata of a file if it was edited.
+ * The metadata is copied and marked as saved once it is written.
+ * If the file is already queued, the new edits replace the queued ones.
+ * @param filePath the image's file path.
+ * @param metaData the (edited) metadata.
+ * @return bool true if the metadata was queued.
+ **/ 
+bool DkMetaDataWriter::enqueue(const QString& filePath, QSharedPointer<DkMetaDataT> metaData) {
+
+	if (!metaData || !metaData->isDirty() || filePath.isEmpty())
+		return false;
+
+	Job job;
+	job.filePath = filePath;
+	job.sidecar = metaData->useSidecar();
+	job.metaData = metaData;
+	job.revision = metaData->revision();
+
+	try {
+		if (!metaData->copyMetaData(job.exifData, job.iptcData, job.xmpData))
+			return false;
+	}
+	catch (...) {
+		qWarning() << "[DkMetaDataWriter] could not copy metadata of" << filePath;
+		return false;
+	}
+
+	int pending = 0;
+	{
+		QMutexLocker locker(&mMutex);
+
+		if (!mPending.contains(filePath))
+			mQueue << filePath;
+		mPending.insert(filePath, job);
+
+		pending = mPending.size() + mRunning.size();
+	}
+
+	emit pendingSignal(pending);
+	QMetaObject::invokeMethod(this, "startDelay", Qt::QueuedConnection);
+
+	return true;
+}
+
+/**
+ * Writes the queued edits of a file now.
+ * Call this before reading a file - it blocks until the file is written.
+ * @param filePath the image's file path.
+ **/ 
+void DkMetaDataWriter::write(const QString& filePath) {
+
+	QMutexLocker locker(&mMutex);
+
+	while (mRunning.contains(filePath))
+		mFinished.wait(&mMutex);
+
+	if (!mPending.contains(filePath))
+		return;
+
+	Job job = mPending.take(filePath);
+	mQueue.removeAll(filePath);
+	mRunning.insert(filePath);
+	locker.unlock();
+
+	run(job);
+}
+
+/**
+ * Writes all queued edits and waits until all writes are finished.
+ **/ 
+void DkMetaDataWriter::flush() {
+
+	DkTimer dt;
+	QStringList queue;
+	{
+		QMutexLocker locker(&mMutex);
+		queue = mQueue;
+	}
+
+	for (int idx = 0; idx < queue.size(); idx++)
+		write(queue[idx]);
+
+	QMutexLocker locker(&mMutex);
+	while (!mRunning.isEmpty())
+		mFinished.wait(&mMutex);
+
+	if (!queue.isEmpty())
+		qInfo() << "[DkMetaDataWriter]" << queue.size() << "files flushed in" << dt;
+}
+
+int DkMetaDataWriter::numPending() const {
+
+	QMutexLocker locker(&mMutex);
+	return mPending.size() + mRunning.size();
+}
+
+bool DkMetaDataWriter::isPending(const QString& filePath) const {
+
+	QMutexLocker locker(&mMutex);
+	return mPending.contains(filePath) || mRunning.contains(filePath);
+}
+
+void DkMetaDataWriter::startDelay() {
+
+	// edits within the delay are merged
+	if (!mTimer->isActive())
+		mTimer->start();
+}
+
+void DkMetaDataWriter::startWrites() {
+
+	QMutexLocker locker(&mMutex);
+
+	// files that are currently written are started once they are done
+	for (int idx = 0; idx < mQueue.size(); ) {
+
+		QString filePath = mQueue[idx];
+
+		if (mRunning.contains(filePath)) {
+			idx++;
+			continue;
+		}
+
+		Job job = mPending.take(filePath);
+		mQueue.removeAt(idx);
+		mRunning.insert(filePath);
+
+		mPool->start(new DkMetaDataWriterRunnable([this, job]() { run(job); }));
+	}
+}
+
+void DkMetaDataWriter::run(const Job& job) {
+
+	bool saved = writeJob(job);
+	bool requeue = false;
+	int pending = 0;
+
+	// edits after the copy keep the metadata dirty - failed writes too
+	QSharedPointer<DkMetaDataT> metaData = job.metaData.toStrongRef();
+	if (saved && metaData)
+		metaData->setSaved(job.revision);
+
+	{
+		QMutexLocker locker(&mMutex);
+		mRunning.remove(job.filePath);
+		requeue = mPending.contains(job.filePath);
+		pending = mPending.size() + mRunning.size();
+		mFinished.wakeAll();
+	}
+
+	emit metaDataSavedSignal(job.filePath, saved);
+	emit pendingSignal(pending);
+
+	// the file was edited while we were writing it
+	if (requeue)
+		QMetaObject::invokeMethod(this, "startDelay", Qt::QueuedConnection);
+}
+
+bool DkMetaDataWriter::writeJob(const Job& job) {
+
+	DkTimer dt;
+	bool saved = false;
+
+	try {
+		if (!job.sidecar)
+			saved = DkMetaDataT::writeMetaData(job.filePath, job.exifData, job.iptcData, job.xmpData);
+
+		// e.g. formats that Exiv2 cannot write
+		if (!saved && QFileInfo(job.filePath).exists()) {
+			saved = DkMetaDataT::writeSidecar(job.filePath, job.exifData, job.iptcData, job.xmpData);
+
+			if (saved && !job.sidecar)
+				qInfo() << "[DkMetaDataWriter]" << QFileInfo(job.filePath).fileName() << "could not be written - metadata saved to its sidecar";
+		}
+	}
+	catch (...) {
+		qWarning() << "[DkMetaDataWriter] exception caught while writing" << job.filePath;
+		saved = false;
+	}
+
+	if (saved)
+		qDebug() << "[DkMetaDataWriter]" << QFileInfo(job.filePath).fileName() << "written in" << dt;
+	else
+		qWarning() << "[DkMetaDataWriter] could not save metadata of" << job.filePath;
+
+	return saved;
+}
+
+}
@@ -0,0 +1,125 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QSharedPointer>
+#pragma warning(pop)
+
+#include "DkMetaData.h"
+
+#pragma warning(disable: 4251)	// TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+class QThreadPool;
+class QTimer;
+
+namespace nmc {
+
+/**
+ * Write-behind queue for metadata edits (ratings, descriptions, crop rects).
+ * Edits are copied when they are queued and written after a short delay,
+ * so that repeated edits of the same file are merged into a single write.
+ * The metadata stays dirty until it is written - failed writes are
+ * retried with the next enqueue().
+ * Files are written in place (or to their XMP sidecar) by a small 
+ * thread pool - slow drives never block the UI.
+ * Call flush() before exiting so that no edits get lost.
+ **/ 
+class DllCoreExport DkMetaDataWriter : public QObject {
+	Q_OBJECT
+
+public:
+	static DkMetaDataWriter& instance();
+
+	enum {
+		max_threads = 2,
+		write_delay = 1000,	// ms
+	};
+
+	bool enqueue(const QString& filePath, QSharedPointer<DkMetaDataT> metaData);
+	void write(const QString& filePath);
+	void flush();
+
+	int numPending() const;
+	bool isPending(const QString& filePath) const;
+
+signals:
+	void pendingSignal(int numPending) const;
+	void metaDataSavedSignal(const QString& filePath, bool saved) const;
+
+protected slots:
+	void startDelay();
+	void startWrites();
+
+protected:
+	DkMetaDataWriter();
+	DkMetaDataWriter(const DkMetaDataWriter&);
+
+	struct Job {
+		QString filePath;
+		Exiv2::ExifData exifData;
+		Exiv2::IptcData iptcData;
+		Exiv2::XmpData xmpData;
+		bool sidecar = false;
+		QWeakPointer<DkMetaDataT> metaData;	// marked as saved once it is written
+		int revision = 0;
+	};
+
+	void run(const Job& job);
+	static bool writeJob(const Job& job);
+
+	QThreadPool* mPool = 0;
+	QTimer* mTimer = 0;
+
+	mutable QMutex mMutex;
+	QWaitCondition mFinished;
+	QHash<QString, Job> mPending;	// one (merged) job per file
+	QStringList mQueue;				// FIFO of mPending's keys
+	QSet<QString> mRunning;
+};
+
+}
@@ -28,23 +28,25 @@
 #include "DkProcess.h"
 #include "DkUtils.h"
 #include "DkImageContainer.h"
+#include "DkBasicLoader.h"
 #include "DkImageStorage.h"
 #include "DkPluginManager.h"
 #include "DkSettings.h"
 #include "DkMath.h"
 #include "DkManipulators.h"
 #include "DkTimer.h"
+#include "DkScheduler.h"
 
 #include "DkMetaData.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QFuture>
 #include <QFutureWatcher>
-#include <QtConcurrentMap>
 #include <QWidget>
 #pragma warning(pop)		// no warnings from includes - end
 
 #include <cassert>
+#include <limits>
 
 namespace nmc {
 
@@ -233,6 +235,40 @@ bool DkBatchTransform::isActive() const {
 	return mAngle != 0 || mCropFromMetadata || cropFromRectangle() || isResizeActive();
 }
 
+/**
+ * Returns the minimal image size needed to compute the resize.
+ * If the loader knows this size in advance, it can decode
+ * JPEGs at a reduced resolution (which is much faster).
+ * @param mode the aspect ratio mode the size refers to
+ * @return QSize the size needed or an invalid size if the full resolution is needed
+ **/ 
+QSize DkBatchTransform::minDecodeSize(Qt::AspectRatioMode& mode) const {
+
+	// crop rectangles refer to the full resolution
+	if (!isResizeActive() || mCropFromMetadata || cropFromRectangle())
+		return QSize();
+
+	if (mResizeMode == resize_mode_default || mResizeProperty == resize_prop_increase_only)
+		return QSize();
+
+	int s = qRound(mResizeScaleFactor);
+	mode = Qt::KeepAspectRatio;
+
+	switch (mResizeMode) {
+	case resize_mode_long_side:
+		return QSize(s, s);
+	case resize_mode_short_side:
+		mode = Qt::KeepAspectRatioByExpanding;
+		return QSize(s, s);
+	case resize_mode_width:
+		return QSize(s, std::numeric_limits<int>::max());
+	case resize_mode_height:
+		return QSize(std::numeric_limits<int>::max(), s);
+	default:
+		return QSize();
+	}
+}
+
 int DkBatchTransform::angle() const {
 	return mAngle;
 }
@@ -767,6 +803,15 @@ bool DkBatchProcess::process() {
 
 	QSharedPointer<DkImageContainer> imgC(new DkImageContainer(mSaveInfo.inputFilePath()));
 
+	// if we resize first, we do not need to decode the full resolution
+	if (!mProcessFunctions.empty()) {
+		Qt::AspectRatioMode mode = Qt::KeepAspectRatio;
+		QSize minSize = mProcessFunctions.first()->minDecodeSize(mode);
+
+		if (minSize.isValid())
+			imgC->getLoader()->setMinSize(minSize, mode);
+	}
+
 	if (!imgC->loadImage() || imgC->image().isNull()) {
 		mLogStrings.append(QObject::tr("Error while loading..."));
 		mFailure++;
@@ -1114,7 +1159,10 @@ void DkBatchProcessing::compute() {
 	if (mBatchWatcher.isRunning())
 		mBatchWatcher.waitForFinished();
 
-	QFuture<void> future = QtConcurrent::map(mBatchItems, &nmc::DkBatchProcessing::computeItem);
+	QFuture<void> future = DkDecodeScheduler::instance().map<DkBatchProcess>(
+		DkDecodeScheduler::priority_batch, 
+		mBatchItems, 
+		[](DkBatchProcess& item) { computeItem(item); });
 	mBatchWatcher.setFuture(future);
 }
 
@@ -80,6 +80,7 @@ public:
 	virtual bool compute(QImage&, QStringList&) const { return true; };
 	virtual bool isActive() const { return false; };
 	virtual void postLoad(const QVector<QSharedPointer<DkBatchInfo> >&) const {};
+	virtual QSize minDecodeSize(Qt::AspectRatioMode&) const { return QSize(); };
 
 	virtual QString name() const {return "Abstract Batch";};
 	QString settingsName() const;
@@ -190,6 +191,7 @@ public:
 	virtual bool compute(QSharedPointer<DkImageContainer> container, QStringList& logStrings) const override;
 	virtual QString name() const override;
 	virtual bool isActive() const override;
+	virtual QSize minDecodeSize(Qt::AspectRatioMode& mode) const override;
 
 	int angle() const;
 	bool cropMetatdata() const;
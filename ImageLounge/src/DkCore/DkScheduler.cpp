@@ -0,0 +1,240 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#include "DkScheduler.h"
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QThreadPool>
+#include <QThread>
+#include <QRunnable>
+#include <QMutexLocker>
+#pragma warning(pop)
+
+namespace nmc {
+
+// DkSchedulerRunnable --------------------------------------------------------------------
+class DkSchedulerRunnable : public QRunnable {
+
+public:
+	DkSchedulerRunnable(const std::function<void()>& fn, int priority) : mFn(fn), mPriority(priority) {}
+
+	void run() override {
+		mFn();
+		DkDecodeScheduler::instance().taskFinished(mPriority);
+	}
+
+private:
+	std::function<void()> mFn;
+	int mPriority;
+};
+
+// DkDecodeScheduler --------------------------------------------------------------------
+DkDecodeScheduler::DkDecodeScheduler() {
+
+	mPool = new QThreadPool();
+
+	mQueues.resize(priority_end);
+	mNumRunning.fill(0, priority_end);
+	mMaxThreads.fill(1, priority_end);
+
+	// the global pool is configured by the settings (numThreads)
+	setNumThreads(QThreadPool::globalInstance()->maxThreadCount());
+}
+
+DkDecodeScheduler& DkDecodeScheduler::instance() {
+
+	static DkDecodeScheduler inst;
+	return inst;
+}
+
+/**
+ * Returns a new id for tasks' owners.
+ * Ids are used instead of addresses since an address can be reused
+ * by another object while tasks of a deleted owner are queued.
+ * @return int a unique owner id (> 0)
+ **/ 
+int DkDecodeScheduler::newOwnerId() {
+
+	static QAtomicInt lastId(0);
+	return lastId.fetchAndAddOrdered(1) + 1;
+}
+
+/**
+ * Moves all queued tasks of owner to another priority class.
+ * The tasks are put in front of the class' queue. Running tasks are not affected.
+ * @param owner the tasks' owner
+ * @param priority the new priority class
+ **/ 
+void DkDecodeScheduler::reprioritize(int owner, int priority) {
+
+	if (owner <= 0 || priority < 0 || priority >= priority_end)
+		return;
+
+	QMutexLocker locker(&mMutex);
+	
+	QList<Task> tasks;
+
+	for (int pIdx = 0; pIdx < priority_end; pIdx++) {
+
+		if (pIdx == priority)
+			continue;
+
+		QList<Task>& q = mQueues[pIdx];
+		for (int idx = 0; idx < q.size();) {
+			if (q[idx].owner == owner)
+				tasks << q.takeAt(idx);
+			else
+				idx++;
+		}
+	}
+
+	if (tasks.isEmpty())
+		return;
+
+	mQueues[priority] = tasks + mQueues[priority];
+	schedule();
+}
+
+/**
+ * Removes all queued tasks of a priority class.
+ * The futures of these tasks are canceled.
+ * @param priority the priority class
+ **/ 
+void DkDecodeScheduler::clear(int priority) {
+
+	if (priority < 0 || priority >= priority_end)
+		return;
+
+	QList<Task> tasks;
+	
+	{
+		QMutexLocker locker(&mMutex);
+		tasks.swap(mQueues[priority]);
+	}
+
+	// finish the futures without holding the lock
+	for (const Task& t : tasks)
+		t.drop();
+}
+
+/**
+ * Sets the number of threads and resets the limits of all priority classes.
+ * @param numThreads the number of decoding threads
+ **/ 
+void DkDecodeScheduler::setNumThreads(int numThreads) {
+
+	int nt = qMax(numThreads, 2);
+
+	QMutexLocker locker(&mMutex);
+	mPool->setMaxThreadCount(nt);
+	mMaxThreads.fill(nt, priority_end);
+
+	// background work always leaves threads for the image shown (see schedule())
+	mMaxThreads[priority_prefetch] = qMax(nt / 2, 1);
+	mMaxThreads[priority_thumbnail] = qMax(nt - 2, 1);
+	mMaxThreads[priority_batch] = qMax(nt - 1, 1);
+
+	schedule();
+}
+
+void DkDecodeScheduler::setMaxThreads(int priority, int maxThreads) {
+
+	if (priority < 0 || priority >= priority_end)
+		return;
+
+	QMutexLocker locker(&mMutex);
+	mMaxThreads[priority] = qMax(maxThreads, 1);
+	schedule();
+}
+
+int DkDecodeScheduler::maxThreads(int priority) const {
+
+	if (priority < 0 || priority >= priority_end)
+		return 0;
+
+	QMutexLocker locker(&mMutex);
+	return mMaxThreads[priority];
+}
+
+void DkDecodeScheduler::enqueue(int priority, int owner, const std::function<void()>& run, const std::function<void()>& drop) {
+
+	priority = qBound(0, priority, priority_end - 1);
+
+	Task t;
+	t.owner = owner;
+	t.run = run;
+	t.drop = drop;
+
+	QMutexLocker locker(&mMutex);
+	mQueues[priority] << t;
+	schedule();
+}
+
+// needs the lock
+void DkDecodeScheduler::schedule() {
+
+	while (mNumRunningTotal < mPool->maxThreadCount()) {
+
+		// background classes together leave one thread for the current image & display updates
+		bool backgroundFull = mNumRunningBackground >= mPool->maxThreadCount() - 1;
+
+		// find the most important task that does not exceed its class' limit
+		int priority = 0;
+		for (; priority < priority_end; priority++) {
+
+			if (priority >= priority_prefetch && backgroundFull)
+				continue;
+
+			if (!mQueues[priority].isEmpty() && mNumRunning[priority] < mMaxThreads[priority])
+				break;
+		}
+
+		if (priority == priority_end)
+			break;
+
+		Task t = mQueues[priority].takeFirst();
+		mNumRunning[priority]++;
+		mNumRunningTotal++;
+		if (priority >= priority_prefetch)
+			mNumRunningBackground++;
+
+		mPool->start(new DkSchedulerRunnable(t.run, priority));
+	}
+}
+
+void DkDecodeScheduler::taskFinished(int priority) {
+
+	QMutexLocker locker(&mMutex);
+	mNumRunning[priority]--;
+	mNumRunningTotal--;
+	if (priority >= priority_prefetch)
+		mNumRunningBackground--;
+	schedule();
+}
+
+}
@@ -0,0 +1,216 @@
+/*******************************************************************************************************
+ nomacs is a fast and small image viewer with the capability of synchronizing multiple instances
+ 
+ Copyright (C) 2011-2016 Markus Diem <markus@nomacs.org>
+ Copyright (C) 2011-2016 Stefan Fiel <stefan@nomacs.org>
+ Copyright (C) 2011-2016 Florian Kleber <florian@nomacs.org>
+
+ This file is part of nomacs.
+
+ nomacs is free software: you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation, either version 3 of the License, or
+ (at your option) any later version.
+
+ nomacs is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ related links:
+ [1] https://nomacs.org/
+ [2] https://github.com/nomacs/
+ [3] http://download.nomacs.org
+ *******************************************************************************************************/
+
+#pragma once
+
+#pragma warning(push, 0)	// no warnings from includes
+#include <QFuture>
+#include <QFutureInterface>
+#include <QSharedPointer>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QDebug>
+#include <QVector>
+#include <QList>
+#pragma warning(pop)
+
+#include <functional>
+
+#pragma warning(disable: 4251)	// TODO: remove
+
+#ifndef DllCoreExport
+#ifdef DK_CORE_DLL_EXPORT
+#define DllCoreExport Q_DECL_EXPORT
+#elif DK_DLL_IMPORT
+#define DllCoreExport Q_DECL_IMPORT
+#else
+#define DllCoreExport Q_DECL_IMPORT
+#endif
+#endif
+
+// Qt defines
+class QThreadPool;
+
+namespace nmc {
+
+/**
+ * Shared scheduler for decoding images (and related work).
+ * Tasks are queued per priority class: the image shown beats
+ * previews and display updates which beat prefetches, thumbnails 
+ * and batch processing. Every class has its own concurrency limit 
+ * so that background work never occupies all threads.
+ * Queued tasks can be reprioritized by their owner (e.g. if a 
+ * prefetched image becomes the current image).
+ * Tasks are skipped if their future was canceled before they started. 
+ * Hence, tasks must not capture objects that can be deleted meanwhile.
+ **/ 
+class DllCoreExport DkDecodeScheduler {
+
+public:
+	enum Priority {
+		priority_current = 0,	// the image shown
+		priority_display,		// previews, display caches, manipulators
+		priority_prefetch,		// images cached by the loader
+		priority_thumbnail,
+		priority_batch,
+
+		priority_end
+	};
+
+	static DkDecodeScheduler& instance();
+
+	/**
+	 * Queues fn and returns its future.
+	 * If the task is removed from the queue (see clear()), the 
+	 * future is canceled and holds a default constructed result.
+	 * @param priority the task's priority class
+	 * @param fn the task
+	 * @param owner optional: the id of the object the task is computed for (see newOwnerId(), reprioritize())
+	 * @return QFuture<T> the task's future
+	 **/ 
+	template <typename T>
+	QFuture<T> run(int priority, const std::function<T()>& fn, int owner = 0) {
+
+		QSharedPointer<QFutureInterface<T> > fi(new QFutureInterface<T>());
+		fi->reportStarted();
+
+		enqueue(priority, owner, 
+			[fi, fn]() {
+				// e.g. the watcher was canceled by the owner's destructor
+				if (fi->isCanceled()) {
+					fi->reportFinished();
+					return;
+				}
+
+				T result = T();
+				try {
+					result = fn();
+				}
+				catch (...) {
+					qWarning() << "[DkDecodeScheduler] exception caught in task";
+				}
+				fi->reportResult(result);
+				fi->reportFinished();
+			},
+			[fi]() {
+				fi->reportResult(T());
+				fi->reportCanceled();
+				fi->reportFinished();
+			});
+
+		return fi->future();
+	}
+
+	/**
+	 * Queues fn for every item (in place) - similar to QtConcurrent::map.
+	 * The future reports the progress and stops computing items if it is canceled.
+	 * @param priority the tasks' priority class
+	 * @param items the items - must not be modified until the future is finished
+	 * @param fn the function applied to every item
+	 * @return QFuture<void> the future of all items
+	 **/ 
+	template <typename Item>
+	QFuture<void> map(int priority, QVector<Item>& items, const std::function<void(Item&)>& fn) {
+
+		QSharedPointer<QFutureInterface<void> > fi(new QFutureInterface<void>());
+		QSharedPointer<QAtomicInt> numDone(new QAtomicInt(0));
+		int numItems = items.size();
+
+		fi->setProgressRange(0, numItems);
+		fi->reportStarted();
+
+		if (items.isEmpty())
+			fi->reportFinished();
+
+		Item* data = items.data();	// detach once
+
+		for (int idx = 0; idx < numItems; idx++) {
+
+			Item* item = data + idx;
+			auto done = [fi, numDone, numItems]() {
+				int n = numDone->fetchAndAddOrdered(1) + 1;
+				fi->setProgressValue(n);
+				if (n == numItems)
+					fi->reportFinished();
+			};
+
+			enqueue(priority, 0, 
+				[fi, fn, item, done]() {
+					if (!fi->isCanceled()) {
+						try {
+							fn(*item);
+						}
+						catch (...) {
+							qWarning() << "[DkDecodeScheduler] exception caught in task";
+						}
+					}
+					done();
+				},
+				[fi, done]() {
+					fi->reportCanceled();
+					done();
+				});
+		}
+
+		return fi->future();
+	}
+
+	static int newOwnerId();
+	void reprioritize(int owner, int priority);
+	void clear(int priority);
+
+	void setNumThreads(int numThreads);
+	void setMaxThreads(int priority, int maxThreads);
+	int maxThreads(int priority) const;
+
+protected:
+	DkDecodeScheduler();
+	DkDecodeScheduler(const DkDecodeScheduler&);
+
+	struct Task {
+		int owner;
+		std::function<void()> run;
+		std::function<void()> drop;
+	};
+
+	void enqueue(int priority, int owner, const std::function<void()>& run, const std::function<void()>& drop);
+	void schedule();
+	void taskFinished(int priority);
+
+	QThreadPool* mPool = 0;
+	mutable QMutex mMutex;
+	QVector<QList<Task> > mQueues;		// one FIFO per priority class
+	QVector<int> mNumRunning;
+	QVector<int> mMaxThreads;
+	int mNumRunningTotal = 0;
+	int mNumRunningBackground = 0;		// prefetch, thumbnail & batch tasks
+
+	friend class DkSchedulerRunnable;
+};
+
+}
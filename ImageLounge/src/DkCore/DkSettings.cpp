@@ -27,6 +27,7 @@
 
 #include "DkSettings.h"
 #include "DkUtils.h"
+#include "DkScheduler.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <iostream>
@@ -473,6 +474,9 @@ void DkSettings::load(QSettings& settings, bool defaults) {
 	resources_p.preferredExtension = settings.value("preferredExtension", resources_p.preferredExtension).toString();	
 	resources_p.gammaCorrection = settings.value("gammaCorrection", resources_p.gammaCorrection).toBool();
 	resources_p.loadSavedImage = settings.value("loadSavedImage", resources_p.loadSavedImage).toInt();
+	resources_p.progressiveLoading = settings.value("progressiveLoading", resources_p.progressiveLoading).toBool();
+	resources_p.cacheThumbs = settings.value("cacheThumbs", resources_p.cacheThumbs).toBool();
+	resources_p.thumbCacheSize = settings.value("thumbCacheSize", resources_p.thumbCacheSize).toInt();
 
 	if (sync_p.switchModifier) {
 		global_p.altMod = Qt::ControlModifier;
@@ -758,6 +762,12 @@ void DkSettings::save(QSettings& settings, bool force) {
 		settings.setValue("gammaCorrection", resources_p.gammaCorrection);
 	if (force || resources_p.loadSavedImage != resources_d.loadSavedImage)
 		settings.setValue("loadSavedImage", resources_p.loadSavedImage);
+	if (force || resources_p.progressiveLoading != resources_d.progressiveLoading)
+		settings.setValue("progressiveLoading", resources_p.progressiveLoading);
+	if (force || resources_p.cacheThumbs != resources_d.cacheThumbs)
+		settings.setValue("cacheThumbs", resources_p.cacheThumbs);
+	if (force || resources_p.thumbCacheSize != resources_d.thumbCacheSize)
+		settings.setValue("thumbCacheSize", resources_p.thumbCacheSize);
 
 	settings.endGroup();
 
@@ -900,6 +910,9 @@ void DkSettings::setToDefaultSettings() {
 	resources_p.preferredExtension = "*.jpg";
 	resources_p.gammaCorrection = true;
 	resources_p.loadSavedImage = ls_load_to_tab;
+	resources_p.progressiveLoading = true;
+	resources_p.cacheThumbs = true;
+	resources_p.thumbCacheSize = 512;
 	resources_p.waitForLastImg = true;
 
 	qDebug() << "ok... default settings are set";
@@ -947,6 +960,7 @@ void DkSettings::setNumThreads(int numThreads) {
 	if (numThreads != global_p.numThreads) {
 		global_p.numThreads = numThreads;
 		QThreadPool::globalInstance()->setMaxThreadCount(numThreads);
+		DkDecodeScheduler::instance().setNumThreads(numThreads);
 	}
 
 }
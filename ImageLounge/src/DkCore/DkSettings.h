@@ -314,6 +314,9 @@ public:
 		QString preferredExtension;
 		bool gammaCorrection;
 		int loadSavedImage;
+		bool progressiveLoading;
+		bool cacheThumbs;
+		int thumbCacheSize;
 	};
 
 	enum DisplayItems{
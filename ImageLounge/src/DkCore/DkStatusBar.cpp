@@ -29,6 +29,7 @@
 
 #include "DkSettings.h"
 #include "DkActionManager.h"
+#include "DkMetaDataWriter.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QLabel>
@@ -58,6 +59,8 @@ void DkStatusBar::createLayout() {
 			addPermanentWidget(mLabels[idx]);
 	}
 
+	connect(&DkMetaDataWriter::instance(), SIGNAL(pendingSignal(int)), this, SLOT(setMetaDataPending(int)));
+
 	hide();
 }
 
@@ -70,6 +73,11 @@ void DkStatusBar::setMessage(const QString& msg, StatusLabel which) {
 	mLabels[which]->setText(msg);
 }
 
+void DkStatusBar::setMetaDataPending(int numPending) {
+
+	setMessage(numPending > 0 ? tr("saving metadata (%1)").arg(numPending) : QString(), status_metadata_info);
+}
+
 // DkStatusBarManager --------------------------------------------------------------------
 DkStatusBarManager::DkStatusBarManager() {
 
@@ -66,12 +66,16 @@ public:
 		status_filenumber_info,
 		status_filesize_info,
 		status_time_info,
+		status_metadata_info,
 
 		status_end,
 	};
 
 	void setMessage(const QString& msg, StatusLabel which = status_pixel_info);
 
+public slots:
+	void setMetaDataPending(int numPending);
+
 protected:
 
 	void createLayout();
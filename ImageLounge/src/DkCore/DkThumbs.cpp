@@ -31,17 +31,25 @@
 #include "DkImageStorage.h"
 #include "DkBasicLoader.h"
 #include "DkMetaData.h"
+#include "DkMetaDataProbe.h"
 #include "DkUtils.h"
+#include "DkScheduler.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QFileInfo>
 #include <QStringList>
 #include <QMutex>
 #include <QImageReader>
-#include <QtConcurrentRun>
 #include <QTimer>
 #include <QBuffer>
-#include <QThreadPool>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QSaveFile>
+#include <QUrl>
+#include <QCoreApplication>
+#include <QSet>
+
+#include <algorithm>
 #pragma warning(pop)		// no warnings from includes - end
 
 namespace nmc {
@@ -53,6 +61,7 @@ namespace nmc {
 **/ 
 DkThumbNail::DkThumbNail(const QString& filePath, const QImage& img) {
 	mImg = DkImage::createThumb(img);
+	mLevels = createLevels(mImg);
 	mFile = filePath;
 	mMaxThumbSize = qRound(max_thumb_size * DkSettingsManager::param().dpiScaleFactor());
 	mImgExists = true;
@@ -68,8 +77,47 @@ void DkThumbNail::compute(int forceLoad) {
 
 	// this is so complicated to be thread-safe
 	// if we use member vars in the thread and the object gets deleted during thread execution we crash...
-	mImg = computeIntern(mFile, QSharedPointer<QByteArray>(), forceLoad, mMaxThumbSize);
+	mImg = computeIntern(mFile, QSharedPointer<QByteArray>(), forceLoad, mMaxThumbSize, QSharedPointer<DkCancelToken>(), mMetaData);
 	mImg = DkImage::createThumb(mImg);
+	mLevels = createLevels(mImg);
+}
+
+/**
+ * Returns the smallest level of the thumbnail pyramid that has at least size pixels.
+ * Hence, painting does not need to downscale large thumbnails.
+ * @param size the size needed (longer side)
+ * @return QImage the level or the thumbnail if no level is large enough
+ **/ 
+QImage DkThumbNail::getImage(int size) const {
+
+	for (int idx = mLevels.size()-1; idx >= 0; idx--) {
+
+		const QImage& l = mLevels[idx];
+
+		if (qMax(l.width(), l.height()) >= size)
+			return l;
+	}
+
+	return mImg;
+}
+
+/**
+ * Creates the levels of the thumbnail pyramid.
+ * Every level is half the size of the previous one.
+ * @param img the thumbnail (it is not part of the levels)
+ * @return QVector<QImage> the levels (descending) down to min_level_size
+ **/ 
+QVector<QImage> DkThumbNail::createLevels(const QImage& img) {
+
+	QVector<QImage> levels;
+	QImage l = img;
+
+	while (!l.isNull() && qMax(l.width(), l.height())/2 >= min_level_size) {
+		l = l.scaled(l.size()/2, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+		levels << l;
+	}
+
+	return levels;
 }
 
 /**
@@ -81,43 +129,59 @@ void DkThumbNail::compute(int forceLoad) {
  * @param forceLoad the loading flag (e.g. exiv only)
  * @param maxThumbSize the maximal thumbnail size to be loaded
  * @param minThumbSize the minimal thumbnail size to be loaded
+ * @param token if this token is canceled, the decoding stops and a null image is returned
+ * @param metaData the image's metadata - it is used if the file was parsed already
+ * @param exifThumb if not NULL, it is set to true if the embedded thumbnail was returned
  * @return QImage the loaded image. Null if no image
  * could be loaded at all.
  **/ 
 QImage DkThumbNail::computeIntern(const QString& filePath, const QSharedPointer<QByteArray> ba, 
-								  int forceLoad, int maxThumbSize) {
+								  int forceLoad, int maxThumbSize, QSharedPointer<DkCancelToken> token, 
+								  QSharedPointer<DkSharedMetaData> metaData, bool* exifThumbOut) {
 	
 	DkTimer dt;
 	//qDebug() << "[thumb] file: " << filePath;
 
 	// see if we can read the thumbnail from the exif data
+	// the image's metadata is reused if it was parsed already (e.g. by the loader)
+	// otherwise the probe reads the header only - we don't need the full Exiv2 tree here
 	QImage thumb;
-	DkMetaDataT metaData;
+	QSharedPointer<DkMetaDataT> loadedMetaData = metaData ? metaData->loadedMetaData() : QSharedPointer<DkMetaDataT>();
+	DkMetaDataProbe probe;
 
 	QSharedPointer<QByteArray> baZip = QSharedPointer<QByteArray>();
 #ifdef WITH_QUAZIP
-	if (QFileInfo(mFile).dir().path().contains(DkZipContainer::zipMarker())) 
+	if (QFileInfo(filePath).dir().path().contains(DkZipContainer::zipMarker())) 
 		baZip = DkZipContainer::extractImage(DkZipContainer::decodeZipFile(filePath), DkZipContainer::decodeImageFile(filePath));
 #endif
-	try {
-		// [DIEM] READ  build crashed here 09.06.2016
+	if (!loadedMetaData) {
 		if (baZip && !baZip->isEmpty())	
-			metaData.readMetaData(filePath, baZip);
-		else if (!ba || ba->isEmpty())
-			metaData.readMetaData(filePath);
+			probe.probe(filePath, baZip);
 		else
-			metaData.readMetaData(filePath, ba);
-
-		// read the full image if we want to create new thumbnails
-		if (forceLoad != force_save_thumb)
-			thumb = metaData.getThumbnail();
+			probe.probe(filePath, ba);
 	}
-	catch(...) {
-		// do nothing - we'll load the full file
+
+	// read the full image if we want to create new thumbnails
+	if (forceLoad != force_save_thumb) {
+		try {
+			thumb = loadedMetaData ? loadedMetaData->getThumbnail() : probe.getThumbnail();
+		}
+		catch (...) {
+			// do nothing - we'll load the full file
+		}
 	}
+
 	removeBlackBorder(thumb);
 
+	// the thumbnail is not needed anymore
+	if (DkCancelToken::isCanceled(token))
+		return QImage();
+
 	bool exifThumb = !thumb.isNull();
+	bool decoded = false;
+
+	// save the thumbnail if the caller either forces it, or the save thumb is requested and the image did not have any before
+	bool saveThumb = forceLoad == force_save_thumb || (forceLoad == save_thumb && !exifThumb);
 
 	QFileInfo fInfo(filePath);
 	QString lFilePath = fInfo.isSymLink() ? fInfo.symLinkTarget() : filePath;
@@ -133,20 +197,28 @@ QImage DkThumbNail::computeIntern(const QString& filePath, const QSharedPointer<
 
 		// try to read the image
 		DkBasicLoader loader;
+		loader.setCancelToken(token);
 
-		if (baZip && !baZip->isEmpty()) {
-			if (loader.loadGeneral(lFilePath, baZip, true, true))
-				thumb = loader.image();
-		}
-		else {
-			if (loader.loadGeneral(lFilePath, ba, true, true))
-				thumb = loader.image();
-		}
+		// we downscale in two steps below (2x fast, then smooth) - so twice the size is sufficient
+		// saved thumbnails write the image size to the metadata - so they need the full image
+		if (!saveThumb)
+			loader.setMinSize(QSize(maxThumbSize*2, maxThumbSize*2));
+
+		if (baZip && !baZip->isEmpty())
+			decoded = loader.loadGeneral(lFilePath, baZip, true, true);
+		else
+			decoded = loader.loadGeneral(lFilePath, ba, true, true);
+
+		if (decoded)
+			thumb = loader.image();
 	}
 
 	if (thumb.isNull() && forceLoad == force_exif_thumb)
 		return QImage();
 
+	if (exifThumbOut)
+		*exifThumbOut = !decoded;
+
 	// the image is not scaled correctly yet
 	if (rescale && !thumb.isNull()) {
 
@@ -173,19 +245,23 @@ QImage DkThumbNail::computeIntern(const QString& filePath, const QSharedPointer<
 		thumb = thumb.scaled(QSize(w, h), Qt::KeepAspectRatio, Qt::SmoothTransformation);
 	}
 
-	int orientation = metaData.getOrientationDegree();
+	int orientation = loadedMetaData ? loadedMetaData->getOrientationDegree() : probe.getOrientationDegree();
+	bool jpgOrRaw = loadedMetaData ? (loadedMetaData->isJpg() || loadedMetaData->isRaw()) : (probe.isJpg() || probe.isRaw());
 
-	if (orientation != -1 && orientation != 0 && (metaData.isJpg() || metaData.isRaw())) {
+	if (orientation != -1 && orientation != 0 && jpgOrRaw) {
 		QTransform rotationMatrix;
 		rotationMatrix.rotate((double)orientation);
 		thumb = thumb.transformed(rotationMatrix);
 	}
 
-	// save the thumbnail if the caller either forces it, or the save thumb is requested and the image did not have any before
-	if (forceLoad == force_save_thumb || (forceLoad == save_thumb && !exifThumb)) {
+	if (saveThumb) {
 		
 		try {
 
+			// writing needs the full metadata
+			DkMetaDataT fullMetaData;
+			fullMetaData.readMetaData(filePath, ba);
+
 			QImage sThumb = thumb.copy();
 			if (orientation != -1 && orientation != 0) {
 				QTransform rotationMatrix;
@@ -193,12 +269,12 @@ QImage DkThumbNail::computeIntern(const QString& filePath, const QSharedPointer<
 				sThumb = sThumb.transformed(rotationMatrix);
 			}
 
-			metaData.updateImageMetaData(sThumb);
+			fullMetaData.updateImageMetaData(sThumb);
 
 			if (!ba || ba->isEmpty())
-				metaData.saveMetaData(lFilePath);
+				fullMetaData.saveMetaData(lFilePath);
 			else
-				metaData.saveMetaData(lFilePath, ba);
+				fullMetaData.saveMetaData(lFilePath, ba);
 
 			qDebug() << "[thumb] saved to exif data";
 		}
@@ -212,6 +288,54 @@ QImage DkThumbNail::computeIntern(const QString& filePath, const QSharedPointer<
 	return thumb;
 }
 
+/**
+ * Reads the metadata of a file and embeds a new thumbnail.
+ * The metadata is not saved so that the caller can decode 
+ * the next file while this one is written (see DkThumbsSaver).
+ * @param filePath the image's file path
+ * @param force if false, files that have an embedded thumbnail are skipped
+ * @param token if this token is canceled, the decoding stops
+ * @return QSharedPointer<DkMetaDataT> the edited metadata or a null pointer if there is nothing to save
+ **/ 
+QSharedPointer<DkMetaDataT> DkThumbNail::embedThumb(const QString& filePath, bool force, QSharedPointer<DkCancelToken> token) {
+
+	if (!force) {
+		DkMetaDataProbe probe;
+
+		if (probe.probe(filePath) && probe.thumbnailLength() > 0)
+			return QSharedPointer<DkMetaDataT>();
+	}
+
+	// the embedded thumbnail is at most 200 px (see DkMetaDataT::updateImageMetaData) - so we can decode less
+	// the image is decoded reduced - so its size must not be written to the metadata
+	QImage thumb = computeIntern(filePath, QSharedPointer<QByteArray>(), force_full_thumb, 200, token);
+
+	if (thumb.isNull() || DkCancelToken::isCanceled(token))
+		return QSharedPointer<DkMetaDataT>();
+
+	QSharedPointer<DkMetaDataT> metaData(new DkMetaDataT());
+
+	try {
+		metaData->readMetaData(filePath);
+
+		// computeIntern rotated the thumbnail - but it is stored unrotated
+		int orientation = metaData->getOrientationDegree();
+		if (orientation != -1 && orientation != 0 && (metaData->isJpg() || metaData->isRaw())) {
+			QTransform rotationMatrix;
+			rotationMatrix.rotate(-(double)orientation);
+			thumb = thumb.transformed(rotationMatrix);
+		}
+
+		metaData->setThumbnail(DkImage::createThumb(thumb, 200));
+	}
+	catch (...) {
+		qWarning() << "[DkThumbNail] could not embed the thumbnail of" << filePath;
+		return QSharedPointer<DkMetaDataT>();
+	}
+
+	return metaData;
+}
+
 /**
  * Removes potential black borders.
  * These borders can be found e.g. in Nikon One images (16:9 vs 4:3)
@@ -277,6 +401,7 @@ void DkThumbNail::removeBlackBorder(QImage& img) {
 void DkThumbNail::setImage(const QImage img) {
 	
 	mImg = DkImage::createThumb(img);
+	mLevels = createLevels(mImg);
 }
 
 /**
@@ -298,10 +423,12 @@ DkThumbNailT::~DkThumbNailT() {
 
 bool DkThumbNailT::fetchThumb(int forceLoad /* = false */,  QSharedPointer<QByteArray> ba) {
 
-	if (forceLoad == force_full_thumb || forceLoad == force_save_thumb || forceLoad == save_thumb)
+	if (forceLoad == force_full_thumb || forceLoad == force_save_thumb || forceLoad == save_thumb) {
 		mImg = QImage();
+		mLevels.clear();
+	}
 
-	if (!mImg.isNull() || !mImgExists || mFetching)
+	if (!mImg.isNull() || !mImgExists || isFetching())
 		return false;
 
 	// check if we can load the file
@@ -313,37 +440,99 @@ bool DkThumbNailT::fetchThumb(int forceLoad /* = false */,  QSharedPointer<QByte
 
 	// we have to do our own bool here
 	// watcher.isRunning() returns false if the thread is waiting in the pool
+	// a canceled computation is replaced (its result is ignored anyway)
 	mFetching = true;
 	mForceLoad = forceLoad;
+	mCancelToken = QSharedPointer<DkCancelToken>(new DkCancelToken());
 
 	connect(&mThumbWatcher, SIGNAL(finished()), this, SLOT(thumbLoaded()), Qt::UniqueConnection);
 
-	mThumbWatcher.setFuture(QtConcurrent::run(
-#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
-		DkThumbsThreadPool::pool(),		// load thumbnails on their dedicated pool
-#endif
-		this, 
-		&nmc::DkThumbNailT::computeCall, 
-		mFile, 
-		ba, 
-		forceLoad, 
-		mMaxThumbSize));
+	QString filePath = mFile;
+	int maxThumbSize = mMaxThumbSize;
+	QSharedPointer<DkCancelToken> token = mCancelToken;
+	QSharedPointer<DkSharedMetaData> metaData = mMetaData;
+
+	mThumbWatcher.setFuture(DkDecodeScheduler::instance().run<QVector<QImage> >(
+		DkDecodeScheduler::priority_thumbnail,
+		[filePath, ba, forceLoad, maxThumbSize, token, metaData]() { 
+			return computeCall(filePath, ba, forceLoad, maxThumbSize, token, metaData); 
+		}));
 
 	return true;
 }
 
+/**
+ * Cancels a running (or queued) thumbnail computation.
+ * The thumbnail can be fetched again afterwards.
+ **/ 
+void DkThumbNailT::cancel() {
+
+	if (mFetching && mCancelToken)
+		mCancelToken->cancel();
+}
+
+/**
+ * Returns true if the thumbnail is currently computed.
+ * Canceled computations are not reported since the thumbnail can be fetched again.
+ **/ 
+bool DkThumbNailT::isFetching() const {
+
+	return mFetching && !DkCancelToken::isCanceled(mCancelToken);
+}
+
+
+/**
+ * Computes the thumbnail pyramid (one decode for all levels).
+ * @return QVector<QImage> the thumbnail followed by its levels - empty if there is no thumbnail
+ **/ 
+QVector<QImage> DkThumbNailT::computeCall(const QString& filePath, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize, QSharedPointer<DkCancelToken> token, QSharedPointer<DkSharedMetaData> metaData) {
+
+	QVector<QImage> levels;
+
+	// the persistent cache is skipped if new thumbnails are requested
+	if (forceLoad == do_not_force || forceLoad == force_exif_thumb) {
+		
+		QImage thumb = DkThumbCache::load(filePath, maxThumbSize);
+
+		// smaller levels are derived from the largest one (no need to read them)
+		if (!thumb.isNull()) {
+			thumb = DkImage::createThumb(thumb, maxThumbSize);
+			levels << thumb << createLevels(thumb);
+			return levels;
+		}
+	}
+
+	// the cache stores the spec's sizes (e.g. 512 px for 400 px thumbnails) - so we decode a bit more
+	bool exifThumb = false;
+	int decodeSize = forceLoad == force_exif_thumb ? maxThumbSize : DkThumbCache::flavorSize(maxThumbSize);
+	QImage img = DkThumbNail::computeIntern(filePath, ba, forceLoad, decodeSize, token, metaData, &exifThumb);
+
+	if (img.isNull() || DkCancelToken::isCanceled(token))
+		return levels;
+
+	// embedded exif thumbnails are too small for the cache
+	if (!exifThumb)
+		DkThumbCache::saveFlavors(filePath, img, maxThumbSize);
 
-QImage DkThumbNailT::computeCall(const QString& filePath, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize) {
+	QImage thumb = DkImage::createThumb(img, maxThumbSize);
+	levels << thumb << createLevels(thumb);
 
-	QImage thumb = DkThumbNail::computeIntern(filePath, ba, forceLoad, maxThumbSize);
-	return DkImage::createThumb(thumb);
+	return levels;
 }
 
 void DkThumbNailT::thumbLoaded() {
 	
-	QFuture<QImage> future = mThumbWatcher.future();
+	QFuture<QVector<QImage> > future = mThumbWatcher.future();
 
-	mImg = future.result();
+	// canceled thumbnails are not marked as missing - we just fetch them again if needed
+	if (future.isCanceled() || DkCancelToken::isCanceled(mCancelToken)) {
+		mFetching = false;
+		return;
+	}
+
+	QVector<QImage> levels = future.result();
+	mImg = levels.value(0);
+	mLevels = levels.mid(1);
 	
 	if (mImg.isNull() && mForceLoad != force_exif_thumb)
 		mImgExists = false;
@@ -352,37 +541,391 @@ void DkThumbNailT::thumbLoaded() {
 	emit thumbLoadedSignal(!mImg.isNull());
 }
 
-// DkThumbsThreadPool --------------------------------------------------------------------
-DkThumbsThreadPool::DkThumbsThreadPool() {
-	
-#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
-	mPool = new QThreadPool();
-	mPool->setMaxThreadCount(qMax(mPool->maxThreadCount() - 2, 1));
-#endif
+// DkThumbRequestQueue --------------------------------------------------------------------
+DkThumbRequestQueue::DkThumbRequestQueue(QObject* parent) : QObject(parent) {
+}
+
+DkThumbRequestQueue::~DkThumbRequestQueue() {
+	clear();
 }
 
-DkThumbsThreadPool& DkThumbsThreadPool::instance() {
+/**
+ * Replaces all requests.
+ * Requests are ordered by their rank and batched per directory.
+ * Running requests that are not requested anymore are canceled.
+ * @param requests the thumbnails needed (e.g. visible & prefetched thumbs)
+ **/ 
+void DkThumbRequestQueue::setRequests(const QVector<Request>& requests) {
+
+	// rank, directory, request index
+	QVector<QPair<QPair<int, QString>, int> > keys;
+	keys.reserve(requests.size());
+
+	for (int idx = 0; idx < requests.size(); idx++) {
+
+		if (!requests[idx].thumb)
+			continue;
+
+		QString fp = requests[idx].thumb->getFilePath();
+		keys << qMakePair(qMakePair(requests[idx].rank, fp.left(fp.lastIndexOf("/"))), idx);
+	}
+
+	// requests of equal rank (e.g. a row) are grouped by their directory
+	std::sort(keys.begin(), keys.end());
+
+	QSet<DkThumbNailT*> requested;
+	mPending.clear();
 
-	static DkThumbsThreadPool inst;
-	return inst;
+	for (const auto& k : keys) {
+
+		const QSharedPointer<DkThumbNailT>& t = requests[k.second].thumb;
+
+		if (!requested.contains(t.data())) {
+			requested.insert(t.data());
+			mPending << t;
+		}
+	}
+
+	// drop running requests that are not needed anymore
+	QSet<DkThumbNailT*> running;
+
+	for (int idx = 0; idx < mFetching.size();) {
+
+		QSharedPointer<DkThumbNailT> t = mFetching[idx];
+
+		if (!requested.contains(t.data())) {
+			disconnect(t.data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded()));
+			t->cancel();
+			mFetching.removeAt(idx);
+		}
+		else {
+			running.insert(t.data());
+			idx++;
+		}
+	}
+
+	for (int idx = 0; idx < mPending.size();) {
+		if (running.contains(mPending[idx].data()))
+			mPending.removeAt(idx);
+		else
+			idx++;
+	}
+
+	fetchNext();
 }
 
-QThreadPool* DkThumbsThreadPool::pool() {
-	
-#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
-	return instance().mPool;
-#else
-	return QThreadPool::globalInstance();
-#endif
+/**
+ * Drops all requests and cancels the running ones.
+ **/ 
+void DkThumbRequestQueue::clear() {
+
+	mPending.clear();
+
+	for (QSharedPointer<DkThumbNailT> t : mFetching) {
+		disconnect(t.data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded()));
+		t->cancel();
+	}
+
+	mFetching.clear();
+}
+
+int DkThumbRequestQueue::numPending() const {
+	return mPending.size() + mFetching.size();
+}
+
+void DkThumbRequestQueue::thumbLoaded() {
+
+	DkThumbNailT* t = qobject_cast<DkThumbNailT*>(QObject::sender());
+
+	for (int idx = 0; idx < mFetching.size(); idx++) {
+
+		if (mFetching[idx].data() == t) {
+			disconnect(t, SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded()));
+			mFetching.removeAt(idx);
+			break;
+		}
+	}
+
+	fetchNext();
+}
+
+void DkThumbRequestQueue::fetchNext() {
+
+	// someone else might have canceled our requests
+	for (int idx = 0; idx < mFetching.size();) {
+
+		if (!mFetching[idx]->isFetching()) {
+			disconnect(mFetching[idx].data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded()));
+			mFetching.removeAt(idx);
+		}
+		else
+			idx++;
+	}
+
+	// keep the scheduler's queue short - so that the next request is still the most important one
+	int maxFetching = DkDecodeScheduler::instance().maxThreads(DkDecodeScheduler::priority_thumbnail);
+
+	while (mFetching.size() < maxFetching && !mPending.empty()) {
+
+		QSharedPointer<DkThumbNailT> t = mPending.takeFirst();
+
+		// loaded, not existing or fetched by someone else
+		if (t->hasImage() != DkThumbNail::not_loaded)
+			continue;
+
+		connect(t.data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded()), Qt::UniqueConnection);
+
+		if (t->fetchThumb())
+			mFetching << t;
+		else
+			disconnect(t.data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded()));
+	}
+}
+
+// DkThumbCache --------------------------------------------------------------------
+/**
+ * Loads the thumbnail of filePath from the cache.
+ * @param filePath the image's file path
+ * @param maxThumbSize the thumbnail size needed
+ * @return QImage the cached thumbnail or a null image if it is not cached (or outdated)
+ **/ 
+QImage DkThumbCache::load(const QString& filePath, int maxThumbSize) {
+
+	if (!isCacheable(filePath))
+		return QImage();
+
+	QString tp = thumbPath(filePath, maxThumbSize);
+
+	if (!QFileInfo(tp).exists())
+		return QImage();
+
+	QImage thumb;
+	if (!thumb.load(tp, "PNG"))
+		return QImage();
+
+	QFileInfo fInfo(filePath);
+	QString size = thumb.text("Thumb::Size");
+
+	// outdated thumbnails are overwritten as soon as the new thumbnail is computed
+	if (thumb.text("Thumb::URI") != uri(filePath) ||
+		thumb.text("Thumb::MTime").toLongLong() != fInfo.lastModified().toMSecsSinceEpoch() / 1000 ||
+		(!size.isEmpty() && size.toLongLong() != fInfo.size()))
+		return QImage();
+
+	return thumb;
+}
+
+/**
+ * Stores the thumbnail of filePath in the cache.
+ * The file is written atomically (temporary file + rename) as demanded by the spec.
+ * @param filePath the image's file path
+ * @param thumb the thumbnail
+ * @param maxThumbSize the thumbnail size (defines the cache folder)
+ * @return bool true if the thumbnail was written
+ **/ 
+bool DkThumbCache::save(const QString& filePath, const QImage& thumb, int maxThumbSize) {
+
+	if (thumb.isNull() || !isCacheable(filePath))
+		return false;
+
+	QFileInfo tInfo(thumbPath(filePath, maxThumbSize));
+
+	if (!QDir().mkpath(tInfo.absolutePath()))
+		return false;
+
+	// the spec demands private folders & files
+	const QFileDevice::Permissions privateDir = QFileDevice::ReadOwner | QFileDevice::WriteOwner | QFileDevice::ExeOwner;
+	QFile::setPermissions(thumbDir(), privateDir);
+	QFile::setPermissions(tInfo.absolutePath(), privateDir);
+
+	QFileInfo fInfo(filePath);
+	QImage img = thumb;
+	img.setText("Thumb::URI", uri(filePath));
+	img.setText("Thumb::MTime", QString::number(fInfo.lastModified().toMSecsSinceEpoch() / 1000));
+	img.setText("Thumb::Size", QString::number(fInfo.size()));
+	img.setText("Software", QCoreApplication::applicationName() + " " + QCoreApplication::applicationVersion());
+
+	QSaveFile file(tInfo.absoluteFilePath());
+
+	if (!file.open(QIODevice::WriteOnly) || !img.save(&file, "PNG") || !file.commit()) {
+		qWarning() << "[DkThumbCache] could not write" << tInfo.absoluteFilePath();
+		return false;
+	}
+
+	QFile::setPermissions(tInfo.absoluteFilePath(), QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+
+	// check the cache size once per session and after every few thousand thumbnails
+	static QAtomicInt numSaved;
+	if (numSaved.fetchAndAddRelaxed(1) % 2000 == 0) {
+
+		qint64 maxBytes = (qint64)DkSettingsManager::param().resources().thumbCacheSize * 1024 * 1024;
+		DkDecodeScheduler::instance().run<bool>(
+			DkDecodeScheduler::priority_thumbnail,
+			[maxBytes]() { collectGarbage(maxBytes); return true; });
+	}
+
+	return true;
+}
+
+/**
+ * Stores the thumbnail in all folders (normal, large, ...) up to maxThumbSize's folder.
+ * Every folder gets the spec's size (128, 256, 512, 1024 px) so that
+ * other applications find the size they need too.
+ * @param filePath the image's file path
+ * @param img the decoded image - it must be at least flavorSize(maxThumbSize) unless the image is smaller
+ * @param maxThumbSize the thumbnail size needed
+ **/ 
+void DkThumbCache::saveFlavors(const QString& filePath, const QImage& img, int maxThumbSize) {
+
+	int maxSide = qMax(img.width(), img.height());
+
+	for (int size = 128; size <= flavorSize(maxThumbSize); size *= 2) {
+
+		// the spec does not upscale - small images are stored once with their size
+		if (maxSide <= size) {
+			save(filePath, img, size);
+			break;
+		}
+
+		save(filePath, DkImage::createThumb(img, size), size);
+	}
 }
 
-void DkThumbsThreadPool::clear() {
+/**
+ * Deletes our oldest thumbnails if they exceed maxBytes.
+ * The cache folder is shared - so only thumbnails written by
+ * nomacs are counted & deleted, other applications manage theirs.
+ * The thumbnails are shrunk to 80% of maxBytes so that they do not
+ * need to be cleaned with every new thumbnail.
+ * @param maxBytes the maximal size of our thumbnails in bytes
+ **/ 
+void DkThumbCache::collectGarbage(qint64 maxBytes) {
+
+	if (maxBytes <= 0)
+		return;
+
+	// one run at a time
+	static QAtomicInt running;
+	if (!running.testAndSetAcquire(0, 1))
+		return;
+
+	DkTimer dt;
+	QFileInfoList thumbs;
+	qint64 cacheSize = 0;
+
+	for (const QString& f : QStringList() << "normal" << "large" << "x-large" << "xx-large") {
+		
+		QDir dir(thumbDir() + "/" + f);
+		
+		for (const QFileInfo& t : dir.entryInfoList(QStringList() << "*.png", QDir::Files)) {
+
+			if (!isOwnThumb(t.absoluteFilePath()))
+				continue;
+
+			thumbs << t;
+			cacheSize += t.size();
+		}
+	}
+
+	if (cacheSize <= maxBytes) {
+		running.storeRelease(0);
+		return;
+	}
+
+	qSort(thumbs.begin(), thumbs.end(), [](const QFileInfo& l, const QFileInfo& r) {
+		return l.lastModified() < r.lastModified();
+	});
+
+	int numDeleted = 0;
+	for (const QFileInfo& t : thumbs) {
+
+		if (cacheSize <= maxBytes * 0.8)
+			break;
+
+		if (QFile::remove(t.absoluteFilePath())) {
+			cacheSize -= t.size();
+			numDeleted++;
+		}
+	}
 
-#if QT_VERSION >= QT_VERSION_CHECK(5, 2, 0)
-	pool()->clear();
+	running.storeRelease(0);
+
+	qInfo() << "[DkThumbCache]" << numDeleted << "thumbnails deleted in" << dt;
+}
+
+QString DkThumbCache::thumbDir() {
+	return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + "/thumbnails";
+}
+
+/**
+ * Returns the thumbnail path: the md5 hash of the file's URI in the size's folder.
+ * @param filePath the image's file path
+ * @param maxThumbSize the thumbnail size
+ * @return QString the thumbnail's path
+ **/ 
+QString DkThumbCache::thumbPath(const QString& filePath, int maxThumbSize) {
+
+	QByteArray hash = QCryptographicHash::hash(uri(filePath).toUtf8(), QCryptographicHash::Md5).toHex();
+	return thumbDir() + "/" + flavor(maxThumbSize) + "/" + QString::fromLatin1(hash) + ".png";
+}
+
+bool DkThumbCache::isCacheable(const QString& filePath) {
+
+	if (!DkSettingsManager::param().resources().cacheThumbs || filePath.isEmpty())
+		return false;
+
+#ifdef WITH_QUAZIP
+	if (filePath.contains(DkZipContainer::zipMarker()))
+		return false;
 #endif
 
+	// do not create thumbnails of thumbnails
+	return !filePath.startsWith(thumbDir());
 }
 
+/**
+ * Returns true if the thumbnail was written by us.
+ * Only the PNG header is read (the Software text is stored before the pixels).
+ * @param thumbPath the thumbnail's path
+ * @return bool true if our Software tag is found
+ **/ 
+bool DkThumbCache::isOwnThumb(const QString& thumbPath) {
+
+	QImageReader reader(thumbPath, "PNG");
+	return reader.text("Software").startsWith(QCoreApplication::applicationName() + " ");
+}
+
+QString DkThumbCache::flavor(int maxThumbSize) {
+
+	if (maxThumbSize <= 128)
+		return "normal";
+	else if (maxThumbSize <= 256)
+		return "large";
+	else if (maxThumbSize <= 512)
+		return "x-large";
+
+	return "xx-large";
+}
+
+/**
+ * Returns the thumbnail size of the folder that stores maxThumbSize thumbnails.
+ * @param maxThumbSize the thumbnail size needed
+ * @return int the spec's size (128, 256, 512 or 1024)
+ **/ 
+int DkThumbCache::flavorSize(int maxThumbSize) {
+
+	if (maxThumbSize <= 128)
+		return 128;
+	else if (maxThumbSize <= 256)
+		return 256;
+	else if (maxThumbSize <= 512)
+		return 512;
+
+	return 1024;
+}
+
+QString DkThumbCache::uri(const QString& filePath) {
+	return QString::fromLatin1(QUrl::fromLocalFile(QFileInfo(filePath).absoluteFilePath()).toEncoded());
+}
 
 }
@@ -34,6 +34,7 @@
 #include <QDir>
 #include <QThread>
 #include <QImage>
+#include <QVector>
 #pragma warning(pop)		// no warnings from includes - end
 
 #pragma warning(disable: 4251)	// TODO: remove
@@ -48,10 +49,12 @@
 #endif
 #endif
 
-class QThreadPool;
-
 namespace nmc {
 
+class DkCancelToken;
+class DkSharedMetaData;
+class DkMetaDataT;
+
 #define max_thumb_size 400
 
 /**
@@ -66,6 +69,10 @@ public:
 		not_loaded,
 		loaded,
 	};
+
+	enum {
+		min_level_size = 64,	// the smallest level of the thumbnail pyramid
+	};
 	
 	/**
 	 * Default constructor.
@@ -91,7 +98,7 @@ public:
 	 **/ 
 	virtual void setImage(const QImage img);
 
-	void removeBlackBorder(QImage& img);
+	static void removeBlackBorder(QImage& img);
 
 	/**
 	 * Returns the thumbnail.
@@ -102,6 +109,11 @@ public:
 		return mImg;
 	};
 
+	QImage getImage(int size) const;
+	static QVector<QImage> createLevels(const QImage& img);
+	static QSharedPointer<DkMetaDataT> embedThumb(const QString& filePath, bool force, 
+		QSharedPointer<DkCancelToken> token = QSharedPointer<DkCancelToken>());
+
 	/**
 	 * Returns the file information.
 	 * @return QFileInfo the thumbnail file
@@ -142,6 +154,15 @@ public:
 		mImgExists = exists;
 	};
 
+	/**
+	 * Sets the metadata of the thumbnail's image.
+	 * If it is loaded already, the file is not parsed again.
+	 * @param metaData the image container's metadata
+	 **/ 
+	void setMetaData(QSharedPointer<DkSharedMetaData> metaData) {
+		mMetaData = metaData;
+	};
+
 	enum {
 		do_not_force,
 		force_exif_thumb,
@@ -151,10 +172,15 @@ public:
 	};
 
 protected:
-	QImage computeIntern(const QString& file, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize);
+	static QImage computeIntern(const QString& file, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize, 
+		QSharedPointer<DkCancelToken> token = QSharedPointer<DkCancelToken>(), 
+		QSharedPointer<DkSharedMetaData> metaData = QSharedPointer<DkSharedMetaData>(),
+		bool* exifThumb = 0);
 
 	QImage mImg;
+	QVector<QImage> mLevels;	// mImg downscaled by 2, 4, ... (descending)
 	QString mFile;
+	QSharedPointer<DkSharedMetaData> mMetaData;
 	//int s;
 	bool mImgExists;
 	int mMaxThumbSize;
@@ -168,6 +194,7 @@ public:
 	~DkThumbNailT();
 
 	bool fetchThumb(int forceLoad = do_not_force, QSharedPointer<QByteArray> ba = QSharedPointer<QByteArray>());
+	void cancel();
 
 	/**
 	 * Returns whether the thumbnail was loaded, or does not exist.
@@ -175,12 +202,14 @@ public:
 	 **/ 
 	int hasImage() const {
 		
-		if (mThumbWatcher.isRunning())
+		if (isFetching())
 			return loading;
 		else
 			return DkThumbNail::hasImage();
 	};
 
+	bool isFetching() const;
+
 	void setImage(const QImage img) {
 		DkThumbNail::setImage(img);
 		emit thumbLoadedSignal(true);
@@ -193,26 +222,70 @@ protected slots:
 	void thumbLoaded();
 
 protected:
-	QImage computeCall(const QString& filePath, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize);
+	static QVector<QImage> computeCall(const QString& filePath, QSharedPointer<QByteArray> ba, int forceLoad, int maxThumbSize, QSharedPointer<DkCancelToken> token, QSharedPointer<DkSharedMetaData> metaData);
 
-	QFutureWatcher<QImage> mThumbWatcher;
+	QFutureWatcher<QVector<QImage> > mThumbWatcher;
 	bool mFetching;
 	int mForceLoad;
+	QSharedPointer<DkCancelToken> mCancelToken;
 };
 
-class DkThumbsThreadPool {
+/**
+ * Requests thumbnails in the order of their importance.
+ * Only as many requests as the scheduler computes in parallel are 
+ * passed on. Hence, requests that become unimportant (e.g. because 
+ * they were scrolled out) are dropped before they are computed.
+ **/ 
+class DllCoreExport DkThumbRequestQueue : public QObject {
+	Q_OBJECT
 
 public:
-	static DkThumbsThreadPool& instance();
+	DkThumbRequestQueue(QObject* parent = 0);
+	~DkThumbRequestQueue();
 
-	static QThreadPool* pool();
-	static void clear();
+	struct Request {
+		QSharedPointer<DkThumbNailT> thumb;
+		int rank;		// lower ranks are fetched first
+	};
 
-private:
-	DkThumbsThreadPool();
-	DkThumbsThreadPool(const DkThumbsThreadPool&);
+	void setRequests(const QVector<Request>& requests);
+	void clear();
+	int numPending() const;
 
-	QThreadPool* mPool;
+protected slots:
+	void thumbLoaded();
+
+protected:
+	void fetchNext();
+
+	QList<QSharedPointer<DkThumbNailT> > mPending;		// ordered
+	QList<QSharedPointer<DkThumbNailT> > mFetching;
+};
+
+/**
+ * Persistent thumbnail cache.
+ * Thumbnails are stored according to the freedesktop thumbnail
+ * specification (~/.cache/thumbnails) so that they are shared with
+ * other applications. A thumbnail is valid if the file's modification 
+ * date and size match the ones stored in the PNG (Thumb::MTime, Thumb::Size).
+ **/ 
+class DllCoreExport DkThumbCache {
+
+public:
+	static QImage load(const QString& filePath, int maxThumbSize);
+	static bool save(const QString& filePath, const QImage& thumb, int maxThumbSize);
+	static void saveFlavors(const QString& filePath, const QImage& img, int maxThumbSize);
+	static void collectGarbage(qint64 maxBytes);
+
+	static QString thumbDir();
+	static QString thumbPath(const QString& filePath, int maxThumbSize);
+	static int flavorSize(int maxThumbSize);
+
+protected:
+	static bool isCacheable(const QString& filePath);
+	static bool isOwnThumb(const QString& thumbPath);
+	static QString flavor(int maxThumbSize);
+	static QString uri(const QString& filePath);
 };
 
 
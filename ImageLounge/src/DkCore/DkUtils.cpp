@@ -32,6 +32,7 @@
 #include "DkNoMacs.h"
 #include "DkViewPort.h"
 #include "DkVersion.h"
+#include "DkScheduler.h"
 
 #if defined(Q_OS_LINUX) && !defined(Q_OS_OPENBSD)
 #include <sys/sysinfo.h>
@@ -241,6 +242,46 @@ bool DkUtils::naturalCompare(const QString &s1, const QString &s2, Qt::CaseSensi
 	return QString::compare(s1, s2, cs) < 0;
 }
 
+/// <summary>
+/// Returns a key for natural sorting.
+/// Numbers are zero-padded so that comparing two keys 
+/// with a plain string compare results in natural order (img2 < img10).
+/// The keys are case-insensitive.
+/// </summary>
+/// <param name="str">The string (e.g. a file name).</param>
+/// <returns>The sort key.</returns>
+QString DkUtils::naturalSortKey(const QString & str) {
+
+	const int numDigits = 20;	// qint64 has 19 digits
+
+	QString s = str.toLower();
+	QString key;
+	key.reserve(s.size() + numDigits);
+
+	for (int idx = 0; idx < s.size(); ) {
+
+		if (s[idx] < '0' || s[idx] > '9') {
+			key += s[idx++];
+			continue;
+		}
+
+		// find the number & skip its leading zeros
+		int start = idx;
+		while (idx < s.size() && s[idx] >= '0' && s[idx] <= '9')
+			idx++;
+
+		while (start < idx - 1 && s[start] == '0')
+			start++;
+
+		int len = idx - start;
+		if (len < numDigits)
+			key += QString(numDigits - len, '0');
+		key += s.midRef(start, len);
+	}
+
+	return key;
+}
+
 /// <summary>
 /// Resolves symbolic links.
 /// </summary>
@@ -550,19 +591,12 @@ void DkUtils::mSleep(int ms) {
 
 bool DkUtils::exists(const QFileInfo& file, int waitMs) {
 
-	QFuture<bool> future = QtConcurrent::run(
-#if QT_VERSION >= QT_VERSION_CHECK(5, 4, 0)
-		// TODO: if we have a lot of mounted files (windows) in the history
-        // we can potentially exhaust the pool & image loading has
-        // to wait for these exists
-        // I now only moved it to the thumbnail pool which does
-        // not fix this issue at all (now thumbnail preview stalls)
-        // we could
-        // - create a dedicated pool for exists
-        // - create a dedicated pool for image loading
-        DkThumbsThreadPool::pool(),		// hook it to the thumbs pool
-#endif
-		&DkUtils::checkFile, file);
+	// if we have a lot of mounted files (windows) in the history
+	// these checks can stall - the thumbnail class is limited
+	// so that they never block decoding the current image
+	QFuture<bool> future = DkDecodeScheduler::instance().run<bool>(
+		DkDecodeScheduler::priority_thumbnail, 
+		[file]() { return checkFile(file); });
 
 	for (int idx = 0; idx < waitMs; idx++) {
 		if (future.isFinished())
@@ -149,6 +149,7 @@ public:
 	static bool compRandom(const QFileInfo& lhf, const QFileInfo& rhf);
 
 	static bool naturalCompare(const QString& s1, const QString& s2, Qt::CaseSensitivity cs = Qt::CaseSensitive);
+	static QString naturalSortKey(const QString& str);
 
 	static QString resolveSymLink(const QString& filePath);
 
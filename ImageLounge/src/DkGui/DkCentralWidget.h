@@ -148,6 +148,7 @@ signals:
 	void imageUpdatedSignal(QSharedPointer<DkImageContainerT>) const;
 	void imageLoadedSignal(QSharedPointer<DkImageContainerT>) const;
 	void imageHasGPSSignal(bool) const;
+	void imageHasSidecarSignal(bool) const;
 	
 public slots:
 	void imageLoaded(QSharedPointer<DkImageContainerT> img);
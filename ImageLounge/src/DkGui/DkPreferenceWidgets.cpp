@@ -1380,10 +1380,22 @@ void DkAdvancedPreference::createLayout() {
 		tr("NOTE: this allows for rotating JPGs without losing information."));
 	cbSaveExif->setChecked(DkSettingsManager::param().metaData().saveExifOrientation);
 
+	QCheckBox* cbProgressive = new QCheckBox(tr("Show Previews while Loading"), this);
+	cbProgressive->setObjectName("progressiveLoading");
+	cbProgressive->setToolTip(tr("If checked, embedded previews of RAW images and previews of large JPGs are shown while the image is loaded"));
+	cbProgressive->setChecked(DkSettingsManager::param().resources().progressiveLoading);
+
+	QCheckBox* cbCacheThumbs = new QCheckBox(tr("Cache Thumbnails"), this);
+	cbCacheThumbs->setObjectName("cacheThumbs");
+	cbCacheThumbs->setToolTip(tr("If checked, thumbnails are stored in the system's thumbnail cache so that folders open faster"));
+	cbCacheThumbs->setChecked(DkSettingsManager::param().resources().cacheThumbs);
+
 	DkGroupWidget* loadFileGroup = new DkGroupWidget(tr("File Loading/Saving"), this);
 	loadFileGroup->addWidget(cbSaveDeleted);
 	loadFileGroup->addWidget(cbIgnoreExif);
 	loadFileGroup->addWidget(cbSaveExif);
+	loadFileGroup->addWidget(cbProgressive);
+	loadFileGroup->addWidget(cbCacheThumbs);
 
 	// batch processing
 	QSpinBox* sbNumThreads = new QSpinBox(this);
@@ -1429,6 +1441,18 @@ void DkAdvancedPreference::on_loadRaw_buttonClicked(int buttonId) const {
 		DkSettingsManager::param().resources().loadRawThumb = buttonId;
 }
 
+void DkAdvancedPreference::on_progressiveLoading_toggled(bool checked) const {
+
+	if (DkSettingsManager::param().resources().progressiveLoading != checked)
+		DkSettingsManager::param().resources().progressiveLoading = checked;
+}
+
+void DkAdvancedPreference::on_cacheThumbs_toggled(bool checked) const {
+
+	if (DkSettingsManager::param().resources().cacheThumbs != checked)
+		DkSettingsManager::param().resources().cacheThumbs = checked;
+}
+
 void DkAdvancedPreference::on_filterRaw_toggled(bool checked) const {
 
 	if (DkSettingsManager::param().resources().filterRawImages != checked)
@@ -272,6 +272,8 @@ public slots:
 	void on_saveDeleted_toggled(bool checked) const;
 	void on_ignoreExif_toggled(bool checked) const;
 	void on_saveExif_toggled(bool checked) const;
+	void on_progressiveLoading_toggled(bool checked) const;
+	void on_cacheThumbs_toggled(bool checked) const;
 	void on_useLog_toggled(bool checked) const;
 	void on_logFolder_clicked() const;
 	void on_numThreads_valueChanged(int val) const;
@@ -39,6 +39,7 @@
 
 #include "DkBasicLoader.h"
 #include "DkDialog.h"
+#include "DkScheduler.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QTimer>
@@ -59,8 +60,9 @@
 #include <QMessageBox>
 #include <QInputDialog>
 #include <QMimeData>
-#include <QThreadPool>
 #include <QPushButton>
+
+#include <algorithm>
 #pragma warning(pop)		// no warnings from includes - end
 
 namespace nmc {
@@ -97,6 +99,10 @@ void DkFilePreview::init() {
 	scrollToCurrentImage = false;
 	isPainted = false;
 
+	stripFileIdx = -1;
+	stripDirty = true;
+	layoutDirty = true;
+
 	winPercent = 0.1f;
 	borderTrigger = (orientation == Qt::Horizontal) ? (float)width()*winPercent : (float)height()*winPercent;
 
@@ -171,6 +177,8 @@ void DkFilePreview::initOrientations() {
 	worldMatrix.reset();
 	currentDx = 0;
 	scrollToCurrentImage = true;
+	layoutDirty = true;
+	fadeMask = QImage();
 	update();
 
 }
@@ -238,8 +246,12 @@ void DkFilePreview::paintEvent(QPaintEvent*) {
 		else
 			setMaximumSize(minHeight, QWIDGETSIZE_MAX);
 
+		layoutDirty = true;
 	}
 
+	if (layoutDirty)
+		layoutThumbs();
+
 	QPainter painter(this);
 	painter.setBackground(DkSettingsManager::param().display().hudBgColor);
 
@@ -251,16 +263,62 @@ void DkFilePreview::paintEvent(QPaintEvent*) {
 		painter.drawRect(r);
 	}
 
+	if (thumbRects.empty())
+		return;
+
+	// the strip is only re-rendered if its content changed or we scrolled out of the cache
+	QRectF viewRect = worldMatrix.inverted().mapRect(QRectF(rect()));
+
+	if (stripDirty || stripFileIdx != currentFileIdx || !QRectF(stripCacheRect).contains(viewRect))
+		renderStrip(viewRect);
+
+	fetchVisibleThumbs(viewRect);
+
+	int dpr = devicePixelRatio();
+	if (frameBuffer.size() != size()*dpr) {
+		frameBuffer = QImage(size()*dpr, QImage::Format_ARGB32_Premultiplied);
+		frameBuffer.setDevicePixelRatio(dpr);
+	}
+
+	if (fadeMask.size() != frameBuffer.size())
+		createFadeMask();
+
+	frameBuffer.fill(Qt::transparent);
+
+	QPainter fp(&frameBuffer);
+	fp.drawImage(worldMatrix.map(QPointF(stripCacheRect.topLeft())), stripCache);
+
+	// show that there are more images...
+	// the left fade-out is only needed if thumbs were scrolled out
+	QRect mr = fadeMask.rect();
+	float translation = orientation == Qt::Horizontal ? (float)worldMatrix.dx() : (float)worldMatrix.dy();
+	int borderTriggerI = qRound(borderTrigger);
+
+	if (translation >= 0) {
+		if (orientation == Qt::Horizontal)
+			mr.setLeft(borderTriggerI*dpr);
+		else
+			mr.setTop(borderTriggerI*dpr);
+	}
+
+	fp.setCompositionMode(QPainter::CompositionMode_DestinationIn);
+	fp.drawImage(QRectF(QPointF(mr.topLeft())/dpr, QSizeF(mr.size())/dpr), fadeMask, mr);
+	fp.end();
+
+	painter.drawImage(QPoint(), frameBuffer);
+
 	painter.setWorldTransform(worldMatrix);
 	painter.setWorldMatrixEnabled(true);
 
-	if (mThumbs.empty()) {
-		thumbRects.clear();
-		return;
-	}
+	// mouse over effect
+	QPoint p = worldMatrix.inverted().map(mapFromGlobal(QCursor::pos()));
 
-	painter.setRenderHint(QPainter::SmoothPixmapTransform);
-	drawThumbs(&painter);
+	if (selected >= 0 && selected < thumbRects.size() && selected != currentFileIdx && thumbRects.at(selected).contains(p))
+		drawSelectedEffect(&painter, thumbRects.at(selected));
+
+	// update file rect for move to current file timer
+	if (scrollToCurrentImage && currentFileIdx >= 0 && currentFileIdx < thumbRects.size())
+		newFileRect = worldMatrix.mapRect(thumbRects.at(currentFileIdx));
 
 	if (currentFileIdx != oldFileIdx && currentFileIdx >= 0) {
 		oldFileIdx = currentFileIdx;
@@ -271,51 +329,40 @@ void DkFilePreview::paintEvent(QPaintEvent*) {
 
 }
 
-void DkFilePreview::drawThumbs(QPainter* painter) {
-
-	//qDebug() << "drawing thumbs: " << worldMatrix.dx();
+/**
+ * Computes the thumbnail rectangles (strip coordinates) of all thumbs.
+ * This is only needed if thumbs arrive or the strip is resized.
+ **/ 
+void DkFilePreview::layoutThumbs() {
 
 	bufferDim = (orientation == Qt::Horizontal) ? QRectF(QPointF(0, yOffset/2), QSize(xOffset, 0)) : QRectF(QPointF(yOffset/2, 0), QSize(0, xOffset));
 	thumbRects.clear();
+	thumbRects.reserve(mThumbs.size());
 
-	DkTimer dt;
-
-	// mouse over effect
-	QPoint p = worldMatrix.inverted().map(mapFromGlobal(QCursor::pos()));
+	int ts = DkSettingsManager::param().effectiveThumbSize(this);
 
 	for (int idx = 0; idx < mThumbs.size(); idx++) {
 
-		QSharedPointer<DkThumbNailT> thumb = mThumbs.at(idx)->getThumb();
-		QImage img;
-		
-		// if the image is loaded draw that (it might be edited)
-		if (mThumbs.at(idx)->hasImage()) {
-			img = mThumbs.at(idx)->imageScaledToHeight(DkSettingsManager::param().effectiveThumbSize(this));
-		}
-		else {
-
-			if (thumb->hasImage() == DkThumbNail::exists_not) {
-				thumbRects.push_back(QRectF());
-				continue;
-			}
+		QImage img = thumbImage(idx);
 
-			if (thumb->hasImage() == DkThumbNail::loaded)
-				img = thumb->getImage();
+		// keep thumbRects aligned with mThumbs
+		if (img.isNull() && mThumbs.at(idx)->getThumb()->hasImage() == DkThumbNail::exists_not) {
+			thumbRects.push_back(QRectF());
+			continue;
 		}
 
-		//if (img.width() > max_thumb_size * DkSettingsManager::param().dpiScaleFactor())
-		//	qDebug() << thumb->getFilePath() << "size:" << img.size();
-
 		QPointF anchor = orientation == Qt::Horizontal ? bufferDim.topRight() : bufferDim.bottomLeft();
-		QRectF r = !img.isNull() ? QRectF(anchor, img.size()) : QRectF(anchor, QSize(DkSettingsManager::param().effectiveThumbSize(this), DkSettingsManager::param().effectiveThumbSize(this)));
+		QRectF r = !img.isNull() ? QRectF(anchor, img.size()) : QRectF(anchor, QSize(ts, ts));
 		if (orientation == Qt::Horizontal && height()-yOffset < r.height()*2)
 			r.setSize(QSizeF(qFloor(r.width()*(float)(height()-yOffset)/r.height()), height()-yOffset));
 		else if (orientation == Qt::Vertical && width()-yOffset < r.width()*2)
 			r.setSize(QSizeF(width()-yOffset, qFloor(r.height()*(float)(width()-yOffset)/r.width())));
 
 		// check if the size is still valid
-		if (r.width() < 1 || r.height() < 1) 
-			continue;	// this brings us in serious problems with the selection
+		if (r.width() < 1 || r.height() < 1) {
+			thumbRects.push_back(QRectF());
+			continue;
+		}
 
 		// center vertically
 		if (orientation == Qt::Horizontal)
@@ -329,58 +376,126 @@ void DkFilePreview::drawThumbs(QPainter* painter) {
 		else
 			bufferDim.setBottom(qFloor(bufferDim.bottom() + r.height()) + qCeil(xOffset/2.0f));
 		thumbRects.push_back(r);
+	}
 
-		QRectF imgWorldRect = worldMatrix.mapRect(r);
+	layoutDirty = false;
+	stripDirty = true;
+}
 
-		// update file rect for move to current file timer
-		if (scrollToCurrentImage && idx == currentFileIdx)
-			newFileRect = imgWorldRect;
+/**
+ * Renders the thumbs around the view rectangle to the strip cache.
+ * Three screens are cached so that scrolling is a blit most of the time.
+ * @param viewRect the visible part of the strip (strip coordinates).
+ **/ 
+void DkFilePreview::renderStrip(const QRectF& viewRect) {
 
-		// is the current image within the canvas?
-		if ((orientation == Qt::Horizontal && imgWorldRect.right() < 0) ||
-			(orientation == Qt::Vertical && imgWorldRect.bottom() < 0)) {
-			continue;
-		}
+	DkTimer dt;
+
+	QRectF cr = viewRect;
+	if (orientation == Qt::Horizontal)
+		cr.adjust(-viewRect.width(), 0, viewRect.width(), 0);
+	else
+		cr.adjust(0, -viewRect.height(), 0, viewRect.height());
+	stripCacheRect = cr.toAlignedRect();
+
+	int dpr = devicePixelRatio();
+	if (stripCache.size() != stripCacheRect.size()*dpr) {
+		stripCache = QImage(stripCacheRect.size()*dpr, QImage::Format_ARGB32_Premultiplied);
+		stripCache.setDevicePixelRatio(dpr);
+	}
+	stripCache.fill(Qt::transparent);
+
+	QPainter painter(&stripCache);
+	painter.setRenderHint(QPainter::SmoothPixmapTransform);
+	painter.setPen(Qt::NoPen);
+	painter.translate(-stripCacheRect.topLeft());
+
+	for (int idx = 0; idx < thumbRects.size(); idx++) {
+
+		const QRectF& r = thumbRects.at(idx);
 
-		if (((orientation == Qt::Horizontal && imgWorldRect.left() > width()) ||
-			(orientation == Qt::Vertical && imgWorldRect.top() > height())) && scrollToCurrentImage) {
+		if (r.isNull())
 			continue;
-		}
-		else if ((orientation == Qt::Horizontal && imgWorldRect.left() > width()) ||
-			(orientation == Qt::Vertical && imgWorldRect.top() > height())) {
-			break;
-		}
 
-		// only fetch thumbs if we are not moving too fast...
-		if (thumb->hasImage() == DkThumbNail::not_loaded && fabs(currentDx) < 40) {
-			thumb->fetchThumb();
-			connect(thumb.data(), SIGNAL(thumbLoadedSignal()), this, SLOT(update()));
-		}
+		// is the current image within the cache?
+		if ((orientation == Qt::Horizontal && r.left() > stripCacheRect.right()) ||
+			(orientation == Qt::Vertical && r.top() > stripCacheRect.bottom()))
+			break;
+		else if (!r.intersects(QRectF(stripCacheRect)))
+			continue;
 
-		bool isLeftGradient = (orientation == Qt::Horizontal && worldMatrix.dx() < 0 && imgWorldRect.left() < leftGradient.finalStop().x()) ||
-			(orientation == Qt::Vertical && worldMatrix.dy() < 0 && imgWorldRect.top() < leftGradient.finalStop().y());
-		bool isRightGradient = (orientation == Qt::Horizontal && imgWorldRect.right() > rightGradient.start().x()) ||
-			(orientation == Qt::Vertical && imgWorldRect.bottom() > rightGradient.start().y());
-		// show that there are more images...
-		if (isLeftGradient && !img.isNull())
-			drawFadeOut(leftGradient, imgWorldRect, &img);
-		if (isRightGradient && !img.isNull())
-			drawFadeOut(rightGradient, imgWorldRect, &img);
+		QImage img = thumbImage(idx);
 
 		if (!img.isNull())
-			painter->drawImage(r, img, QRect(QPoint(), img.size()));
+			painter.drawImage(r, img, QRect(QPoint(), img.size()));
 		else 
-			drawNoImgEffect(painter, r);
-				
+			drawNoImgEffect(&painter, r);
+
 		if (idx == currentFileIdx)
-			drawCurrentImgEffect(painter, r);
-		else if (idx == selected && r.contains(p))
-			drawSelectedEffect(painter, r);
+			drawCurrentImgEffect(&painter, r);
+	}
+
+	stripDirty = false;
+	stripFileIdx = currentFileIdx;
+
+	qDebug() << "[DkFilePreview] strip rendered in" << dt;
+}
+
+void DkFilePreview::fetchVisibleThumbs(const QRectF& viewRect) {
+
+	// only fetch thumbs if we are not moving too fast...
+	if (fabs(currentDx) >= 40)
+		return;
+
+	for (int idx = 0; idx < thumbRects.size(); idx++) {
+
+		const QRectF& r = thumbRects.at(idx);
 
-		//painter->fillRect(QRect(0,0,200, 110), leftGradient);
+		if (r.isNull())
+			continue;
+
+		if ((orientation == Qt::Horizontal && r.left() > viewRect.right()) ||
+			(orientation == Qt::Vertical && r.top() > viewRect.bottom()))
+			break;
+		else if (!r.intersects(viewRect))
+			continue;
+
+		QSharedPointer<DkThumbNailT> thumb = mThumbs.at(idx)->getThumb();
+
+		if (thumb->hasImage() == DkThumbNail::not_loaded) {
+			connect(thumb.data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded()), Qt::UniqueConnection);
+			thumb->fetchThumb();
+		}
 	}
 }
 
+/**
+ * Returns the image that represents a thumb in the strip.
+ * If the image is loaded it is preferred over the thumbnail (it might be edited).
+ * @param idx the thumb's index.
+ * @return QImage the image or a null image if the thumb is not loaded yet.
+ **/ 
+QImage DkFilePreview::thumbImage(int idx) {
+
+	if (mThumbs.at(idx)->hasImage())
+		return mThumbs.at(idx)->imageScaledToHeight(DkSettingsManager::param().effectiveThumbSize(this));
+
+	QSharedPointer<DkThumbNailT> thumb = mThumbs.at(idx)->getThumb();
+
+	// the pyramid level that is large enough for the strip
+	if (thumb->hasImage() == DkThumbNail::loaded)
+		return thumb->getImage(orientation == Qt::Horizontal ? height()-yOffset : width()-yOffset);
+
+	return QImage();
+}
+
+void DkFilePreview::thumbLoaded() {
+
+	// the thumb's size might differ from its placeholder
+	layoutDirty = true;
+	update();
+}
+
 void DkFilePreview::drawNoImgEffect(QPainter* painter, const QRectF& r) {
 
 	QBrush oldBrush = painter->brush();
@@ -436,39 +551,34 @@ void DkFilePreview::drawCurrentImgEffect(QPainter* painter, const QRectF& r) {
 	painter->setPen(oldPen);
 }
 
-void DkFilePreview::drawFadeOut(QLinearGradient gradient, QRectF imgRect, QImage *img) {
+/**
+ * Creates the alpha mask that fades out thumbs at the borders.
+ * It is applied to the whole strip at once.
+ **/ 
+void DkFilePreview::createFadeMask() {
 
-	if (img && img->format() == QImage::Format_Indexed8)
-		return;
+	int dpr = devicePixelRatio();
+	fadeMask = QImage(size()*dpr, QImage::Format_ARGB32_Premultiplied);
+	fadeMask.setDevicePixelRatio(dpr);
+	fadeMask.fill(Qt::black);
 
-	// compute current scaling
-	QPointF scale(img->width()/imgRect.width(), img->height()/imgRect.height());
-	QTransform wm;
-	wm.scale(scale.x(), scale.y());
-	
-	if (orientation == Qt::Horizontal)
-		wm.translate(-imgRect.left(), 0);
-	else
-		wm.translate(0, -imgRect.top());
+	// the gradients' colors are alpha values (black is transparent)
+	QLinearGradient lg = leftGradient;
+	lg.setColorAt(0, Qt::transparent);
+	lg.setColorAt(1, Qt::black);
 
-	QLinearGradient imgGradient = gradient;
-	
-	if (orientation == Qt::Horizontal) {
-		imgGradient.setStart(wm.map(gradient.start()).x(), 0);
-		imgGradient.setFinalStop(wm.map(gradient.finalStop()).x(), 0);
-	}
-	else {
-		imgGradient.setStart(0, wm.map(gradient.start()).y());
-		imgGradient.setFinalStop(0, wm.map(gradient.finalStop()).y());
-	}
+	QLinearGradient rg = rightGradient;
+	rg.setColorAt(0, Qt::black);
+	rg.setColorAt(1, Qt::transparent);
 
-	QImage mask = *img;
-	QPainter painter(&mask);
-	painter.fillRect(img->rect(), Qt::black);
-	painter.fillRect(img->rect(), imgGradient);
-	painter.end();
+	int borderTriggerI = qRound(borderTrigger);
+	QRect lr = (orientation == Qt::Horizontal) ? QRect(0, 0, borderTriggerI, height()) : QRect(0, 0, width(), borderTriggerI);
+	QRect rr = (orientation == Qt::Horizontal) ? QRect(width()-borderTriggerI, 0, borderTriggerI, height()) : QRect(0, height()-borderTriggerI, width(), borderTriggerI);
 
-	img->setAlphaChannel(mask);
+	QPainter painter(&fadeMask);
+	painter.setCompositionMode(QPainter::CompositionMode_Source);
+	painter.fillRect(lr, lg);
+	painter.fillRect(rr, rg);
 }
 
 void DkFilePreview::resizeEvent(QResizeEvent *event) {
@@ -492,6 +602,8 @@ void DkFilePreview::resizeEvent(QResizeEvent *event) {
 	leftGradient.setFinalStop((orientation == Qt::Horizontal) ? QPoint(borderTriggerI, 0) : QPoint(0, borderTriggerI));
 	rightGradient.setStart((orientation == Qt::Horizontal) ? QPoint(width()-borderTriggerI, 0) : QPoint(0, height()-borderTriggerI));
 	rightGradient.setFinalStop((orientation == Qt::Horizontal) ?  QPoint(width(), 0) : QPoint(0, height()));
+	layoutDirty = true;
+	fadeMask = QImage();
 
 	//update();
 	QWidget::resizeEvent(event);
@@ -667,6 +779,7 @@ void DkFilePreview::wheelEvent(QWheelEvent *event) {
 
 		if (newSize != DkSettingsManager::param().display().thumbSize) {
 			DkSettingsManager::param().display().thumbSize = newSize;
+			layoutDirty = true;
 			update();
 		}
 	}
@@ -836,6 +949,9 @@ void DkFilePreview::setFileInfo(QSharedPointer<DkImageContainerT> cImage) {
 	currentFileIdx = tIdx;
 	if (currentFileIdx >= 0)
 		scrollToCurrentImage = true;
+
+	// the image might be edited
+	layoutDirty = true;
 	update();
 
 }
@@ -851,6 +967,7 @@ void DkFilePreview::updateThumbs(QVector<QSharedPointer<DkImageContainerT> > thu
 		}
 	}
 
+	layoutDirty = true;
 	update();
 }
 
@@ -865,11 +982,19 @@ void DkFilePreview::setVisible(bool visible, bool saveSettings) {
 DkThumbLabel::DkThumbLabel(QSharedPointer<DkThumbNailT> thumb, QGraphicsItem* parent) : QGraphicsObject(parent), mText(this) {
 
 	mThumbInitialized = false;
-	mFetchingThumb = false;
 	mIsHovered = false;
 
+	// style dummy
+	mNoImagePen.setColor(QColor(150,150,150));
+	mNoImageBrush = QColor(100,100,100,50);
+
+	QColor col = DkSettingsManager::param().display().highlightColor;
+	col.setAlpha(90);
+	mSelectBrush = col;
+	mSelectPen.setColor(DkSettingsManager::param().display().highlightColor);
+
+	// the selection is kept by the scene (labels are recycled)
 	setThumb(thumb);
-	setFlag(ItemIsSelectable, true);
 
 #if QT_VERSION < 0x050000
 	setAcceptsHoverEvents(true);
@@ -882,27 +1007,35 @@ DkThumbLabel::~DkThumbLabel() {}
 
 void DkThumbLabel::setThumb(QSharedPointer<DkThumbNailT> thumb) {
 
+	if (mThumb)
+		disconnect(mThumb.data(), SIGNAL(thumbLoadedSignal()), this, SLOT(updateLabel()));
+
+	// reset everything that belongs to the previous thumb
 	this->mThumb = thumb;
+	mThumbInitialized = false;
+	mIsHovered = false;
+	mIcon.setPixmap(QPixmap());
+	mLevelSize = QSize();
+	mText.setPlainText("");
+	setToolTip("");
 
 	if (thumb.isNull())
 		return;
 
 	connect(thumb.data(), SIGNAL(thumbLoadedSignal()), this, SLOT(updateLabel()));
-	QFileInfo fileInfo(thumb->getFilePath());
-	QString toolTipInfo = tr("Name: ") + fileInfo.fileName() + 
-		"\n" + tr("Size: ") + DkUtils::readableByte((float)fileInfo.size()) + 
-		"\n" + tr("Created: ") + fileInfo.created().toString(Qt::SystemLocaleDate);
+}
 
-	setToolTip(toolTipInfo);
+void DkThumbLabel::setChecked(bool checked) {
 
-	// style dummy
-	mNoImagePen.setColor(QColor(150,150,150));
-	mNoImageBrush = QColor(100,100,100,50);
+	if (mChecked == checked)
+		return;
 
-	QColor col = DkSettingsManager::param().display().highlightColor;
-	col.setAlpha(90);
-	mSelectBrush = col;
-	mSelectPen.setColor(DkSettingsManager::param().display().highlightColor);
+	mChecked = checked;
+	update();
+}
+
+bool DkThumbLabel::isChecked() const {
+	return mChecked;
 }
 
 QPixmap DkThumbLabel::pixmap() const {
@@ -912,7 +1045,8 @@ QPixmap DkThumbLabel::pixmap() const {
 
 void DkThumbLabel::cancelLoading() {
 	
-	mFetchingThumb = false;
+	if (mThumb)
+		mThumb->cancel();
 }
 
 QRectF DkThumbLabel::boundingRect() const {
@@ -936,9 +1070,13 @@ void DkThumbLabel::updateLabel() {
 
 	QPixmap pm;
 
-	if (!mThumb->getImage().isNull()) {
+	// use the pyramid level that fits the current thumb size
+	QImage img = mThumb->getImage(DkSettingsManager::param().effectiveThumbPreviewSize());
+	mLevelSize = img.size();
 
-		pm = QPixmap::fromImage(mThumb->getImage());
+	if (!img.isNull()) {
+
+		pm = QPixmap::fromImage(img);
 
 		if (DkSettingsManager::param().display().displaySquaredThumbs) {
 
@@ -951,10 +1089,7 @@ void DkThumbLabel::updateLabel() {
 	if (!pm.isNull()) {
 		mIcon.setTransformationMode(Qt::SmoothTransformation);
 		mIcon.setPixmap(pm);
-		mIcon.setFlag(ItemIsSelectable, true);
 	}
-	if (pm.isNull())
-		setFlag(ItemIsSelectable, false);	// if we cannot load it -> disable selection
 
 	// update label
 	mText.setPos(0, pm.height());
@@ -973,24 +1108,24 @@ void DkThumbLabel::updateLabel() {
 
 void DkThumbLabel::updateSize() {
 
+	prepareGeometryChange();
+
 	if (mIcon.pixmap().isNull())
 		return;
 
-	prepareGeometryChange();
+	// switch to another pyramid level if the size changed (no need to fetch the thumb again)
+	if (mThumb && mThumb->getImage(DkSettingsManager::param().effectiveThumbPreviewSize()).size() != mLevelSize) {
+		updateLabel();
+		return;
+	}
 
-	// resize pixmap label
+	// resize pixmap label - always re-center since recycled labels get pixmaps with other aspect ratios
 	int maxSize = qMax(mIcon.pixmap().width(), mIcon.pixmap().height());
 	int ps = DkSettingsManager::param().effectiveThumbPreviewSize();
+	float s = (float)ps/maxSize;
 
-	if ((float)ps/maxSize != mIcon.scale()) {
-		mIcon.setScale(1.0f);
-		mIcon.setPos(0,0);
-
-		mIcon.setScale((float)ps/maxSize);
-		mIcon.moveBy((ps-mIcon.pixmap().width()*mIcon.scale())*0.5f, (ps-mIcon.pixmap().height()*mIcon.scale())*0.5);
-	}
-
-	//update();
+	mIcon.setScale(s);
+	mIcon.setPos((ps-mIcon.pixmap().width()*s)*0.5f, (ps-mIcon.pixmap().height()*s)*0.5f);
 }	
 
 void DkThumbLabel::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
@@ -1003,6 +1138,19 @@ void DkThumbLabel::mouseDoubleClickEvent(QGraphicsSceneMouseEvent *event) {
 
 void DkThumbLabel::hoverEnterEvent(QGraphicsSceneHoverEvent*) {
 
+	if (mThumb.isNull())
+		return;
+
+	// the tool tip is created lazily - binding labels while scrolling should not stat files
+	if (toolTip().isEmpty()) {
+		QFileInfo fileInfo(mThumb->getFilePath());
+		QString toolTipInfo = tr("Name: ") + fileInfo.fileName() + 
+			"\n" + tr("Size: ") + DkUtils::readableByte((float)fileInfo.size()) + 
+			"\n" + tr("Created: ") + fileInfo.created().toString(Qt::SystemLocaleDate);
+
+		setToolTip(toolTipInfo);
+	}
+
 	mIsHovered = true;
 	emit showFileSignal(mThumb->getFilePath());
 	update();
@@ -1023,11 +1171,11 @@ void DkThumbLabel::setVisible(bool visible) {
 
 void DkThumbLabel::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) {
 	
-	if (!mFetchingThumb && mThumb->hasImage() == DkThumbNail::not_loaded) {
-			mThumb->fetchThumb();
-			mFetchingThumb = true;
-	}
-	else if (!mThumbInitialized && (mThumb->hasImage() == DkThumbNail::loaded || mThumb->hasImage() == DkThumbNail::exists_not)) {
+	if (mThumb.isNull())
+		return;
+
+	// thumbs are requested by the scene (see DkThumbScene::updateVisibleThumbs)
+	if (!mThumbInitialized && (mThumb->hasImage() == DkThumbNail::loaded || mThumb->hasImage() == DkThumbNail::exists_not)) {
 		updateLabel();
 		mThumbInitialized = true;
 		return;		// exit - otherwise we get paint errors
@@ -1093,7 +1241,7 @@ void DkThumbLabel::paint(QPainter* painter, const QStyleOptionGraphicsItem* opti
 	}
 
 	// render selected
-	if (isSelected()) {
+	if (mChecked) {
 		painter->setBrush(mSelectBrush);
 		painter->setPen(mSelectPen);
 		painter->drawRect(boundingRect());
@@ -1101,16 +1249,123 @@ void DkThumbLabel::paint(QPainter* painter, const QStyleOptionGraphicsItem* opti
 
 }
 
+// DkThumbSelection --------------------------------------------------------------------
+void DkThumbSelection::clear() {
+	mRanges.clear();
+}
+
+/**
+ * Selects (or deselects) all indexes in [from to].
+ * @param from the first index.
+ * @param to the last index (inclusive).
+ * @param select if false, the indexes are removed from the selection.
+ **/ 
+void DkThumbSelection::select(int from, int to, bool select) {
+
+	if (from > to)
+		qSwap(from, to);
+
+	QVector<QPair<int, int> > ranges;
+
+	// keep everything outside [from to]
+	for (const QPair<int, int>& r : mRanges) {
+
+		if (r.second < from || r.first > to) {
+			ranges << r;
+			continue;
+		}
+
+		if (r.first < from)
+			ranges << qMakePair(r.first, from-1);
+		if (r.second > to)
+			ranges << qMakePair(to+1, r.second);
+	}
+
+	if (select)
+		ranges << qMakePair(from, to);
+
+	std::sort(ranges.begin(), ranges.end());
+
+	// merge overlapping & adjacent ranges
+	mRanges.clear();
+	for (const QPair<int, int>& r : ranges) {
+
+		if (!mRanges.empty() && mRanges.last().second+1 >= r.first)
+			mRanges.last().second = qMax(mRanges.last().second, r.second);
+		else
+			mRanges << r;
+	}
+}
+
+bool DkThumbSelection::contains(int idx) const {
+
+	// find the last range that starts before idx
+	auto it = std::upper_bound(mRanges.constBegin(), mRanges.constEnd(), idx, 
+		[](int i, const QPair<int, int>& r) { return i < r.first; });
+
+	if (it == mRanges.constBegin())
+		return false;
+
+	--it;
+	return idx <= it->second;
+}
+
+bool DkThumbSelection::isEmpty() const {
+	return mRanges.empty();
+}
+
+int DkThumbSelection::count() const {
+
+	int c = 0;
+	for (const QPair<int, int>& r : mRanges)
+		c += r.second - r.first + 1;
+
+	return c;
+}
+
+int DkThumbSelection::first() const {
+	return mRanges.empty() ? -1 : mRanges.first().first;
+}
+
+int DkThumbSelection::last() const {
+	return mRanges.empty() ? -1 : mRanges.last().second;
+}
+
+/**
+ * Returns the selected indexes (ascending).
+ * @param max the maximal number of indexes returned (-1 returns all).
+ **/ 
+QVector<int> DkThumbSelection::indexes(int max) const {
+
+	QVector<int> idxs;
+
+	for (const QPair<int, int>& r : mRanges) {
+		for (int idx = r.first; idx <= r.second; idx++) {
+
+			if (max != -1 && idxs.size() >= max)
+				return idxs;
+			idxs << idx;
+		}
+	}
+
+	return idxs;
+}
+
 // DkThumbWidget --------------------------------------------------------------------
 DkThumbScene::DkThumbScene(QWidget* parent /* = 0 */) : QGraphicsScene(parent) {
 
 	setObjectName("DkThumbWidget");
 
+	mThumbQueue = new DkThumbRequestQueue(this);
 }
 
+/**
+ * Computes the grid.
+ * Only labels of the visible rows exist, so this is independent of the folder size.
+ **/ 
 void DkThumbScene::updateLayout() {
 
-	if (mThumbLabels.empty())
+	if (mThumbs.empty())
 		return;
 
 	QSize pSize;
@@ -1121,44 +1376,159 @@ void DkThumbScene::updateLayout() {
     int psz = DkSettingsManager::param().effectiveThumbPreviewSize();
 	mXOffset = 2;// qCeil(psz*0.1f);
 	mNumCols = qMax(qFloor(((float)pSize.width()-mXOffset)/(psz + mXOffset)), 1);
-	mNumCols = qMin(mThumbLabels.size(), mNumCols);
-	mNumRows = qCeil((float)mThumbLabels.size()/mNumCols);
+	mNumCols = qMin(mThumbs.size(), mNumCols);
+	mNumRows = qCeil((float)mThumbs.size()/mNumCols);
 
 	int tso = psz+mXOffset;
 	setSceneRect(0, 0, mNumCols*tso+mXOffset, mNumRows*tso+mXOffset);
 
-	DkTimer dt;
-	int cYOffset = mXOffset;
+	// move bound labels - all others are placed when they get visible
+	for (auto it = mThumbLabels.constBegin(); it != mThumbLabels.constEnd(); it++) {
+		it.value()->setPos(thumbRect(it.key()).topLeft());
+		it.value()->updateSize();
+	}
 
-	for (int rIdx = 0; rIdx < mNumRows; rIdx++) {
+	if (!mSelection.isEmpty())
+		ensureVisible(mSelection.last());
 
-		int cXOffset = mXOffset;
+	updateVisibleThumbs();
 
-		for (int cIdx = 0; cIdx < mNumCols; cIdx++) {
+	mFirstLayout = false;
+}
 
-			int tIdx = rIdx*mNumCols+cIdx;
+/**
+ * Binds labels to the thumbs of the visible rows (plus a margin).
+ * Labels of rows that scrolled out are recycled.
+ **/ 
+void DkThumbScene::updateVisibleThumbs() {
 
-			if (tIdx < 0 || tIdx >= mThumbLabels.size())
-				break;
+	if (views().empty() || mThumbs.empty() || mNumCols <= 0)
+		return;
 
-			DkThumbLabel* cLabel = mThumbLabels.at(tIdx);
-			cLabel->setPos(cXOffset, cYOffset);
-			cLabel->updateSize();
+	QGraphicsView* view = views().first();
+	QRectF vr = view->mapToScene(view->viewport()->rect()).boundingRect();
+	int tso = DkSettingsManager::param().effectiveThumbPreviewSize() + mXOffset;
 
-			cXOffset += psz + mXOffset;
-		}
+	int firstRow = qMax(qFloor(vr.top()/tso) - row_margin, 0);
+	int lastRow = qMin(qFloor(vr.bottom()/tso) + row_margin, mNumRows-1);
+	int firstIdx = firstRow*mNumCols;
+	int lastIdx = qMin((lastRow+1)*mNumCols, mThumbs.size())-1;
+
+	for (int idx : mThumbLabels.keys()) {
+		if (idx < firstIdx || idx > lastIdx)
+			releaseLabel(idx);
+	}
 
-		// update ypos
-		cYOffset += psz + mXOffset;	// 20 for label 
+	for (int idx = firstIdx; idx <= lastIdx; idx++) {
+		if (!mThumbLabels.contains(idx))
+			bindLabel(idx);
 	}
 
-	for (int idx = 0; idx < mThumbLabels.size(); idx++) {
+	// remember the scroll direction for prefetching
+	if (vr.top() != mLastViewTop)
+		mScrollDir = vr.top() > mLastViewTop ? 1 : -1;
+	mLastViewTop = vr.top();
+
+	int numRows = qMax(qCeil(vr.height()/tso), 1);
+	int pFirstRow = mScrollDir > 0 ? lastRow+1 : qMax(firstRow-numRows, 0);
+	int pLastRow = mScrollDir > 0 ? qMin(lastRow+numRows, mNumRows-1) : firstRow-1;
+
+	requestThumbs(pFirstRow*mNumCols, qMin((pLastRow+1)*mNumCols, mThumbs.size())-1, vr);
+}
+
+/**
+ * Requests the thumbs of all bound labels and the prefetched thumbs 
+ * ordered by their distance to the viewport center.
+ * Hence, the visible area is filled first - even if the user scrolls fast.
+ * @param firstIdx the first prefetched thumb
+ * @param lastIdx the last prefetched thumb (inclusive)
+ * @param viewRect the visible scene rect
+ **/ 
+void DkThumbScene::requestThumbs(int firstIdx, int lastIdx, const QRectF& viewRect) {
+
+	int tso = DkSettingsManager::param().effectiveThumbPreviewSize() + mXOffset;
+	QPointF c = viewRect.center();
+
+	// the rank is the distance in thumbs
+	auto rank = [&](int idx) {
+		QPointF d = thumbRect(idx).center() - c;
+		return qRound(qSqrt(d.x()*d.x() + d.y()*d.y())/tso);
+	};
 
-		if (mThumbLabels.at(idx)->isSelected())
-			mThumbLabels.at(idx)->ensureVisible();
+	QVector<DkThumbRequestQueue::Request> requests;
+
+	for (auto it = mThumbLabels.constBegin(); it != mThumbLabels.constEnd(); it++) {
+		DkThumbRequestQueue::Request r = {it.value()->getThumb(), rank(it.key())};
+		requests << r;
 	}
 
-	mFirstLayout = false;
+	for (int idx = qMax(firstIdx, 0); idx <= lastIdx; idx++) {
+		DkThumbRequestQueue::Request r = {mThumbs.at(idx)->getThumb(), rank(idx)};
+		requests << r;
+	}
+
+	mThumbQueue->setRequests(requests);
+}
+
+QRectF DkThumbScene::thumbRect(int idx) const {
+
+	if (mNumCols <= 0)
+		return QRectF();
+
+	int psz = DkSettingsManager::param().effectiveThumbPreviewSize();
+	int tso = psz + mXOffset;
+
+	return QRectF(mXOffset + (idx % mNumCols)*tso, mXOffset + (idx / mNumCols)*tso, psz, psz);
+}
+
+void DkThumbScene::bindLabel(int idx) {
+
+	DkThumbLabel* label = 0;
+
+	if (!mLabelPool.empty())
+		label = mLabelPool.takeLast();
+	else {
+		label = new DkThumbLabel();
+		connect(label, SIGNAL(loadFileSignal(const QString&, bool)), this, SIGNAL(loadFileSignal(const QString&, bool)));
+		connect(label, SIGNAL(showFileSignal(const QString&)), this, SLOT(showFile(const QString&)));
+		addItem(label);
+	}
+
+	QSharedPointer<DkThumbNailT> thumb = mThumbs.at(idx)->getThumb();
+	connect(thumb.data(), SIGNAL(thumbLoadedSignal()), this, SIGNAL(thumbLoadedSignal()), Qt::UniqueConnection);
+
+	label->setThumb(thumb);
+	label->setChecked(mSelection.contains(idx));
+	label->setPos(thumbRect(idx).topLeft());
+	label->updateSize();
+	label->show();
+
+	mThumbLabels.insert(idx, label);
+}
+
+void DkThumbScene::releaseLabel(int idx) {
+
+	DkThumbLabel* label = mThumbLabels.take(idx);
+
+	if (!label)
+		return;
+
+	QSharedPointer<DkThumbNailT> thumb = label->getThumb();
+	if (thumb)
+		disconnect(thumb.data(), SIGNAL(thumbLoadedSignal()), this, SIGNAL(thumbLoadedSignal()));
+
+	// running requests are canceled by the request queue
+	label->setThumb(QSharedPointer<DkThumbNailT>());
+	label->setChecked(false);
+	label->hide();
+
+	mLabelPool << label;
+}
+
+void DkThumbScene::updateLabelSelection() {
+
+	for (auto it = mThumbLabels.constBegin(); it != mThumbLabels.constEnd(); it++)
+		it.value()->setChecked(mSelection.contains(it.key()));
 }
 
 void DkThumbScene::updateThumbs(QVector<QSharedPointer<DkImageContainerT> > thumbs) {
@@ -1169,23 +1539,13 @@ void DkThumbScene::updateThumbs(QVector<QSharedPointer<DkImageContainerT> > thum
 
 void DkThumbScene::updateThumbLabels() {
 
-	blockSignals(true);	// do not emit selection changed while clearing!
-	clear();	// deletes the thumbLabels
-	blockSignals(false);
+	mThumbQueue->clear();
 
-	mThumbLabels.clear();
+	// labels are bound to indexes - so recycle all of them
+	for (int idx : mThumbLabels.keys())
+		releaseLabel(idx);
 
-	for (int idx = 0; idx < mThumbs.size(); idx++) {
-		DkThumbLabel* thumb = new DkThumbLabel(mThumbs.at(idx)->getThumb());
-		connect(thumb, SIGNAL(loadFileSignal(const QString&, bool)), this, SIGNAL(loadFileSignal(const QString&, bool)));
-		connect(thumb, SIGNAL(showFileSignal(const QString&)), this, SLOT(showFile(const QString&)));
-		connect(mThumbs.at(idx).data(), SIGNAL(thumbLoadedSignal()), this, SIGNAL(thumbLoadedSignal()));
-
-		//thumb->show();
-		addItem(thumb);
-		mThumbLabels.append(thumb);
-		//thumbsNotLoaded.append(thumb);
-	}
+	mSelection.clear();
 
 	showFile();
 
@@ -1235,7 +1595,7 @@ void DkThumbScene::keyPressEvent(QKeyEvent * event) {
 		break;
 	}
 	case Qt::Key_Right: {
-		selectThumb(qMin(idx + 1, mThumbLabels.size()-1));
+		selectThumb(qMin(idx + 1, mThumbs.size()-1));
 		break;
 	}
 	case Qt::Key_Up: {
@@ -1243,7 +1603,7 @@ void DkThumbScene::keyPressEvent(QKeyEvent * event) {
 		break;
 	}
 	case Qt::Key_Down: {
-		selectThumb(qMin(idx + mNumCols, mThumbLabels.size()-1));
+		selectThumb(qMin(idx + mNumCols, mThumbs.size()-1));
 		break;
 	}
 
@@ -1253,14 +1613,14 @@ void DkThumbScene::keyPressEvent(QKeyEvent * event) {
 void DkThumbScene::showFile(const QString& filePath) {
 
 	if (filePath == QDir::currentPath() || filePath.isEmpty()) {
-		int sf = getSelectedFiles().size();
+		int sf = numSelected();
 
 		QString info;
 
 		if (sf > 1)
 			info = QString::number(sf) + tr(" selected");
 		else
-			info = QString::number(mThumbLabels.size()) + tr(" images");
+			info = QString::number(mThumbs.size()) + tr(" images");
 
 		DkStatusBarManager::instance().setMessage(tr("%1 | %2").arg(info, currentDir()));
 	}
@@ -1274,16 +1634,27 @@ void DkThumbScene::ensureVisible(QSharedPointer<DkImageContainerT> img) const {
 	if (!img)
 		return;
 
-	for (DkThumbLabel* label : mThumbLabels) {
+	for (int idx = 0; idx < mThumbs.size(); idx++) {
 
-		if (label->getThumb()->getFilePath() == img->filePath()) {
-			label->ensureVisible();
+		if (mThumbs.at(idx)->filePath() == img->filePath()) {
+			ensureVisible(idx);
 			break;
 		}
 	}
 
 }
 
+void DkThumbScene::ensureVisible(int idx) const {
+
+	if (idx < 0 || idx >= mThumbs.size())
+		return;
+
+	QRectF r = thumbRect(idx);
+
+	for (QGraphicsView* v : views())
+		v->ensureVisible(r);
+}
+
 QString DkThumbScene::currentDir() const {
 	
 	if (mThumbs.empty() || !mThumbs[0])
@@ -1294,16 +1665,17 @@ QString DkThumbScene::currentDir() const {
 
 int DkThumbScene::selectedThumbIndex(bool first) {
 	
-	int selIdx = -1;
-	for (int idx = 0; idx < mThumbLabels.size(); idx++) {
+	return first ? mSelection.first() : mSelection.last();
+}
 
-		if (first && mThumbLabels[idx]->isSelected())
-			return idx;
-		else if (mThumbLabels[idx]->isSelected())
-			selIdx = idx;
-	}
-	
-	return selIdx;
+int DkThumbScene::numSelected() const {
+
+	return mSelection.count();
+}
+
+bool DkThumbScene::isSelected(int idx) const {
+
+	return mSelection.contains(idx);
 }
 
 void DkThumbScene::toggleThumbLabels(bool show) {
@@ -1352,10 +1724,12 @@ void DkThumbScene::resizeThumbs(float dx) {
 
 void DkThumbScene::cancelLoading() {
 	
-	DkThumbsThreadPool::clear();
+	mThumbQueue->clear();
 
 	for (auto t : mThumbLabels)
 		t->cancelLoading();
+
+	DkDecodeScheduler::instance().clear(DkDecodeScheduler::priority_thumbnail);
 }
 
 void DkThumbScene::selectAllThumbs(bool selected) {
@@ -1365,44 +1739,38 @@ void DkThumbScene::selectAllThumbs(bool selected) {
 
 void DkThumbScene::selectThumbs(bool selected /* = true */, int from /* = 0 */, int to /* = -1 */) {
 
-	if (mThumbLabels.empty())
+	if (mThumbs.empty())
 		return;
 
 	if (to == -1)
-		to = mThumbLabels.size()-1;
+		to = mThumbs.size()-1;
 
-	if (from > to) {
-		int tmp = to;
-		to = from;
-		from = tmp;
-	}
+	from = qBound(0, from, mThumbs.size()-1);
+	to = qBound(0, to, mThumbs.size()-1);
+
+	mSelection.select(from, to, selected);
+	updateLabelSelection();
 
-	blockSignals(true);
-	for (int idx = from; idx <= to && idx < mThumbLabels.size(); idx++) {
-		mThumbLabels.at(idx)->setSelected(selected);
-	}
-	blockSignals(false);
 	emit selectionChanged();
 	showFile();	// update selection label
 }
 
 void DkThumbScene::selectThumb(int idx, bool select) {
 
-	if (mThumbLabels.empty())
+	if (mThumbs.empty())
 		return;
 
-	if (idx < 0 || idx >= mThumbLabels.size()) {
+	if (idx < 0 || idx >= mThumbs.size()) {
 		qWarning() << "index out of bounds in selectThumbs()" << idx;
 		return;
 	}
 
-	blockSignals(true);
-	mThumbLabels[idx]->setSelected(select);
-	blockSignals(false);
+	mSelection.select(idx, idx, select);
+	updateLabelSelection();
 	
 	emit selectionChanged();
 	showFile();	// update selection label
-	ensureVisible(mThumbs[idx]);
+	ensureVisible(idx);
 }
 
 void DkThumbScene::copySelected() const {
@@ -1589,53 +1957,39 @@ void DkThumbScene::renameSelected() const {
 	}
 }
 
-QStringList DkThumbScene::getSelectedFiles() const {
+QStringList DkThumbScene::getSelectedFiles(int max) const {
 
 	QStringList fileList;
 
-	for (int idx = 0; idx < mThumbLabels.size(); idx++) {
-
-		if (mThumbLabels.at(idx) && mThumbLabels.at(idx)->isSelected()) {
-			fileList.append(mThumbLabels.at(idx)->getThumb()->getFilePath());
-		}
-	}
+	for (int idx : mSelection.indexes(max))
+		fileList.append(mThumbs.at(idx)->filePath());
 
 	return fileList;
 }
 
-QVector<DkThumbLabel*> DkThumbScene::getSelectedThumbs() const {
+QVector<QSharedPointer<DkThumbNailT> > DkThumbScene::getSelectedThumbs(int max) const {
 
-	QVector<DkThumbLabel*> selected;
+	QVector<QSharedPointer<DkThumbNailT> > selected;
 
-	for (DkThumbLabel* label : mThumbLabels) {
-		if (label->isSelected())
-			selected << label;
-	}
+	for (int idx : mSelection.indexes(max))
+		selected << mThumbs.at(idx)->getThumb();
 
 	return selected;
 }
 
+/**
+ * Returns the thumb index a label is currently bound to.
+ * @param thumb a label of the scene.
+ * @return int the index or -1 if the label is not bound.
+ **/ 
 int DkThumbScene::findThumb(DkThumbLabel* thumb) const {
 
-	int thumbIdx = -1;
-
-	for (int idx = 0; idx < mThumbLabels.size(); idx++) {
-		if (thumb == mThumbLabels.at(idx)) {
-			thumbIdx = idx;
-			break;
-		}
-	}
-
-	return thumbIdx;
+	return mThumbLabels.key(thumb, -1);
 }
 
 bool DkThumbScene::allThumbsSelected() const {
 
-	for (DkThumbLabel* label : mThumbLabels)
-		if (label->flags() & QGraphicsItem::ItemIsSelectable && !label->isSelected())
-			return false;
-
-	return true;
+	return mSelection.count() == mThumbs.size();
 }
 
 // DkThumbView --------------------------------------------------------------------
@@ -1643,12 +1997,13 @@ DkThumbsView::DkThumbsView(DkThumbScene* scene, QWidget* parent /* = 0 */) : QGr
 
 	setObjectName("DkThumbsView");
 	this->scene = scene;
-	connect(scene, SIGNAL(thumbLoadedSignal()), this, SLOT(fetchThumbs()));
+	connect(verticalScrollBar(), SIGNAL(valueChanged(int)), scene, SLOT(updateVisibleThumbs()));
 
 	setResizeAnchor(QGraphicsView::AnchorUnderMouse);
 	setAcceptDrops(true);
 
 	lastShiftIdx = -1;
+	pressedIdx = -1;
 }
 
 void DkThumbsView::wheelEvent(QWheelEvent *event) {
@@ -1672,14 +2027,43 @@ void DkThumbsView::mousePressEvent(QMouseEvent *event) {
 		mousePos = event->pos();
 	}
 
-	qDebug() << "mouse pressed";
-
 #if QT_VERSION < 0x050000
 	DkThumbLabel* itemClicked = static_cast<DkThumbLabel*>(scene->itemAt(mapToScene(event->pos())));
 #else
 	DkThumbLabel* itemClicked = static_cast<DkThumbLabel*>(scene->itemAt(mapToScene(event->pos()), QTransform()));
 #endif
 
+	// the scene keeps the selection (labels are recycled while scrolling)
+	// so we handle clicks ourselves instead of relying on QGraphicsItem selection
+	int idx = itemClicked ? scene->findThumb(itemClicked) : -1;
+	pressedIdx = -1;
+
+	if (event->button() == Qt::LeftButton && idx != -1) {
+
+		if (event->modifiers() & Qt::ShiftModifier && lastShiftIdx != -1) {
+			scene->selectThumbs(false);
+			scene->selectThumbs(true, lastShiftIdx, idx);
+		}
+		else if (event->modifiers() & Qt::ControlModifier) {
+			scene->selectThumbs(!scene->isSelected(idx), idx, idx);
+			lastShiftIdx = idx;
+		}
+		else {
+			// keep the selection for dragging - it is reduced on release
+			if (scene->isSelected(idx))
+				pressedIdx = idx;
+			else {
+				scene->selectThumbs(false);
+				scene->selectThumbs(true, idx, idx);
+			}
+			lastShiftIdx = idx;
+		}
+	}
+	else if (event->button() == Qt::LeftButton && event->modifiers() == Qt::NoModifier) {
+		scene->selectThumbs(false);
+		lastShiftIdx = -1;
+	}
+
 	// this is a bit of a hack
 	// what we want to achieve: if the user is selecting with e.g. shift or ctrl 
 	// and he clicks (unintentionally) into the background - the selection would be lost
@@ -1702,6 +2086,8 @@ void DkThumbsView::mouseMoveEvent(QMouseEvent *event) {
 
 			if (!fileList.empty()) {
 
+				pressedIdx = -1;	// the selection is dragged
+
 				QList<QUrl> urls;
 				for (QString fStr : fileList)
 					urls.append(QUrl::fromLocalFile(fStr));
@@ -1709,11 +2095,11 @@ void DkThumbsView::mouseMoveEvent(QMouseEvent *event) {
 				mimeData->setUrls(urls);
 
 				// create thumb image
-				QVector<DkThumbLabel*> tl = scene->getSelectedThumbs();
+				QVector<QSharedPointer<DkThumbNailT> > tl = scene->getSelectedThumbs(3);
 				QVector<QImage> imgs;
 
-				for (int idx = 0; idx < tl.size() && idx < 3; idx++) {
-					imgs << tl[idx]->getThumb()->getImage();
+				for (int idx = 0; idx < tl.size(); idx++) {
+					imgs << tl[idx]->getImage();
 				}
 
 				QPixmap pm = DkImage::merge(imgs).scaledToHeight(73);	// 73: see https://www.youtube.com/watch?v=TIYMmbHik08
@@ -1740,15 +2126,19 @@ void DkThumbsView::mouseReleaseEvent(QMouseEvent *event) {
 	DkThumbLabel* itemClicked = static_cast<DkThumbLabel*>(scene->itemAt(mapToScene(event->pos()), QTransform()));
 #endif
 
-	if (lastShiftIdx != -1 && event->modifiers() & Qt::ShiftModifier && itemClicked != 0) {
-		scene->selectThumbs(true, lastShiftIdx, scene->findThumb(itemClicked));
-	}
-	else if (itemClicked != 0) {
-		lastShiftIdx = scene->findThumb(itemClicked);
+	// a click on a selected thumb selects just this thumb
+	if (pressedIdx != -1 && itemClicked && scene->findThumb(itemClicked) == pressedIdx && event->modifiers() == Qt::NoModifier) {
+		scene->selectThumbs(false);
+		scene->selectThumbs(true, pressedIdx, pressedIdx);
 	}
-	else
-		lastShiftIdx = -1;
 
+	pressedIdx = -1;
+}
+
+void DkThumbsView::resizeEvent(QResizeEvent *event) {
+
+	QGraphicsView::resizeEvent(event);
+	scene->updateVisibleThumbs();
 }
 
 void DkThumbsView::dragEnterEvent(QDragEnterEvent *event) {
@@ -1822,26 +2212,6 @@ void DkThumbsView::dropEvent(QDropEvent *event) {
 	QGraphicsView::dropEvent(event);
 }
 
-void DkThumbsView::fetchThumbs() {
-
-	QList<QGraphicsItem*> items = scene->items(mapToScene(viewport()->rect()).boundingRect(), Qt::IntersectsItemShape);
-
-	for (int idx = 0; idx < items.size(); idx++) {
-
-		DkThumbLabel* th = dynamic_cast<DkThumbLabel*>(items.at(idx));
-
-		if (!th) {
-			qWarning() << "could not cast to thumb label...";
-			continue;
-		}
-
-		if (th->pixmap().isNull()) {
-			th->update();
-		}
-	}
-
-}
-
 // DkThumbScrollWidget --------------------------------------------------------------------
 DkThumbScrollWidget::DkThumbScrollWidget(QWidget* parent /* = 0 */, Qt::WindowFlags flags /* = 0 */) : DkFadeWidget(parent, flags) {
 
@@ -1972,15 +2342,12 @@ void DkThumbScrollWidget::batchPrint() const {
 
 void DkThumbScrollWidget::on_loadFile_triggered() {
 
-	auto selected = mThumbsScene->selectedItems();
+	QStringList selected = mThumbsScene->getSelectedFiles(1);
 
 	if (selected.isEmpty())
 		return;
 	
-	auto thumb = dynamic_cast<DkThumbLabel*>(selected.first());
-
-	if (thumb && thumb->getThumb())
-		mThumbsScene->loadFileSignal(thumb->getThumb()->getFilePath(), false);
+	mThumbsScene->loadFileSignal(selected.first(), false);
 }
 
 void DkThumbScrollWidget::updateThumbs(QVector<QSharedPointer<DkImageContainerT> > thumbs) {
@@ -2081,7 +2448,7 @@ void DkThumbScrollWidget::contextMenuEvent(QContextMenuEvent *event) {
 
 void DkThumbScrollWidget::enableSelectionActions() {
 
-	bool enable = !mThumbsScene->getSelectedFiles().isEmpty();
+	bool enable = mThumbsScene->numSelected() > 0;
 
 	DkActionManager& am = DkActionManager::instance();
 	am.action(DkActionManager::preview_copy)->setEnabled(enable);
@@ -2121,7 +2488,7 @@ void DkThumbPreviewLabel::thumbLoaded() {
 		return;
 	}
 
-	QPixmap pm = QPixmap::fromImage(mThumb->getImage());
+	QPixmap pm = QPixmap::fromImage(mThumb->getImage(mThumbSize));
 	pm = DkImage::makeSquare(pm);
 	
 	if (pm.width() > width())
@@ -36,6 +36,7 @@
 #include <QPen>
 #include <QGraphicsScene>
 #include <QGraphicsView>
+#include <QHash>
 #pragma warning(pop)		// no warnings from includes - end
 
 #include "DkBaseWidgets.h"
@@ -111,6 +112,7 @@ public slots:
 	void updateThumbs(QVector<QSharedPointer<DkImageContainerT> > thumbs);
 	void setFileInfo(QSharedPointer<DkImageContainerT> cImage);
 	void newPosition();
+	void thumbLoaded();
 
 signals:
 	void loadFileSignal(const QString& filePath) const;
@@ -142,6 +144,15 @@ private:
 	QRectF bufferDim;
 	QVector<QRectF> thumbRects;
 
+	// the strip is rendered to a cache that is blitted while scrolling
+	QImage stripCache;
+	QRect stripCacheRect;
+	int stripFileIdx;
+	bool stripDirty;
+	bool layoutDirty;
+	QImage fadeMask;
+	QImage frameBuffer;
+
 	QLinearGradient leftGradient;
 	QLinearGradient rightGradient;
 	//QPixmap selectedImg;
@@ -173,8 +184,11 @@ private:
 
 	void init();
 	void initOrientations();
-	void drawThumbs(QPainter* painter);
-	void drawFadeOut(QLinearGradient gradient, QRectF imgRect, QImage *img);
+	void layoutThumbs();
+	void renderStrip(const QRectF& viewRect);
+	void fetchVisibleThumbs(const QRectF& viewRect);
+	void createFadeMask();
+	QImage thumbImage(int idx);
 	void drawSelectedEffect(QPainter* painter, const QRectF& r);
 	void drawCurrentImgEffect(QPainter* painter, const QRectF& r);
 	void drawNoImgEffect(QPainter* painter, const QRectF& r);
@@ -190,6 +204,8 @@ public:
 
 	void setThumb(QSharedPointer<DkThumbNailT> thumb);
 	QSharedPointer<DkThumbNailT> getThumb() {return mThumb;};
+	void setChecked(bool checked);
+	bool isChecked() const;
 	QRectF boundingRect() const override;
 	QPainterPath shape() const override;
 	void updateSize();
@@ -214,25 +230,53 @@ protected:
 	QGraphicsPixmapItem mIcon;
 	QGraphicsTextItem mText;
 	bool mThumbInitialized = false;
-	bool mFetchingThumb = false;
 	QPen mNoImagePen;
 	QBrush mNoImageBrush;
 	QPen mSelectPen;
 	QBrush mSelectBrush;
 	bool mIsHovered = false;
+	bool mChecked = false;
+	QSize mLevelSize;		// size of the pyramid level shown
 	QPointF mLastMove;
 };
 
+/**
+ * The selected thumbnail indexes stored as sorted, disjoint ranges.
+ * Hence, selecting all files of a huge folder is a single range.
+ **/ 
+class DkThumbSelection {
+
+public:
+	void clear();
+	void select(int from, int to, bool select = true);
+
+	bool contains(int idx) const;
+	bool isEmpty() const;
+	int count() const;
+	int first() const;
+	int last() const;
+	QVector<int> indexes(int max = -1) const;
+
+protected:
+	QVector<QPair<int, int> > mRanges;	// inclusive [from to]
+};
+
 class DllCoreExport DkThumbScene : public QGraphicsScene {
 	Q_OBJECT
 
 public:
 	DkThumbScene(QWidget* parent = 0);
 
+	enum {
+		row_margin = 2,		// rows bound above & below the viewport
+	};
+
 	void updateLayout();
-	QStringList getSelectedFiles() const;
-	QVector<DkThumbLabel*> getSelectedThumbs() const;
+	QStringList getSelectedFiles(int max = -1) const;
+	QVector<QSharedPointer<DkThumbNailT> > getSelectedThumbs(int max = -1) const;
 	int selectedThumbIndex(bool first = true);
+	int numSelected() const;
+	bool isSelected(int idx) const;
 
 	void setImageLoader(QSharedPointer<DkImageLoader> loader);
 	void copyImages(const QMimeData* mimeData, const Qt::DropAction& da = Qt::CopyAction) const;
@@ -243,6 +287,7 @@ public:
 	
 public slots:
 	void updateThumbLabels();
+	void updateVisibleThumbs();
 	void cancelLoading();
 	void increaseThumbs();
 	void decreaseThumbs();
@@ -267,13 +312,24 @@ signals:
 protected:
 	void connectLoader(QSharedPointer<DkImageLoader> loader, bool connectSignals = true);
 	void keyPressEvent(QKeyEvent* event) override;
+	void ensureVisible(int idx) const;
+	QRectF thumbRect(int idx) const;
+	void bindLabel(int idx);
+	void releaseLabel(int idx);
+	void updateLabelSelection();
+	void requestThumbs(int firstIdx, int lastIdx, const QRectF& viewRect);
 	
 	int mXOffset = 0;
 	int mNumRows = 0;
 	int mNumCols = 0;
 	bool mFirstLayout = true;
 
-	QVector<DkThumbLabel* > mThumbLabels;
+	QHash<int, DkThumbLabel*> mThumbLabels;		// thumb index -> label (visible rows only)
+	QVector<DkThumbLabel*> mLabelPool;			// hidden labels for recycling
+	DkThumbSelection mSelection;
+	DkThumbRequestQueue* mThumbQueue = 0;
+	qreal mLastViewTop = 0;
+	int mScrollDir = 1;		// 1 down, -1 up
 	QSharedPointer<DkImageLoader> mLoader;
 	QVector<QSharedPointer<DkImageContainerT> > mThumbs;
 };
@@ -287,9 +343,6 @@ public:
 signals:
 	void updateDirSignal(const QString& dir) const;
 
-public slots:
-	void fetchThumbs();
-
 protected:
 	void wheelEvent(QWheelEvent *event) override;
 	void dragEnterEvent(QDragEnterEvent *event) override;
@@ -298,10 +351,12 @@ protected:
 	void mousePressEvent(QMouseEvent *event) override;
 	void mouseMoveEvent(QMouseEvent *event) override;
 	void mouseReleaseEvent(QMouseEvent *event) override;
+	void resizeEvent(QResizeEvent *event) override;
 
 	DkThumbScene* scene;
 	QPointF mousePos;
 	int lastShiftIdx;
+	int pressedIdx;
 
 };
 
@@ -44,6 +44,7 @@
 #include "DkDialog.h"
 #include "DkMessageBox.h"
 #include "DkToolbars.h"
+#include "DkScheduler.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QClipboard>
@@ -265,6 +266,38 @@ void DkViewPort::updateImage(QSharedPointer<DkImageContainerT> image, bool loade
 	}
 }
 
+/**
+ * Shows the preview while the image is loaded.
+ * The preview is replaced by setImage() once the full image is
+ * decoded. The zoom & panning applied to the preview are kept then.
+ * @param image the image container that has a preview
+ **/ 
+void DkViewPort::updatePreview(QSharedPointer<DkImageContainerT> image) {
+
+	if (!image || image->previewImage().isNull() || !mLoader)
+		return;
+
+	// the full image is faster
+	if (mLoader->getCurrentImage() != image || image->hasImage())
+		return;
+
+	show();
+
+	mImgStorage.setImage(image->previewImage());
+	mImgRect = QRectF(QPoint(), getImageSize());
+
+	double oldZoom = mWorldMatrix.m11();
+	mWorldMatrix.reset();
+	updateImageMatrix();
+
+	if (DkSettingsManager::param().display().keepZoom == DkSettings::zoom_always_keep)
+		zoomToPoint(oldZoom, mImgViewRect.center().toPoint(), mWorldMatrix);
+
+	mPreviewFilePath = image->filePath();
+
+	update();
+}
+
 void DkViewPort::loadImage(const QImage& newImg) {
 
 	// delete current information
@@ -318,25 +351,33 @@ void DkViewPort::setImage(QImage newImg) {
 	if (mLoader->hasSvg() && !mLoader->isEdited())
 		loadSvg();
 
+	QRectF previewRect = mImgRect;
 	mImgRect = QRectF(QPoint(), getImageSize());
 
+	// we replace the preview of this image - so keep the user's zoom & panning
+	bool replacesPreview = !mPreviewFilePath.isEmpty() && 
+		mLoader->getCurrentImage() && mLoader->getCurrentImage()->filePath() == mPreviewFilePath &&
+		!previewRect.isEmpty() && !mImgRect.isEmpty() &&
+		qAbs(previewRect.width() / previewRect.height() - mImgRect.width() / mImgRect.height()) < 0.01;
+	mPreviewFilePath = QString();
+
 	DkActionManager::instance().enableImageActions(!newImg.isNull());
 	mController->imageLoaded(!newImg.isNull());
 
 	double oldZoom = mWorldMatrix.m11();// *mImgMatrix.m11();
 
-	if (!(DkSettingsManager::param().display().keepZoom == DkSettings::zoom_keep_same_size && mOldImgRect == mImgRect))
+	if (!replacesPreview && !(DkSettingsManager::param().display().keepZoom == DkSettings::zoom_keep_same_size && mOldImgRect == mImgRect))
 		mWorldMatrix.reset();
 
 	updateImageMatrix();		
 
 	// if image is not inside, we'll align it at the top left border
-	if (!mViewportRect.intersects(mWorldMatrix.mapRect(mImgViewRect))) {
+	if (!replacesPreview && !mViewportRect.intersects(mWorldMatrix.mapRect(mImgViewRect))) {
 		mWorldMatrix.translate(-mWorldMatrix.dx(), -mWorldMatrix.dy());
 		centerImage();
 	}
 
-	if (DkSettingsManager::param().display().keepZoom == DkSettings::zoom_always_keep) {
+	if (!replacesPreview && DkSettingsManager::param().display().keepZoom == DkSettings::zoom_always_keep) {
 		zoomToPoint(oldZoom, mImgViewRect.center().toPoint(), mWorldMatrix);
 	}
 
@@ -345,8 +386,8 @@ void DkViewPort::setImage(QImage newImg) {
 
 	mOldImgRect = mImgRect;
 	
-	// init fading
-	if (DkSettingsManager::param().display().animationDuration && 
+	// init fading (not if we just replace the preview)
+	if (!replacesPreview && DkSettingsManager::param().display().animationDuration && 
 		DkSettingsManager::param().display().transition != DkSettingsManager::param().trans_appear && 
 		(mController->getPlayer()->isPlaying() ||
 			DkUtils::getMainWindow()->isFullScreen() ||
@@ -881,11 +922,11 @@ void DkViewPort::applyManipulator() {
 	else
 		img = getImage();
 
+	DkBaseManipulator* m = mpl.data();
 	mManipulatorWatcher.setFuture(
-		QtConcurrent::run(
-			mpl.data(), 
-			&nmc::DkBaseManipulator::apply,
-			img));
+		DkDecodeScheduler::instance().run<QImage>(
+			DkDecodeScheduler::priority_display, 
+			[m, img]() { return m->apply(img); }));
 
 	mActiveManipulator = mpl;
 
@@ -1666,6 +1707,8 @@ void DkViewPort::setEditedImage(QSharedPointer<DkImageContainerT> img) {
 
 bool DkViewPort::unloadImage(bool fileChange) {
 
+	mPreviewFilePath = QString();
+
 	if (DkSettingsManager::param().display().animationDuration > 0 && 
 			(mController->getPlayer()->isPlaying() || 
 			DkUtils::getMainWindow()->isFullScreen() || 
@@ -1914,6 +1957,7 @@ void DkViewPort::connectLoader(QSharedPointer<DkImageLoader> loader, bool connec
 	if (connectSignals) {
 		//connect(mLoader.data(), SIGNAL(imageLoadedSignal(QSharedPointer<DkImageContainerT>, bool)), this, SLOT(updateImage(QSharedPointer<DkImageContainerT>, bool)), Qt::UniqueConnection);
 		connect(loader.data(), SIGNAL(imageUpdatedSignal(QSharedPointer<DkImageContainerT>)), this, SLOT(updateImage(QSharedPointer<DkImageContainerT>)), Qt::UniqueConnection);
+		connect(loader.data(), SIGNAL(imagePreviewSignal(QSharedPointer<DkImageContainerT>)), this, SLOT(updatePreview(QSharedPointer<DkImageContainerT>)), Qt::UniqueConnection);
 
 		connect(loader.data(), SIGNAL(updateDirSignal(QVector<QSharedPointer<DkImageContainerT> >)), mController->getFilePreview(), SLOT(updateThumbs(QVector<QSharedPointer<DkImageContainerT> >)), Qt::UniqueConnection);
 		connect(loader.data(), SIGNAL(imageUpdatedSignal(QSharedPointer<DkImageContainerT>)), mController->getFilePreview(), SLOT(setFileInfo(QSharedPointer<DkImageContainerT>)), Qt::UniqueConnection);
@@ -1931,6 +1975,7 @@ void DkViewPort::connectLoader(QSharedPointer<DkImageLoader> loader, bool connec
 	else {
 		//connect(mLoader.data(), SIGNAL(imageLoadedSignal(QSharedPointer<DkImageContainerT>, bool)), this, SLOT(updateImage(QSharedPointer<DkImageContainerT>, bool)), Qt::UniqueConnection);
 		disconnect(loader.data(), SIGNAL(imageUpdatedSignal(QSharedPointer<DkImageContainerT>)), this, SLOT(updateImage(QSharedPointer<DkImageContainerT>)));
+		disconnect(loader.data(), SIGNAL(imagePreviewSignal(QSharedPointer<DkImageContainerT>)), this, SLOT(updatePreview(QSharedPointer<DkImageContainerT>)));
 
 		disconnect(loader.data(), SIGNAL(updateDirSignal(QVector<QSharedPointer<DkImageContainerT> >)), mController->getFilePreview(), SLOT(updateThumbs(QVector<QSharedPointer<DkImageContainerT> >)));
 		disconnect(loader.data(), SIGNAL(imageUpdatedSignal(QSharedPointer<DkImageContainerT>)), mController->getFilePreview(), SLOT(setFileInfo(QSharedPointer<DkImageContainerT>)));
@@ -181,6 +181,7 @@ public slots:
 	void manipulatorApplied();
 
 	virtual void updateImage(QSharedPointer<DkImageContainerT> image, bool loaded = true);
+	virtual void updatePreview(QSharedPointer<DkImageContainerT> image);
 	virtual void loadImage(const QImage& newImg);
 	virtual void loadImage(QSharedPointer<DkImageContainerT> img);
 	virtual void setEditedImage(const QImage& newImg, const QString& editName);
@@ -213,6 +214,7 @@ protected:
 	bool mGestureStarted = false;
 
 	QRectF mOldImgRect;
+	QString mPreviewFilePath;
 
 	QTimer* mRepeatZoomTimer;
 	
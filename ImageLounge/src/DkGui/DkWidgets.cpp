@@ -36,6 +36,9 @@
 #include "DkSettings.h"
 #include "DkStatusBar.h"
 #include "DkActionManager.h"
+#include "DkMetaData.h"
+#include "DkBasicLoader.h"
+#include "DkScheduler.h"
 
 #pragma warning(push, 0)	// no warnings from includes - begin
 #include <QMainWindow>
@@ -98,6 +101,9 @@
 #include <QButtonGroup>
 #include <QDesktopWidget>
 #include <QScreen>
+#include <QThreadPool>
+#include <QCryptographicHash>
+#include <QSet>
 #pragma warning(pop)		// no warnings from includes - end
 
 namespace nmc {
@@ -282,6 +288,18 @@ void DkFolderScrollBar::animateOpacityDown() {
 DkThumbsSaver::DkThumbsSaver(QWidget* parent) : DkFadeWidget(parent) {
 	mStop = false;
 	mNumSaved = 0;
+
+	mWritePool = new QThreadPool(this);
+	mWritePool->setMaxThreadCount(max_writers);
+}
+
+DkThumbsSaver::~DkThumbsSaver() {
+
+	if (mToken)
+		mToken->cancel();
+
+	mWritePool->waitForDone();
+	delete mCheckpoint;
 }
 
 void DkThumbsSaver::processDir(QVector<QSharedPointer<DkImageContainerT> > images, bool forceSave) {
@@ -289,15 +307,55 @@ void DkThumbsSaver::processDir(QVector<QSharedPointer<DkImageContainerT> > image
 	if (images.empty())
 		return;
 
+	// still running
+	if (mNumDecoding > 0 || mNumWriting > 0)
+		return;
+
 	mStop = false;
 	mNumSaved = 0;
+	mNumFailed = 0;
+	mNumProcessed = 0;
+	mNumFiles = images.size();
+	mCurrentDir = QFileInfo(images.first()->fileInfo().absolutePath());
+	mForceSave = forceSave;
+	mToken = QSharedPointer<DkCancelToken>(new DkCancelToken());
+	mDecoded.clear();
+	mQueue.clear();
+
+	// resume an interrupted run (files are stored with their absolute path)
+	QSet<QString> done;
+	delete mCheckpoint;
+	mCheckpoint = new QFile(checkpointPath(mCurrentDir.absoluteFilePath()));
+
+	if (mCheckpoint->open(QIODevice::ReadOnly)) {
+		
+		while (!mCheckpoint->atEnd())
+			done.insert(QString::fromUtf8(mCheckpoint->readLine()).trimmed());
+		mCheckpoint->close();
+	}
+
+	for (const QSharedPointer<DkImageContainerT>& img : images) {
+
+		if (!done.contains(img->fileInfo().absoluteFilePath()))
+			mQueue << img->filePath();
+	}
+
+	mNumSaved = mNumFiles - mQueue.size();
+
+	if (mNumSaved > 0)
+		qInfo() << "[DkThumbsSaver] resuming -" << mNumSaved << "of" << mNumFiles << "files are done already";
+
+	QDir().mkpath(QFileInfo(*mCheckpoint).absolutePath());
+	if (!mCheckpoint->open(QIODevice::WriteOnly | QIODevice::Append))
+		qWarning() << "[DkThumbsSaver] cannot write" << mCheckpoint->fileName() << "- the run cannot be resumed";
 
 	mPd = new QProgressDialog(tr("\nCreating thumbnails...\n") + images.first()->filePath(), 
 		tr("Cancel"), 
 		0, 
-		(int)images.size(), 
+		mNumFiles, 
 		DkUtils::getMainWindow());
 	mPd->setWindowTitle(tr("Thumbnails"));
+	mPd->setValue(mNumSaved);
 
 	//pd->setWindowModality(Qt::WindowModal);
 
@@ -306,45 +364,159 @@ void DkThumbsSaver::processDir(QVector<QSharedPointer<DkImageContainerT> > image
 
 	mPd->show();
 
-	this->mForceSave = forceSave;
-	this->mImages = images;
-	loadNext();
+	mTimer.start();
+	fillPipeline();
+}
 
+/**
+ * Starts decoding & writing until the stages are busy.
+ **/ 
+void DkThumbsSaver::fillPipeline() {
+
+	int maxDecoding = DkDecodeScheduler::instance().maxThreads(DkDecodeScheduler::priority_batch);
+
+	// decoded files wait for writers - so we do not decode too far ahead
+	while (!mStop && !mQueue.empty() && mNumDecoding < maxDecoding && mDecoded.size() + mNumDecoding < max_decoded) {
+
+		QString filePath = mQueue.takeFirst();
+		bool force = mForceSave;
+		QSharedPointer<DkCancelToken> token = mToken;
+
+		QFutureWatcher<DecodedThumb>* watcher = new QFutureWatcher<DecodedThumb>(this);
+		connect(watcher, SIGNAL(finished()), this, SLOT(thumbDecoded()));
+
+		watcher->setFuture(DkDecodeScheduler::instance().run<DecodedThumb>(
+			DkDecodeScheduler::priority_batch, 
+			[filePath, force, token]() {
+				return qMakePair(filePath, DkThumbNail::embedThumb(filePath, force, token));
+			}));
+
+		mNumDecoding++;
+	}
+
+	while (!mDecoded.empty() && mNumWriting < max_writers) {
+
+		DecodedThumb dt = mDecoded.takeFirst();
+
+		QFutureWatcher<WrittenThumb>* watcher = new QFutureWatcher<WrittenThumb>(this);
+		connect(watcher, SIGNAL(finished()), this, SLOT(thumbWritten()));
+
+		watcher->setFuture(QtConcurrent::run(mWritePool, [dt]() {
+
+			QFileInfo fInfo(dt.first);
+			QString lFilePath = fInfo.isSymLink() ? fInfo.symLinkTarget() : dt.first;
+			bool saved = false;
+
+			try {
+				saved = dt.second->saveMetaData(lFilePath);
+			}
+			catch (...) {
+				saved = false;
+			}
+
+			if (!saved)
+				qWarning() << "[DkThumbsSaver] could not save the thumbnail of" << dt.first;
+
+			return qMakePair(dt.first, saved);
+		}));
+
+		mNumWriting++;
+	}
+
+	if (mNumDecoding == 0 && mNumWriting == 0 && mDecoded.empty() && (mQueue.empty() || mStop))
+		finish();
+}
+
+void DkThumbsSaver::thumbDecoded() {
+
+	QFutureWatcher<DecodedThumb>* watcher = static_cast<QFutureWatcher<DecodedThumb>*>(QObject::sender());
+	DecodedThumb dt = watcher->result();
+	watcher->deleteLater();
+	mNumDecoding--;
+
+	if (dt.second)
+		mDecoded << dt;
+	else if (!DkCancelToken::isCanceled(mToken))
+		fileDone(dt.first);		// nothing to save (e.g. the file has a thumbnail already)
+	else
+		mQueue.prepend(dt.first);	// resumed next time
+
+	fillPipeline();
 }
 
-void DkThumbsSaver::thumbLoaded(bool) {
+void DkThumbsSaver::thumbWritten() {
+
+	QFutureWatcher<WrittenThumb>* watcher = static_cast<QFutureWatcher<WrittenThumb>*>(QObject::sender());
+	WrittenThumb wt = watcher->result();
+	fileDone(wt.first, wt.second);
+	watcher->deleteLater();
+	mNumWriting--;
 
-	mNumSaved++;
-	emit numFilesSignal(mNumSaved);
+	fillPipeline();
+}
+
+void DkThumbsSaver::fileDone(const QString& filePath, bool saved) {
 
-	if (mNumSaved == mImages.size() || mStop) {
-		if (mPd) {
-			mPd->close();
-			mPd->deleteLater();
-			mPd = 0;
+	// failed files are not checkpointed - so they are retried if the run is resumed
+	if (!saved)
+		mNumFailed++;
+	else {
+		if (mCheckpoint && mCheckpoint->isOpen() && !filePath.isEmpty()) {
+			mCheckpoint->write(QFileInfo(filePath).absoluteFilePath().toUtf8() + "\n");
+			mCheckpoint->flush();
 		}
-		mStop = true;
+
+		mNumSaved++;
+	}
+
+	mNumProcessed++;
+	emit numFilesSignal(mNumSaved + mNumFailed);
+
+	if (mPd) {
+		double fps = mNumProcessed / qMax(mTimer.elapsed()/1000.0, 0.001);
+		mPd->setLabelText(tr("\nCreating thumbnails...\n%1\n%2 files/s").arg(filePath).arg(fps, 0, 'f', 1));
 	}
-	else
-		loadNext();
 }
 
-void DkThumbsSaver::loadNext() {
-	
-	if (mStop)
-		return;
+void DkThumbsSaver::finish() {
+
+	bool completed = mNumSaved >= mNumFiles;
+
+	qInfo() << "[DkThumbsSaver]" << mNumProcessed << "files processed in" << mTimer.elapsed() << "ms -" 
+		<< qRound(mNumProcessed / qMax(mTimer.elapsed()/1000.0, 0.001)) << "files/s";
 
-	int force = (mForceSave) ? DkThumbNail::force_save_thumb : DkThumbNail::save_thumb;
+	if (mNumFailed > 0)
+		qWarning() << "[DkThumbsSaver]" << mNumFailed << "thumbnails could not be saved";
 
-	for (int idx = 0; idx < mImages.size(); idx++) {
-		connect(mImages.at(idx)->getThumb().data(), SIGNAL(thumbLoadedSignal(bool)), this, SLOT(thumbLoaded(bool)));
-		mImages.at(idx)->getThumb()->fetchThumb(force);
+	if (mCheckpoint) {
+		mCheckpoint->close();
+
+		// the next run starts from scratch
+		if (completed)
+			mCheckpoint->remove();
+	}
+
+	if (mPd) {
+		mPd->close();
+		mPd->deleteLater();
+		mPd = 0;
 	}
+	mStop = true;
+}
+
+QString DkThumbsSaver::checkpointPath(const QString& dirPath) {
+
+	QByteArray hash = QCryptographicHash::hash(QDir::cleanPath(dirPath).toUtf8(), QCryptographicHash::Md5).toHex();
+	return DkUtils::getAppDataPath() + "/thumbs-saver/" + QString::fromLatin1(hash) + ".txt";
 }
 
 void DkThumbsSaver::stopProgress() {
 
+	// running files are finished (or canceled) - the rest is resumed next time
 	mStop = true;
+
+	if (mToken)
+		mToken->cancel();
 }
 
 // DkFileSystemModel --------------------------------------------------------------------
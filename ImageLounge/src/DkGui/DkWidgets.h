@@ -39,6 +39,7 @@
 #include <QLineEdit>
 #include <QListWidget>
 #include <QProgressBar>
+#include <QElapsedTimer>
 #pragma warning(pop)		// no warnings from includes - end
 
 #pragma warning(disable: 4251)	// TODO: remove
@@ -61,11 +62,15 @@ class QGridLayout;
 class QVBoxLayout;
 class QSvgRenderer;
 class QSettings;
+class QThreadPool;
+class QFile;
 
 namespace nmc {
 
 // nomacs defines
 class DkCropToolBar;
+class DkMetaDataT;
+class DkCancelToken;
 
 class DkButton : public QPushButton {
 	Q_OBJECT
@@ -333,11 +338,23 @@ protected:
 };
 
 // this class is one of the first batch processing classes -> move them to a new file in the (near) future
+/**
+ * Embeds thumbnails into the files' metadata.
+ * Files are decoded by the decode scheduler while decoded files are
+ * written by a few writer threads - so both stages run in parallel.
+ * Finished files are checkpointed so that an interrupted run resumes.
+ **/ 
 class DkThumbsSaver : public DkFadeWidget {
 	Q_OBJECT
 
 public:
 	DkThumbsSaver(QWidget* parent = 0);
+	~DkThumbsSaver();
+
+	enum {
+		max_writers = 2,
+		max_decoded = 8,	// decoded files waiting for a writer
+	};
 
 	void processDir(QVector<QSharedPointer<DkImageContainerT> > images, bool forceSave);
 
@@ -346,17 +363,35 @@ signals:
 
 public slots:
 	void stopProgress();
-	void thumbLoaded(bool loaded);
-	void loadNext();
+	void thumbDecoded();
+	void thumbWritten();
 
 protected:
+	typedef QPair<QString, QSharedPointer<DkMetaDataT> > DecodedThumb;
+	typedef QPair<QString, bool> WrittenThumb;
+
+	void fillPipeline();
+	void fileDone(const QString& filePath, bool saved = true);
+	void finish();
+	static QString checkpointPath(const QString& dirPath);
 
 	QFileInfo mCurrentDir;
 	QProgressDialog* mPd = 0;
 	bool mStop = false;
 	bool mForceSave = false;
-	int mNumSaved = false;
-	QVector<QSharedPointer<DkImageContainerT> > mImages;
+	int mNumSaved = 0;
+	int mNumFailed = 0;		// retried with the next run
+	int mNumFiles = 0;
+	int mNumDecoding = 0;
+	int mNumWriting = 0;
+	int mNumProcessed = 0;	// files processed in this session
+
+	QStringList mQueue;
+	QList<DecodedThumb> mDecoded;
+	QSharedPointer<DkCancelToken> mToken;
+	QThreadPool* mWritePool = 0;
+	QFile* mCheckpoint = 0;
+	QElapsedTimer mTimer;
 };
 
 class DkFileSystemModel : public QFileSystemModel {
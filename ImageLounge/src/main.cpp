@@ -66,6 +66,7 @@
 
 #include "DkDependencyResolver.h"
 #include "DkMetaData.h"
+#include "DkMetaDataWriter.h"
 
 #include <iostream>
 #include <cassert>
@@ -343,5 +344,8 @@ int main(int argc, char *argv[]) {
 	if (pw)
 		delete pw;
 
+	// write metadata edits that are still queued (e.g. ratings)
+	nmc::DkMetaDataWriter::instance().flush();
+
 	return rVal;
 }